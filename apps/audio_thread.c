@@ -25,6 +25,7 @@
 #include "kernel.h"
 #include "logf.h"
 #include "usb.h"
+#include "storage.h"
 #include "pcm.h"
 #include "sound.h"
 #include "pcmbuf.h"
@@ -69,6 +70,7 @@ static void NORETURN_ATTR audio_thread(void)
     struct queue_event ev;
     ev.id = Q_NULL; /* something not in switch below */
 
+    storage_set_origin(STORAGE_ORIGIN_AUDIO);
     pcm_postinit();
 
     while (1)
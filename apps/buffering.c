@@ -37,6 +37,9 @@
 #endif
 #include "buffering.h"
 #include "linked_list.h"
+#ifdef HAVE_LOUDNESS_SCAN
+#include "loudness_scan.h"
+#endif
 
 /* Define LOGF_ENABLE to enable logf output in this file */
 /* #define LOGF_ENABLE */
@@ -621,6 +624,33 @@ static int update_data_counters(struct data_counters *dc)
 
 /* Q_BUFFER_HANDLE event and buffer data for the given handle.
    Return whether or not the buffering should continue explicitly.  */
+/* Returns how much of the file from 'end' on to read into the buffer at 'widx';
+   sets *stop if that fills it up to the next handle */
+static ssize_t handle_chunk_size(struct memory_handle *h, size_t widx,
+                                 off_t end, bool *stop)
+{
+    ssize_t copy_n = h->filesize - end;
+    copy_n = MIN(copy_n, BUFFERING_DEFAULT_FILECHUNK);
+    copy_n = MIN(copy_n, (off_t)(buffer_len - widx));
+
+    mutex_lock(&llist_mutex);
+
+    /* read only up to available space and stop if it would overwrite
+       the next handle; stop one byte early to avoid empty/full alias
+       (or else do more complicated arithmetic to differentiate) */
+    size_t next = ringbuf_offset(HLIST_NEXT(h) ?: HLIST_FIRST);
+    ssize_t overlap = ringbuf_add_cross_full(widx, copy_n, next);
+
+    mutex_unlock(&llist_mutex);
+
+    if (overlap > 0) {
+        *stop = true;
+        copy_n -= overlap;
+    }
+
+    return copy_n;
+}
+
 static bool buffer_handle(int handle_id, size_t to_buffer)
 {
     logf("buffer_handle(%d, %lu)", handle_id, (unsigned long)to_buffer);
@@ -655,6 +685,10 @@ static bool buffer_handle(int handle_id, size_t to_buffer)
         get_metadata_ex(ringbuf_ptr(h->data),
                         h->fd, h->path, METADATA_CLOSE_FD_ON_EXIT);
         h->fd = -1; /* with above, behavior same as close_fd */
+#ifdef HAVE_LOUDNESS_SCAN
+        /* while the disk is up for the track anyway */
+        loudness_scan_apply(ringbuf_ptr(h->data));
+#endif
         h->widx = ringbuf_add(h->data, h->filesize);
         h->end  = h->filesize;
         send_event(BUFFER_EVENT_FINISHED, &handle_id);
@@ -662,29 +696,110 @@ static bool buffer_handle(int handle_id, size_t to_buffer)
     }
 
     bool stop = false;
-    while (h->end < h->filesize && !stop)
+#ifdef HAVE_STORAGE_ASYNC
+    /* queue the next read before finishing the one in flight, so that the
+       disk has work while the handle is updated and the queue is checked */
+    static struct file_async reads[2];
+    struct file_async *cur = NULL;  /* read in flight */
+    size_t cur_widx = h->widx;      /* where it goes */
+    ssize_t cur_n = 0;              /* bytes it will have got */
+    bool more = true;               /* may queue another read */
+    bool nospace = false;
+
+    do
     {
-        /* max amount to copy */
-        size_t widx = h->widx;
-        ssize_t copy_n = h->filesize - h->end;
-        copy_n = MIN(copy_n, BUFFERING_DEFAULT_FILECHUNK);
-        copy_n = MIN(copy_n, (off_t)(buffer_len - widx));
+        struct file_async *next = NULL;
+        size_t next_widx = ringbuf_add(cur_widx, cur_n);
+        off_t next_end = h->end + cur_n;
+        ssize_t next_n = 0;
+        bool failed = false;
 
-        mutex_lock(&llist_mutex);
+        if (more && !stop && next_end < h->filesize)
+        {
+            next_n = handle_chunk_size(h, next_widx, next_end, &stop);
+            if (next_n > 0)
+            {
+                next = &reads[cur == &reads[0]];
+                next_n = read_submit(h->fd, ringbuf_ptr(next_widx), next_n,
+                                     next);
+                if (next_n <= 0)
+                {
+                    next = NULL;
+                    failed = true;
+                }
+            }
+            else
+            {
+                nospace = true;
+            }
+        }
 
-        /* read only up to available space and stop if it would overwrite
-           the next handle; stop one byte early to avoid empty/full alias
-           (or else do more complicated arithmetic to differentiate) */
-        size_t next = ringbuf_offset(HLIST_NEXT(h) ?: HLIST_FIRST);
-        ssize_t overlap = ringbuf_add_cross_full(widx, copy_n, next);
+        if (cur)
+        {
+            ssize_t rc = read_finish(cur);
+            if (rc > 0)
+            {
+                /* Advance buffer and make data available to users */
+                h->widx = ringbuf_add(cur_widx, rc);
+                h->end += rc;
+            }
+            else
+            {
+                /* what follows can't be used */
+                if (next)
+                    read_finish(next);
 
-        mutex_unlock(&llist_mutex);
+                next = NULL;
+                failed = true;
+            }
+        }
+
+        if (failed) {
+            /* the file position is past what made it into the buffer */
+            lseek(h->fd, h->end, SEEK_SET);
+
+            /* Some kind of filesystem error, maybe recoverable if not codec */
+            if (h->type == TYPE_CODEC) {
+                logf("Partial codec");
+                break;
+            }
+
+            logf("File ended %lu bytes early\n",
+                 (unsigned long)(h->filesize - h->end));
+            h->filesize = h->end;
+            break;
+        }
+
+        if (cur) {
+            yield();
 
-        if (overlap > 0) {
-            stop = true;
-            copy_n -= overlap;
+            if (to_buffer == 0) {
+                /* Normal buffering - check queue */
+                if (!queue_empty(&buffering_queue))
+                    more = false;
+            } else {
+                if (to_buffer <= (size_t)cur_n)
+                    more = false; /* Done */
+                else
+                    to_buffer -= cur_n;
+            }
         }
 
+        cur = next;
+        cur_widx = next_widx;
+        cur_n = next_n;
+    }
+    while (cur);
+
+    if (nospace)
+        return false; /* no space for read */
+#else /* !HAVE_STORAGE_ASYNC */
+    while (h->end < h->filesize && !stop)
+    {
+        /* max amount to copy */
+        size_t widx = h->widx;
+        ssize_t copy_n = handle_chunk_size(h, widx, h->end, &stop);
+
         if (copy_n <= 0)
             return false; /* no space for read */
 
@@ -720,6 +835,7 @@ static bool buffer_handle(int handle_id, size_t to_buffer)
             to_buffer -= rc;
         }
     }
+#endif /* HAVE_STORAGE_ASYNC */
 
     if (h->end >= h->filesize) {
         /* finished buffering the file */
@@ -1583,6 +1699,8 @@ static void NORETURN_ATTR buffering_thread(void)
     bool filling = false;
     struct queue_event ev;
 
+    storage_set_origin(STORAGE_ORIGIN_BUFFERING);
+
     while (true)
     {
         if (num_handles > 0) {
@@ -24,6 +24,7 @@
 #include "config.h"
 #include "system.h"
 #include "kernel.h"
+#include "storage.h"
 #include "codecs.h"
 #include "codec_thread.h"
 #include "pcmbuf.h"
@@ -33,6 +34,7 @@
 #include "dsp_core.h"
 #include "metadata.h"
 #include "settings.h"
+#include "seek_index.h"
 
 /* Define LOGF_ENABLE to enable logf output in this file */
 /*#define LOGF_ENABLE*/
@@ -220,6 +222,161 @@ void codec_thread_do_callback(void (*fn)(void), unsigned int *id)
     codec_queue_send(Q_CODEC_DO_CALLBACK, (intptr_t)fn);
 }
 
+#ifdef HAVE_LOUDNESS_SCAN
+/* Borrow the codec thread without waiting for it to get around to it. The
+   callback is dropped if a codec is running when it arrives. */
+void codec_thread_post_callback(void (*fn)(void))
+{
+    LOGFQUEUE("codec > Q_CODEC_DO_CALLBACK");
+    queue_post(&codec_queue, Q_CODEC_DO_CALLBACK, (intptr_t)fn);
+}
+
+/* Is something waiting for the codec thread? A borrower checks this to give
+   the thread back to playback in time. */
+bool codec_thread_has_msg(void)
+{
+    return !queue_empty(&codec_queue);
+}
+#endif /* HAVE_LOUDNESS_SCAN */
+
+
+/** --- Burst decoding --- **/
+
+#ifdef HAVE_BURST_DECODE
+/* Lossy formats decode many times faster than realtime. Rather than topping
+ * up pcmbuf whenever a little room appears, which keeps the CPU awake doing
+ * a sliver of work every few ticks, the codec lets pcmbuf drain to a resume
+ * level and then refills all of it at once at full speed. The resume level
+ * is set from the fill rate measured over the previous refill so that the
+ * next one finishes well before pcmbuf runs low. */
+#define BURST_LEVEL_MIN_SECS    2    /* Lowest level a refill may start at */
+
+static struct
+{
+    bool enabled;           /* Loaded codec decodes in bursts */
+    bool filling;           /* Refilling pcmbuf */
+    int afmt;               /* Format resume_level was measured for */
+    long start_tick;        /* When the refill started... */
+    size_t start_level;     /* ...and the pcmbuf level then */
+    size_t resume_level;    /* Level at which to start refilling */
+} burst; /* (C) */
+
+static size_t burst_byterate(void)
+{
+    return pcmbuf_get_frequency() * 2 * sizeof (int16_t);
+}
+
+static size_t burst_pcmbuf_level(void)
+{
+    return pcmbuf_get_bufsize() - pcmbuf_free();
+}
+
+/* Choose the policy for a newly loaded codec (C) */
+static void burst_init(int afmt)
+{
+    switch (afmt)
+    {
+    case AFMT_MPA_L1:
+    case AFMT_MPA_L2:
+    case AFMT_MPA_L3:
+    case AFMT_OGG_VORBIS:
+    case AFMT_MP4_AAC:
+    case AFMT_MP4_AAC_HE:
+    case AFMT_OPUS:
+        /* Only worth it if there is room for bursts of some length */
+        burst.enabled = pcmbuf_get_bufsize() >=
+                            4 * BURST_LEVEL_MIN_SECS * burst_byterate();
+        break;
+    default:
+        burst.enabled = false;
+    }
+
+    burst.filling = false;
+
+    if (afmt != burst.afmt)
+    {
+        /* Nothing measured yet - start from half full */
+        burst.afmt = afmt;
+        burst.resume_level = pcmbuf_get_bufsize() / 2;
+    }
+}
+
+/* Set the resume level from how fast the refill just finished went (C) */
+static void burst_measure(size_t level)
+{
+    long ticks = current_tick - burst.start_tick;
+
+    /* Refills from empty include the prebuffering before playback starts,
+       so they are no measure of anything */
+    if (burst.start_level == 0 || level <= burst.start_level)
+        return;
+
+    /* Starting at R with the buffer size S, draining at b and filling at a
+       net rate n, the refill must be done before the level drops to W; with
+       a factor of two to spare: R - 2*(S - R)*b/n = W */
+    uint64_t n = (uint64_t)(level - burst.start_level) * HZ;
+    uint64_t b = (uint64_t)burst_byterate() * MAX(ticks, 1);
+    uint64_t w = BURST_LEVEL_MIN_SECS * burst_byterate();
+    uint64_t s = pcmbuf_get_bufsize();
+
+    burst.resume_level = (w*n + 2*s*b) / (n + 2*b);
+    logf("burst: %lu bytes in %ld ticks, resume at %lu",
+         (unsigned long)(level - burst.start_level), ticks,
+         (unsigned long)burst.resume_level);
+}
+
+/* Returns the ticks to wait before decoding more or 0 to go on (C) */
+static long codec_burst_wait(void)
+{
+    if (!burst.enabled || burst.filling)
+        return 0;
+
+    size_t level = burst_pcmbuf_level();
+    size_t byterate = burst_byterate();
+
+    if (level > burst.resume_level && byterate > 0)
+        return (level - burst.resume_level) / (byterate / HZ) + 1;
+
+    /* Refill as fast as possible */
+    burst.filling = true;
+    burst.start_tick = current_tick;
+    burst.start_level = level;
+    trigger_cpu_boost();
+    return 0;
+}
+
+/* pcmbuf is full - returns the ticks to wait before trying again (C) */
+static long codec_pcmbuf_full(void)
+{
+    cancel_cpu_boost();
+
+    if (burst.filling)
+    {
+        burst.filling = false;
+        burst_measure(burst_pcmbuf_level());
+    }
+
+    long tmo = codec_burst_wait();
+    return tmo > 0 ? tmo : HZ/20;
+}
+#else /* !HAVE_BURST_DECODE */
+static inline void burst_init(int afmt)
+{
+    (void)afmt;
+}
+
+static inline long codec_burst_wait(void)
+{
+    return 0;
+}
+
+static inline long codec_pcmbuf_full(void)
+{
+    cancel_cpu_boost();
+    return HZ/20;
+}
+#endif /* HAVE_BURST_DECODE */
+
 
 /** --- codec API callbacks --- **/
 
@@ -239,13 +396,19 @@ static void codec_pcmbuf_insert_callback(
         dst.remcount = 0;
         dst.bufcount = MAX(src.remcount, 1024); /* Arbitrary min request */
 
-        if ((dst.p16out = pcmbuf_request_buffer(&dst.bufcount)) == NULL)
+        long tmo = codec_burst_wait();
+
+        if (tmo == 0 &&
+            (dst.p16out = pcmbuf_request_buffer(&dst.bufcount)) == NULL)
         {
-            cancel_cpu_boost();
+            tmo = codec_pcmbuf_full();
+        }
 
+        if (tmo > 0)
+        {
             /* It may be awhile before space is available but we want
                "instant" response to any message */
-            queue_wait_w_tmo(&codec_queue, NULL, HZ/20);
+            queue_wait_w_tmo(&codec_queue, NULL, tmo);
         }
         else
         {
@@ -495,6 +658,7 @@ static void load_codec(const struct codec_load_info *ev_data)
     if (status >= 0 && encoder == !!codec_get_enc_callback())
     {
         codec_type = data.afmt;
+        burst_init(encoder ? AFMT_UNKNOWN : data.afmt);
         codec_queue_ack(Q_CODEC_LOAD);
         return;
     }
@@ -532,12 +696,16 @@ static void run_codec(void)
 
         /* Pin the codec's audio data in place */
         buf_pin_handle(ci.audio_hid, true);
+
+        seek_index_open(ci.id3);
     }
 
     status = codec_run_proc();
 
     if (!encoder)
     {
+        seek_index_close();
+
         /* Codec is done with it - let it move */
         buf_pin_handle(ci.audio_hid, false);
 
@@ -592,6 +760,8 @@ static void NORETURN_ATTR codec_thread(void)
 {
     struct queue_event ev;
 
+    storage_set_origin(STORAGE_ORIGIN_AUDIO);
+
     while (1)
     {
         cancel_cpu_boost();
@@ -656,6 +826,10 @@ void INIT_ATTR codec_thread_init(void)
     ci.get_command      = codec_get_command_callback;
     ci.loop_track       = codec_loop_track_callback;
     ci.strip_filesize = codec_strip_filesize_callback;
+    ci.seek_index_add   = seek_index_add;
+    ci.seek_index_find  = seek_index_find;
+
+    seek_index_init();
 
     /* Init threading */
     queue_init(&codec_queue, false);
@@ -34,6 +34,10 @@ void codec_thread_init(void) INIT_ATTR;
 /* Audio MUST be stopped before requesting callback! */
 void codec_thread_do_callback(void (*fn)(void),
                               unsigned int *codec_thread_id);
+#ifdef HAVE_LOUDNESS_SCAN
+void codec_thread_post_callback(void (*fn)(void));
+bool codec_thread_has_msg(void);
+#endif
 
 #ifdef HAVE_PRIORITY_SCHEDULING
 int codec_thread_get_priority(void);
@@ -151,6 +151,8 @@ struct codec_api ci = {
     /* new stuff at the end, sort into place next time
        the API gets incompatible */
 
+    NULL, /* seek_index_add */
+    NULL, /* seek_index_find */
 };
 
 void codec_get_full_path(char *path, const char *codec_root_fn)
@@ -287,6 +289,72 @@ int codec_close(void)
     return status;
 }
 
+/** reentrant decoding contexts **/
+
+/* Returns the size of a context for the loaded codec or 0 if it can only
+   decode the stream run through ci */
+size_t codec_context_size(void)
+{
+    if (curr_handle == NULL || c_hdr->ctx_ops == NULL)
+        return 0;
+
+    return c_hdr->ctx_ops->size;
+}
+
+static void context_seek_index_add(unsigned long time, off_t pos)
+{
+    (void)time;
+    (void)pos;
+}
+
+static bool context_seek_index_find(unsigned long time,
+                                    struct seek_point *lo,
+                                    struct seek_point *hi)
+{
+    (void)time;
+    (void)lo;
+    (void)hi;
+    return false;
+}
+
+/* Set up the api of a context stream. The stream callbacks are left to the
+   caller; streams other than the playing one don't use the seek index. */
+void codec_context_init_api(struct codec_api *api)
+{
+    *api = ci;
+
+    api->filesize = 0;
+    api->curpos = 0;
+    api->id3 = NULL;
+    api->audio_hid = ERR_HANDLE_NOT_FOUND;
+    api->dsp = NULL;
+    api->codec_get_buffer = NULL;
+    api->pcmbuf_insert = NULL;
+    api->set_elapsed = NULL;
+    api->read_filebuf = NULL;
+    api->request_buffer = NULL;
+    api->advance_buffer = NULL;
+    api->seek_buffer = NULL;
+    api->seek_complete = NULL;
+    api->set_offset = NULL;
+    api->configure = NULL;
+    api->get_command = NULL;
+    api->loop_track = NULL;
+    api->strip_filesize = NULL;
+    api->seek_index_add = context_seek_index_add;
+    api->seek_index_find = context_seek_index_find;
+}
+
+int codec_run_context(struct codec_api *api, void *ctx)
+{
+    if (curr_handle == NULL || c_hdr->ctx_ops == NULL) {
+        logf("Codec: not reentrant");
+        return CODEC_ERROR;
+    }
+
+    return c_hdr->ctx_ops->run(api, ctx);
+}
+
 #ifdef HAVE_RECORDING
 enc_callback_t codec_get_enc_callback(void)
 {
@@ -56,6 +56,7 @@
 #include "logf.h"
 #if (CONFIG_PLATFORM & PLATFORM_NATIVE)
 #include "disk.h"
+#include "disk_cache.h"
 #include "adc.h"
 #include "usb.h"
 #include "rtc.h"
@@ -1864,6 +1865,149 @@ static bool dbg_disk_info(void)
     info.scroll_all = true;
     return simplelist_show_list(&info);
 }
+
+static int disk_cache_callback(int btn, struct gui_synclist *lists)
+{
+    (void)lists;
+    static const char * const class_names[DC_NUM_CLASSES] =
+    {
+        [DC_MISC] = "Other",
+        [DC_DIR]  = "Directory",
+        [DC_FAT]  = "FAT",
+    };
+
+    struct dc_stats stats;
+    dc_get_stats(&stats);
+
+    simplelist_reset_lines();
+
+    for (int i = 0; i < DC_NUM_CLASSES; i++)
+    {
+        unsigned long total = stats.hits[i] + stats.misses[i];
+        unsigned int ratio = total ? 1000ull*stats.hits[i] / total : 0;
+        simplelist_addline("%s hits: %lu/%lu (%u.%u%%)", class_names[i],
+                           stats.hits[i], total, ratio / 10, ratio % 10);
+    }
+
+    simplelist_addline("Promoted: %lu", stats.promotions);
+    simplelist_addline("Read ahead: %lu (%lu used)",
+                       stats.prefetched, stats.prefetch_hits);
+    simplelist_addline("Entries: %u in, %u main",
+                       stats.queued[0], stats.queued[1]);
+
+    if (btn == ACTION_NONE)
+        btn = ACTION_REDRAW;
+
+    return btn;
+}
+
+static bool dbg_disk_cache(void)
+{
+    struct simplelist_info info;
+    simplelist_info_init(&info, "Disk Cache", 0, NULL);
+    info.action_callback = disk_cache_callback;
+    info.timeout = HZ;
+    info.scroll_all = true;
+    return simplelist_show_list(&info);
+}
+
+#ifdef HAVE_STORAGE_TRACE
+static const char * const storage_origin_names[STORAGE_NUM_ORIGINS] =
+{
+    [STORAGE_ORIGIN_OTHER]     = "Other",
+    [STORAGE_ORIGIN_BUFFERING] = "Buffering",
+    [STORAGE_ORIGIN_AUDIO]     = "Audio",
+    [STORAGE_ORIGIN_TAGCACHE]  = "Database",
+    [STORAGE_ORIGIN_DIRCACHE]  = "Dircache",
+    [STORAGE_ORIGIN_PLAYLIST]  = "Playlist",
+    [STORAGE_ORIGIN_SETTINGS]  = "Settings",
+    [STORAGE_ORIGIN_FONT]      = "Fonts",
+};
+
+/* write the counters and the trace to a file */
+static void storage_trace_dump(void)
+{
+    static struct storage_trace_entry trace[STORAGE_TRACE_SIZE];
+    struct storage_origin_stats stats[STORAGE_NUM_ORIGINS];
+
+    /* take them before the dump adds to them */
+    int count = storage_get_trace(trace, STORAGE_TRACE_SIZE);
+    storage_get_origin_stats(stats);
+
+    int fd = creat("/storage_trace.txt", 0666);
+    if (fd < 0)
+        return;
+
+    fdprintf(fd, "origin transfers sectors_read sectors_written wakes\n");
+    for (int i = 0; i < STORAGE_NUM_ORIGINS; i++)
+    {
+        fdprintf(fd, "%s %lu %lu %lu %lu\n", storage_origin_names[i],
+                 stats[i].transfers, stats[i].read, stats[i].written,
+                 stats[i].wakes);
+    }
+
+    fdprintf(fd, "\ntick origin op start count\n");
+    for (int i = 0; i < count; i++)
+    {
+        const struct storage_trace_entry *e = &trace[i];
+        fdprintf(fd, "%ld %s %c%s%s %llu %u\n", e->tick,
+                 storage_origin_names[e->origin],
+                 (e->flags & STORAGE_TRACE_WRITE) ? 'W' : 'R',
+                 (e->flags & STORAGE_TRACE_WAKE) ? "+wake" : "",
+                 (e->flags & STORAGE_TRACE_ERROR) ? "+error" : "",
+                 (unsigned long long)e->start, e->count);
+    }
+
+    close(fd);
+}
+
+static int storage_io_callback(int btn, struct gui_synclist *lists)
+{
+    (void)lists;
+    struct storage_origin_stats stats[STORAGE_NUM_ORIGINS];
+
+    switch (btn)
+    {
+    case ACTION_STD_CONTEXT:
+        splash(0, "Dumping trace...");
+        storage_trace_dump();
+        splash(HZ, "Trace dumped");
+        btn = ACTION_NONE;
+        break;
+    case ACTION_STD_OK:
+        storage_reset_origin_stats();
+        btn = ACTION_NONE;
+        break;
+    }
+
+    storage_get_origin_stats(stats);
+
+    simplelist_reset_lines();
+
+    for (int i = 0; i < STORAGE_NUM_ORIGINS; i++)
+    {
+        simplelist_addline("%s: R %lu W %lu, %lu wakes",
+                           storage_origin_names[i], stats[i].read,
+                           stats[i].written, stats[i].wakes);
+    }
+
+    if (btn == ACTION_NONE)
+        btn = ACTION_REDRAW;
+
+    return btn;
+}
+
+static bool dbg_storage_io(void)
+{
+    struct simplelist_info info;
+    simplelist_info_init(&info, "Storage I/O [OK reset, CONTEXT dump]", 0,
+                         NULL);
+    info.action_callback = storage_io_callback;
+    info.timeout = HZ;
+    info.scroll_all = true;
+    return simplelist_show_list(&info);
+}
+#endif /* HAVE_STORAGE_TRACE */
 #endif /* PLATFORM_NATIVE */
 
 #ifdef HAVE_DIRCACHE
@@ -2885,6 +3029,10 @@ static const struct {
 #endif
 #if (CONFIG_PLATFORM & PLATFORM_NATIVE)
         { "View disk info", dbg_disk_info },
+        { "View disk cache", dbg_disk_cache },
+#ifdef HAVE_STORAGE_TRACE
+        { "View storage I/O", dbg_storage_io },
+#endif
 #if (CONFIG_STORAGE & STORAGE_ATA)
         { "Dump ATA identify info", dbg_identify_info},
 #ifdef HAVE_ATA_SMART
@@ -297,6 +297,233 @@ static int compare(const void* p1, const void* p2)
     return 0; /* never reached */
 }
 
+#if (CONFIG_PLATFORM & PLATFORM_NATIVE) && (MEMORYSIZE >= 8)
+/* Sorted listings of recently visited directories, so going back into a
+ * large directory needs neither reading nor sorting it again as long as the
+ * filesystem says its entries haven't changed. They are packed into one
+ * buffer and the least recently used ones are dropped to make room. */
+#define HAVE_LISTING_CACHE
+#define LISTING_BUFFER_SIZE (MEMORYSIZE*8*1024)
+#define LISTING_MIN_ENTRIES 32  /* smaller directories sort quickly enough */
+
+struct listing_entry
+{
+    unsigned int name;          /* offset of name after the entries */
+    int attr;
+    unsigned time_write;
+};
+
+struct listing
+{
+    size_t size;                /* bytes this listing takes in the buffer */
+    unsigned int serial;        /* dir_get_serial() before it was read */
+    unsigned int last_use;      /* for finding the least recently used one */
+    /* what decided the contents and order */
+    int dirfilter;
+    int dirlevel;
+    struct compare_data cmp;
+    bool talk_clips;
+    /* the listing itself */
+    int filesindir;
+    int dirsindir;
+    bool dirfull;
+    size_t names_size;          /* bytes of names after the entries */
+    char path[MAX_PATH];
+    struct listing_entry entries[];
+};
+
+static int listing_handle;
+static size_t listing_used;
+static unsigned int listing_use_count;
+
+#define LISTING_AT(buf, offset) \
+    ((struct listing *)((char *)(buf) + (offset)))
+
+#define FOR_EACH_LISTING(buf, l) \
+    for (struct listing *l = LISTING_AT(buf, 0); \
+         (char *)l < (char *)(buf) + listing_used; \
+         l = LISTING_AT(l, l->size))
+
+static int listing_move_callback(int handle, void *current, void *new)
+{
+    (void)handle; (void)current; (void)new;
+    return BUFLIB_CB_OK; /* contents are position-independent */
+}
+
+/* not shrinkable: playback asks for everything, hard, whenever it allocates
+   its buffer, and giving in would lose the cache each time music is played */
+static struct buflib_callbacks listing_ops = {
+    .move_callback = listing_move_callback,
+    .shrink_callback = NULL,
+};
+
+static bool listing_alloc(void)
+{
+    if (!listing_handle)
+    {
+        listing_used = 0;
+        listing_handle = core_alloc_ex(LISTING_BUFFER_SIZE, &listing_ops);
+        if (listing_handle < 0)
+            listing_handle = 0;
+    }
+
+    return listing_handle != 0;
+}
+
+/* grab the buffer; done early so it isn't left to compete with playback */
+void ft_mem_init(void)
+{
+    listing_alloc();
+}
+
+static bool listing_matches(const struct listing *l,
+                            const struct tree_context *c, const char *path)
+{
+    return l->dirfilter == *c->dirfilter &&
+           l->dirlevel == c->dirlevel &&
+           l->cmp.sort_dir == cmp_data.sort_dir &&
+           l->cmp.sort_file == cmp_data.sort_file &&
+           l->cmp._compar == cmp_data._compar &&
+           l->talk_clips == global_settings.talk_file_clip &&
+           !strcmp(l->path, path);
+}
+
+static void listing_remove(void *buf, struct listing *l)
+{
+    size_t size = l->size;
+    char *end = (char *)buf + listing_used;
+    memmove(l, (char *)l + size, end - ((char *)l + size));
+    listing_used -= size;
+}
+
+/* copy a still current listing of 'path' into the tree's cache */
+static bool listing_restore(struct tree_context *c, const char *path,
+                            DIR *dir)
+{
+    if (!listing_handle)
+        return false;
+
+    bool found = false;
+
+    /* checking the directory may block; keep the buffer where it is */
+    core_pin(listing_handle);
+
+    void *buf = core_get_data(listing_handle);
+    FOR_EACH_LISTING(buf, l)
+    {
+        if (!listing_matches(l, c, path))
+            continue;
+
+        if (dir_changed_since(dir, l->serial))
+        {
+            listing_remove(buf, l);
+            break;
+        }
+
+        struct entry *entries = tree_get_entries(c);
+        char *names = core_get_data(c->cache.name_buffer_handle);
+        const char *lnames = (const char *)&l->entries[l->filesindir];
+
+        memcpy(names, lnames, l->names_size);
+        for (int i = 0; i < l->filesindir; i++)
+        {
+            entries[i].name       = names + l->entries[i].name;
+            entries[i].attr       = l->entries[i].attr;
+            entries[i].time_write = l->entries[i].time_write;
+        }
+
+        c->filesindir = l->filesindir;
+        c->dirlength  = l->filesindir;
+        c->dirsindir  = l->dirsindir;
+        c->dirfull    = l->dirfull;
+        l->last_use   = ++listing_use_count;
+        found = true;
+        break;
+    }
+
+    core_unpin(listing_handle);
+    return found;
+}
+
+/* keep a copy of the listing just loaded into the tree's cache */
+static void listing_store(struct tree_context *c, const char *path,
+                          unsigned int serial, size_t names_size)
+{
+    if (c->filesindir < LISTING_MIN_ENTRIES)
+        return;
+
+    size_t size = ALIGN_UP(sizeof (struct listing) +
+                           c->filesindir*sizeof (struct listing_entry) +
+                           names_size, sizeof (void *));
+    if (size > LISTING_BUFFER_SIZE)
+        return;
+
+    /* allocation failed early; retry, but don't make anyone shrink for it */
+    if (!listing_handle && core_allocatable() < LISTING_BUFFER_SIZE)
+        return;
+
+    if (!listing_alloc())
+        return;
+
+    void *buf = core_get_data(listing_handle);
+
+    /* drop any older version, then the least recently used until it fits */
+    FOR_EACH_LISTING(buf, l)
+    {
+        if (listing_matches(l, c, path))
+        {
+            listing_remove(buf, l);
+            break;
+        }
+    }
+
+    while (LISTING_BUFFER_SIZE - listing_used < size)
+    {
+        struct listing *lru = NULL;
+        FOR_EACH_LISTING(buf, l)
+        {
+            if (!lru || (int)(l->last_use - lru->last_use) < 0)
+                lru = l;
+        }
+
+        listing_remove(buf, lru);
+    }
+
+    struct listing *l = LISTING_AT(buf, listing_used);
+    struct entry *entries = tree_get_entries(c);
+    char *names = core_get_data(c->cache.name_buffer_handle);
+    char *lnames = (char *)&l->entries[c->filesindir];
+
+    l->size       = size;
+    l->serial     = serial;
+    l->last_use   = ++listing_use_count;
+    l->dirfilter  = *c->dirfilter;
+    l->dirlevel   = c->dirlevel;
+    l->cmp        = cmp_data;
+    l->talk_clips = global_settings.talk_file_clip;
+    l->filesindir = c->filesindir;
+    l->dirsindir  = c->dirsindir;
+    l->dirfull    = c->dirfull;
+    l->names_size = names_size;
+    strmemccpy(l->path, path, sizeof (l->path));
+
+    /* names in the tree's cache are in the order they were read */
+    memcpy(lnames, names, names_size);
+    for (int i = 0; i < c->filesindir; i++)
+    {
+        l->entries[i].name       = entries[i].name - names;
+        l->entries[i].attr       = entries[i].attr;
+        l->entries[i].time_write = entries[i].time_write;
+    }
+
+    listing_used += size;
+}
+#else
+void ft_mem_init(void)
+{
+}
+#endif /* PLATFORM_NATIVE && MEMORYSIZE >= 8 */
+
 /* load and sort directory into the tree's cache. returns NULL on failure. */
 int ft_load(struct tree_context* c, const char* tempdir)
 {
@@ -312,20 +539,53 @@ int ft_load(struct tree_context* c, const char* tempdir)
     if (!c->is_browsing)
         c->browse = NULL;
 
-    if (tempdir)
-        dir = opendir(tempdir);
-    else
-    {
-        dir = opendir(c->currdir);
+    const char *path = tempdir ? tempdir : c->currdir;
+    dir = opendir(path);
+    if (!tempdir)
         callback_show_item = c->browse? c->browse->callback_show_item: NULL;
-    }
     if(!dir)
         return -1; /* not a directory */
 
+    /* allow directories to be sorted into file list */
+    cmp_data.sort_dir = (*c->dirfilter == SHOW_PLUGINS) ? SORT_AS_FILE : c->sort_dir;
+
+    /* playlist catalog uses sorting independent from file browser */
+    cmp_data.sort_file = (*c->dirfilter == SHOW_M3U) ?
+                         global_settings.sort_playlists : global_settings.sort_file;
+
+    if (global_settings.sort_case)
+    {
+        if (global_settings.interpret_numbers == SORT_INTERPRET_AS_NUMBER)
+            cmp_data._compar = strnatcmp_n;
+        else
+            cmp_data._compar = strncmp;
+    }
+    else
+    {
+        if (global_settings.interpret_numbers == SORT_INTERPRET_AS_NUMBER)
+            cmp_data._compar = strnatcasecmp_n;
+        else
+            cmp_data._compar = strncasecmp;
+    }
+
+    tree_lock_cache(c);
+
+#ifdef HAVE_LISTING_CACHE
+    /* taken before reading so changes made meanwhile make it stale */
+    unsigned int serial = dir_get_serial();
+
+    /* a browse callback may decide differently next time */
+    if (!callback_show_item && listing_restore(c, path, dir))
+    {
+        closedir(dir);
+        tree_unlock_cache(c);
+        return 0;
+    }
+#endif /* HAVE_LISTING_CACHE */
+
     c->dirsindir = 0;
     c->dirfull = false;
 
-    tree_lock_cache(c);
     while ((entry = readdir(dir))) {
         int len;
         struct dirinfo info;
@@ -423,28 +683,6 @@ int ft_load(struct tree_context* c, const char* tempdir)
     c->dirlength = files_in_dir;
     closedir(dir);
 
-    /* allow directories to be sorted into file list */
-    cmp_data.sort_dir = (*c->dirfilter == SHOW_PLUGINS) ? SORT_AS_FILE : c->sort_dir;
-
-    /* playlist catalog uses sorting independent from file browser */
-    cmp_data.sort_file = (*c->dirfilter == SHOW_M3U) ?
-                         global_settings.sort_playlists : global_settings.sort_file;
-
-    if (global_settings.sort_case)
-    {
-        if (global_settings.interpret_numbers == SORT_INTERPRET_AS_NUMBER)
-            cmp_data._compar = strnatcmp_n;
-        else
-            cmp_data._compar = strncmp;
-    }
-    else
-    {
-        if (global_settings.interpret_numbers == SORT_INTERPRET_AS_NUMBER)
-            cmp_data._compar = strnatcasecmp_n;
-        else
-            cmp_data._compar = strncasecmp;
-    }
-
     qsort(tree_get_entries(c), files_in_dir, sizeof(struct entry), compare);
 
     /* If thumbnail talking is enabled, make an extra run to mark files with
@@ -452,6 +690,11 @@ int ft_load(struct tree_context* c, const char* tempdir)
     if (global_settings.talk_file_clip)
         check_file_thumbnails(c); /* map .talk to ours */
 
+#ifdef HAVE_LISTING_CACHE
+    if (!callback_show_item)
+        listing_store(c, path, serial, name_buffer_used);
+#endif
+
     tree_unlock_cache(c);
     return 0;
 }
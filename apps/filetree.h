@@ -22,6 +22,7 @@
 #define FILETREE_H
 #include "tree.h"
 
+void ft_mem_init(void) INIT_ATTR;
 int ft_load(struct tree_context* c, const char* tempdir);
 int ft_enter(struct tree_context* c);
 int ft_exit(struct tree_context* c);
@@ -0,0 +1,431 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Copyright (C) 2026 by the Rockbox contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+
+/* Background loudness scan
+ *
+ * Tracks without ReplayGain tags would play at whatever level they were
+ * mastered at. While nothing is playing, the database thread picks such
+ * tracks one at a time and has them decoded on the codec thread, which is
+ * idle then, into an EBU R128 meter instead of the pcm buffer. The codec
+ * thread runs at background priority meanwhile and gives up the track as
+ * soon as playback sends it anything. The result goes into the database,
+ * and when the track is played later its measured loudness is turned into
+ * a track gain before the codec starts, as if the track had been tagged.
+ */
+#include "config.h"
+#include "system.h"
+#include "kernel.h"
+#include "file.h"
+#include "core_alloc.h"
+#include "power.h"
+#include "audio.h"
+#include "settings.h"
+#include "metadata.h"
+#include "replaygain.h"
+#include "codecs.h"
+#include "codec_thread.h"
+#include "tagcache.h"
+#include "loudness.h"
+#include "loudness_scan.h"
+
+/* Define LOGF_ENABLE to enable logf output in this file */
+/*#define LOGF_ENABLE*/
+#include "logf.h"
+
+/* Size of the window into the file the codec reads from */
+#define SCAN_WINDOW_SIZE    (32*1024)
+
+struct scan_buffers
+{
+    struct loudness_meter meter;
+    unsigned char window[SCAN_WINDOW_SIZE];
+};
+
+enum scan_state
+{
+    SCAN_IDLE = 0,      /* Nothing to do */
+    SCAN_POSTED,        /* Callback is waiting for the codec thread */
+    SCAN_RUNNING,       /* Codec is decoding the track */
+};
+
+/* Variables are commented with the threads that use them:
+ * T=tagcache, C=codec */
+static struct mutex scan_mutex;         /* Protects scan_state */
+static struct semaphore scan_done;      /* Codec finished the track */
+static enum scan_state scan_state;      /* (T,C) */
+static volatile bool scan_stop;         /* (T,C) Codec should halt */
+static bool scan_halted;                /* (C) Codec was told to halt */
+static int scan_status;                 /* (C) What the codec returned */
+
+static struct codec_api scan_api;       /* (T,C) */
+static struct mp3entry scan_id3;        /* (T,C) */
+static const char *scan_codec;          /* (T,C) Codec for scan_id3 */
+static struct scan_buffers *scan_buf;   /* (T,C) */
+static int scan_fd = -1;                /* (T,C) */
+static off_t win_pos;                   /* (C) File position of window[0] */
+static size_t win_len;                  /* (C) Bytes in the window */
+
+/* Have the window hold as many as possible of the next size bytes of the
+   file and return that number */
+static size_t window_fill(size_t size)
+{
+    unsigned char *window = scan_buf->window;
+    off_t pos = scan_api.curpos;
+    ssize_t rc;
+
+    if (pos >= scan_api.filesize)
+        return 0;
+
+    size = MIN(size, (size_t)(scan_api.filesize - pos));
+    size = MIN(size, SCAN_WINDOW_SIZE);
+
+    if (pos >= win_pos && pos + (off_t)size <= win_pos + (off_t)win_len)
+        return size;
+
+    if (pos >= win_pos && pos <= win_pos + (off_t)win_len)
+    {
+        /* Keep the tail and read on from where the last read stopped */
+        size_t keep = win_pos + win_len - pos;
+        memmove(window, window + (pos - win_pos), keep);
+        win_len = keep;
+    }
+    else
+    {
+        win_len = 0;
+        if (lseek(scan_fd, pos, SEEK_SET) != pos)
+            return 0;
+    }
+
+    win_pos = pos;
+
+    rc = read(scan_fd, window + win_len, SCAN_WINDOW_SIZE - win_len);
+    if (rc > 0)
+        win_len += rc;
+
+    return MIN(size, win_len);
+}
+
+/** codec API callbacks **/
+
+static void scan_pcmbuf_insert(const void *ch1, const void *ch2, int count)
+{
+    loudness_insert(&scan_buf->meter, ch1, ch2, count);
+}
+
+static void scan_set_elapsed(unsigned long value)
+{
+    scan_id3.elapsed = value;
+}
+
+static size_t scan_read_filebuf(void *ptr, size_t size)
+{
+    size_t total = 0;
+
+    while (size > 0)
+    {
+        size_t n = window_fill(size);
+        if (n == 0)
+            break;
+
+        memcpy(ptr, scan_buf->window + (scan_api.curpos - win_pos), n);
+        ptr = (char *)ptr + n;
+        scan_api.curpos += n;
+        total += n;
+        size -= n;
+    }
+
+    return total;
+}
+
+static void * scan_request_buffer(size_t *realsize, size_t reqsize)
+{
+    *realsize = window_fill(reqsize);
+    return scan_buf->window + (scan_api.curpos - win_pos);
+}
+
+static void scan_advance_buffer(size_t amount)
+{
+    scan_api.curpos = MIN(scan_api.curpos + (off_t)amount, scan_api.filesize);
+}
+
+static bool scan_seek_buffer(size_t newpos)
+{
+    if ((off_t)newpos > scan_api.filesize)
+        return false;
+
+    scan_api.curpos = newpos;
+    return true;
+}
+
+static void scan_seek_complete(void)
+{
+}
+
+static void scan_set_offset(size_t value)
+{
+    scan_id3.offset = value;
+}
+
+static void scan_configure(int setting, intptr_t value)
+{
+    loudness_configure(&scan_buf->meter, setting, value);
+}
+
+static long scan_get_command(intptr_t *param)
+{
+    /* The codec thread doesn't block on the pcm buffer here, so let the
+       others in on targets without priorities */
+    yield();
+
+    if (scan_stop || codec_thread_has_msg())
+    {
+        scan_halted = true;
+        return CODEC_ACTION_HALT;
+    }
+
+    return CODEC_ACTION_NULL;
+    (void)param;
+}
+
+static bool scan_loop_track(void)
+{
+    return false;
+}
+
+static void scan_strip_filesize(off_t size)
+{
+    if (size < scan_api.filesize)
+        scan_api.filesize = size;
+}
+
+/* Runs on the codec thread */
+static void scan_codec_thread(void)
+{
+    mutex_lock(&scan_mutex);
+
+    if (scan_state != SCAN_POSTED)
+    {
+        /* Given up on before the codec thread got here */
+        mutex_unlock(&scan_mutex);
+        return;
+    }
+
+    scan_state = SCAN_RUNNING;
+    mutex_unlock(&scan_mutex);
+
+#ifdef HAVE_PRIORITY_SCHEDULING
+    int priority = codec_thread_set_priority(PRIORITY_BACKGROUND);
+#endif
+
+    scan_status = CODEC_ERROR;
+    scan_halted = codec_thread_has_msg();
+
+    if (!scan_halted && codec_load_file(scan_codec, &scan_api) == CODEC_OK)
+        scan_status = codec_run_proc();
+
+    codec_close();
+
+#ifdef HAVE_PRIORITY_SCHEDULING
+    codec_thread_set_priority(priority);
+#endif
+
+    semaphore_release(&scan_done);
+}
+
+/* Set up scan_api to decode the opened track from the start */
+static void scan_api_init(void)
+{
+    codec_context_init_api(&scan_api);
+
+    scan_api.filesize = scan_id3.filesize;
+    scan_api.id3 = &scan_id3;
+    scan_api.codec_get_buffer = codec_get_buffer_callback;
+    scan_api.pcmbuf_insert = scan_pcmbuf_insert;
+    scan_api.set_elapsed = scan_set_elapsed;
+    scan_api.read_filebuf = scan_read_filebuf;
+    scan_api.request_buffer = scan_request_buffer;
+    scan_api.advance_buffer = scan_advance_buffer;
+    scan_api.seek_buffer = scan_seek_buffer;
+    scan_api.seek_complete = scan_seek_complete;
+    scan_api.set_offset = scan_set_offset;
+    scan_api.configure = scan_configure;
+    scan_api.get_command = scan_get_command;
+    scan_api.loop_track = scan_loop_track;
+    scan_api.strip_filesize = scan_strip_filesize;
+
+    scan_id3.elapsed = 0;
+    scan_id3.offset = 0;
+
+    win_pos = 0;
+    win_len = 0;
+    lseek(scan_fd, 0, SEEK_SET);
+}
+
+/* Decode the opened track. Returns false if it was stopped. */
+static bool scan_run(bool (*stop)(void))
+{
+    scan_stop = false;
+
+    mutex_lock(&scan_mutex);
+    scan_state = SCAN_POSTED;
+    mutex_unlock(&scan_mutex);
+
+    codec_thread_post_callback(scan_codec_thread);
+
+    while (semaphore_wait(&scan_done, HZ/2) != OBJ_WAIT_SUCCEEDED)
+    {
+        if (!stop())
+            continue;
+
+        mutex_lock(&scan_mutex);
+
+        if (scan_state == SCAN_POSTED)
+        {
+            /* The callback will find it has nothing to do */
+            scan_state = SCAN_IDLE;
+            mutex_unlock(&scan_mutex);
+            return false;
+        }
+
+        scan_stop = true;
+        mutex_unlock(&scan_mutex);
+
+        semaphore_wait(&scan_done, TIMEOUT_BLOCK);
+        break;
+    }
+
+    scan_state = SCAN_IDLE;
+    return !scan_halted;
+}
+
+bool loudness_scan_track(const char *path, long *loudness, long *peak,
+                         bool (*stop)(void))
+{
+    bool finished = true;
+    long lufs, tp;
+    int handle;
+
+    *loudness = 0;
+    *peak = LOUDNESS_PEAK_NONE;
+
+    scan_fd = open(path, O_RDONLY);
+    if (scan_fd < 0)
+        return true;
+
+    if (!get_metadata(&scan_id3, scan_fd, path))
+        goto out;
+
+    /* Tagged tracks don't need measuring */
+    if (scan_id3.track_gain != 0 || scan_id3.album_gain != 0)
+        goto out;
+
+    scan_codec = get_codec_filename(scan_id3.codectype);
+    if (scan_codec == NULL)
+        goto out;
+
+    /* The codec yields, don't let the buffer move */
+    handle = core_alloc_ex(sizeof (*scan_buf), &buflib_ops_locked);
+    if (handle <= 0)
+    {
+        finished = false; /* Try again later */
+        goto out;
+    }
+
+    scan_buf = core_get_data(handle);
+    loudness_init(&scan_buf->meter);
+    scan_api_init();
+
+    logf("loudness: scanning %s", path);
+
+    finished = scan_run(stop);
+
+    if (finished && scan_status == CODEC_OK &&
+        loudness_result(&scan_buf->meter, &lufs, &tp))
+    {
+        /* s19.12 to 0.01 LU, and the peak to Q7.24 */
+        *loudness = (lufs*100 + (lufs < 0 ? -2048 : 2048)) / 4096;
+        *peak = MAX(tp << 12, 1);
+        logf("loudness: %ld/100 LUFS, peak %lx", *loudness, *peak);
+    }
+
+    scan_buf = NULL;
+    core_free(handle);
+
+out:
+    close(scan_fd);
+    scan_fd = -1;
+    return finished;
+}
+
+bool loudness_scan_allowed(void)
+{
+    switch (global_settings.loudness_scan)
+    {
+    case LOUDNESS_SCAN_CHARGING:
+#if CONFIG_CHARGING
+        if (!charger_inserted())
+#endif
+            return false;
+        break;
+    case LOUDNESS_SCAN_IDLE:
+        break;
+    default:
+        return false;
+    }
+
+    return audio_status() == 0 && codec_loaded() == AFMT_UNKNOWN;
+}
+
+void loudness_scan_apply(struct mp3entry *id3)
+{
+    struct tagcache_search tcs;
+    long loudness, peak, gain;
+
+    if (global_settings.loudness_scan == LOUDNESS_SCAN_OFF ||
+        id3->track_gain != 0 || id3->album_gain != 0 ||
+        !tagcache_is_usable())
+        return;
+
+    if (!tagcache_find_index(&tcs, id3->path))
+        return;
+
+    loudness = tagcache_get_numeric(&tcs, tag_loudness);
+    peak = tagcache_get_numeric(&tcs, tag_truepeak);
+    tagcache_search_finish(&tcs);
+
+    if (peak <= 0)
+        return; /* Not measured, or an error */
+
+    /* Gain in dB * 100 */
+    gain = LOUDNESS_REFERENCE*100 - loudness;
+
+    id3->track_level = gain * (1 << 12) / 100;
+    id3->track_gain = get_replaygain_int(gain);
+    id3->track_peak = peak;
+
+    logf("loudness: %s gain %ld/100 dB", id3->path, gain);
+}
+
+void INIT_ATTR loudness_scan_init(void)
+{
+    mutex_init(&scan_mutex);
+    semaphore_init(&scan_done, 1, 0);
+}
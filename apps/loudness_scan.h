@@ -0,0 +1,56 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Copyright (C) 2026 by the Rockbox contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#ifndef _LOUDNESS_SCAN_H_
+#define _LOUDNESS_SCAN_H_
+
+#include <stdbool.h>
+
+/* The database keeps the integrated loudness in tag_loudness, in 0.01 LU,
+   and the true peak in tag_truepeak as a factor in Q7.24 like the
+   ReplayGain peaks. tag_truepeak also tells what became of the track: */
+#define LOUDNESS_PEAK_UNMEASURED    0   /* Not measured yet */
+#define LOUDNESS_PEAK_NONE          (-1) /* Has ReplayGain tags, is silent or
+                                            can't be decoded */
+
+/* Level the measured tracks are brought to, in LUFS. This is the reference
+   of ReplayGain 2.0 and about that of ReplayGain 1.0 as well. */
+#define LOUDNESS_REFERENCE          (-18)
+
+struct mp3entry;
+
+void loudness_scan_init(void);
+
+/* Is now a good time to measure? Called by the database thread. */
+bool loudness_scan_allowed(void);
+
+/* Measure one track by decoding it on the codec thread. Blocks until the
+   track is done or stop() returns true; stop() is polled every now and then.
+   Returns false if the measurement was stopped, true with *loudness and
+   *peak set to what should be stored in the database otherwise. */
+bool loudness_scan_track(const char *path, long *loudness, long *peak,
+                         bool (*stop)(void));
+
+/* Give a track without ReplayGain tags the track gain for its measured
+   loudness. Called by buffering right after the track's metadata is read,
+   so the database is looked in while the disk is spinning anyway. */
+void loudness_scan_apply(struct mp3entry *id3);
+
+#endif /* _LOUDNESS_SCAN_H_ */
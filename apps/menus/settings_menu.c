@@ -156,6 +156,9 @@ MENUITEM_FUNCTION(tc_init, 0, ID2P(LANG_TAGCACHE_FORCE_UPDATE),
 MENUITEM_FUNCTION(tc_update, 0, ID2P(LANG_TAGCACHE_UPDATE),
                   (int(*)(void))tagcache_update_with_splash, NULL, Icon_NOICON);
 MENUITEM_SETTING(runtimedb, &global_settings.runtimedb, NULL);
+#ifdef HAVE_LOUDNESS_SCAN
+MENUITEM_SETTING(loudness_scan, &global_settings.loudness_scan, NULL);
+#endif
 
 MENUITEM_FUNCTION(tc_export, 0, ID2P(LANG_TAGCACHE_EXPORT),
                   tagtree_export,
@@ -172,6 +175,9 @@ MAKE_MENU(tagcache_menu, ID2P(LANG_TAGCACHE), 0, Icon_NOICON,
                 &tagcache_ram,
 #endif
                 &tagcache_autoupdate, &tc_init, &tc_update, &runtimedb,
+#ifdef HAVE_LOUDNESS_SCAN
+                &loudness_scan,
+#endif
                 &tc_export, &tc_import, &tc_paths
                 );
 #endif /* HAVE_TAGCACHE */
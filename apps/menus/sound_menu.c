@@ -225,6 +225,19 @@ static int timestretch_callback(int action,
               &compressor_threshold, &compressor_gain, &compressor_ratio,
               &compressor_knee, &compressor_attack, &compressor_release);
 
+    /* limiter submenu */
+    MENUITEM_SETTING(limiter_enabled,
+                     &global_settings.limiter_settings.enabled,
+                     lowlatency_callback);
+    MENUITEM_SETTING(limiter_ceiling,
+                     &global_settings.limiter_settings.ceiling,
+                     lowlatency_callback);
+    MENUITEM_SETTING(limiter_lookahead,
+                     &global_settings.limiter_settings.lookahead,
+                     lowlatency_callback);
+    MAKE_MENU(limiter_menu,ID2P(LANG_LIMITER), NULL, Icon_NOICON,
+              &limiter_enabled, &limiter_ceiling, &limiter_lookahead);
+
 #ifdef HAVE_SPEAKER
     MENUITEM_SETTING(speaker_mode, &global_settings.speaker_mode, NULL);
 #endif
@@ -268,7 +281,7 @@ MAKE_MENU(sound_settings, ID2P(LANG_SOUND_SETTINGS), NULL, Icon_Audio,
 #ifdef HAVE_PITCHCONTROL
           ,&timestretch_enabled
 #endif
-          ,&compressor_menu
+          ,&compressor_menu, &limiter_menu
 #ifdef HAVE_SPEAKER
          ,&speaker_mode
 #endif
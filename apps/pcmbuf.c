@@ -89,6 +89,13 @@
 #define LOW_DATA            pcmbuf_watermark
 #endif
 
+#ifdef HAVE_BURST_DECODE
+/* Headroom for decoding ahead in bursts - the lesser of this much audio... */
+#define BURST_HEADROOM_SECS 10
+/* ...and this fraction of the audio buffer */
+#define BURST_HEADROOM_DIV  16
+#endif
+
 /* Describes each audio packet - keep it small since there are many of them */
 struct chunkdesc
 {
@@ -122,6 +129,10 @@ static size_t chunk_transidx;
 
 static size_t pcmbuf_watermark = 0;
 
+#ifdef HAVE_BURST_DECODE
+static size_t pcmbuf_burst_headroom = 0;
+#endif
+
 static bool low_latency_mode = false;
 
 static bool pcmbuf_sync_position = false;
@@ -555,6 +566,10 @@ static unsigned int get_next_required_pcmbuf_chunks(void)
 {
     size_t size = MIN_BUFFER_SIZE;
 
+#ifdef HAVE_BURST_DECODE
+    size += pcmbuf_burst_headroom;
+#endif
+
 #ifdef HAVE_CROSSFADE
     if (crossfade_enable_request != CROSSFADE_ENABLE_OFF)
     {
@@ -589,12 +604,21 @@ size_t pcmbuf_size_reqd(void)
     return get_next_required_pcmbuf_chunks() * PCMBUF_CHUNK_SIZE;
 }
 
-/* Initialize the PCM buffer. The structure looks like this:
+/* Initialize the PCM buffer at the end of a buffer of bufsize bytes. The
+ * structure looks like this:
  * ...|---------PCMBUF---------|GUARDBUF|DESCS| */
-size_t pcmbuf_init(void *bufend)
+size_t pcmbuf_init(void *bufend, size_t bufsize)
 {
     void *bufstart;
 
+#ifdef HAVE_BURST_DECODE
+    pcmbuf_burst_headroom = ALIGN_DOWN(MIN((size_t)BYTERATE * BURST_HEADROOM_SECS,
+                                           bufsize / BURST_HEADROOM_DIV),
+                                       PCMBUF_CHUNK_SIZE);
+#else
+    (void)bufsize;
+#endif
+
     /* Set up the buffers */
     pcmbuf_desc_count = get_next_required_pcmbuf_chunks();
     pcmbuf_size = pcmbuf_desc_count * PCMBUF_CHUNK_SIZE;
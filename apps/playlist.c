@@ -78,6 +78,7 @@
 #include "playlist.h"
 #include "ata_idle_notify.h"
 #include "file.h"
+#include "storage.h"
 #include "action.h"
 #include "mv.h"
 #include "debug.h"
@@ -397,7 +398,11 @@ static int rotate_index(const struct playlist_info* playlist, int index)
 static void sync_control_unlocked(struct playlist_info* playlist)
 {
     if (playlist->control_fd >= 0)
+    {
+        int origin = storage_set_origin(STORAGE_ORIGIN_PLAYLIST);
         fsync(playlist->control_fd);
+        storage_set_origin(origin);
+    }
 }
 
 static int update_control_unlocked(struct playlist_info* playlist,
@@ -406,6 +411,7 @@ static int update_control_unlocked(struct playlist_info* playlist,
 {
     int fd = playlist->control_fd;
     int result;
+    int origin = storage_set_origin(STORAGE_ORIGIN_PLAYLIST);
 
     lseek(fd, 0, SEEK_END);
 
@@ -440,9 +446,11 @@ static int update_control_unlocked(struct playlist_info* playlist,
         result = fdprintf(fd, "F:%u:%u\n", i1, i2);
         break;
     default:
-        return -1;
+        result = -1;
+        break;
     }
 
+    storage_set_origin(origin);
     return result;
 }
 
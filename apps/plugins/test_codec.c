@@ -112,6 +112,17 @@ struct test_track_info {
 
 static struct test_track_info track;
 
+/* Speed test totals per APE compression level (-c1000 to -c5000), so the
+   levels can be compared when a whole directory is tested */
+#define APE_NUM_LEVELS 5
+static struct
+{
+    unsigned long duration;    /* Total file duration in 1/100 s */
+    unsigned long ticks;       /* Total decode time */
+    int files;
+} ape_stats[APE_NUM_LEVELS];
+static int ape_level;
+
 static bool use_dsp;
 
 static bool checksum;
@@ -529,6 +540,22 @@ static void strip_filesize(off_t size)
     ci.filesize = size;
 }
 
+/* No seek index, every run should measure the same decoding work */
+static void seek_index_add(unsigned long time, off_t pos)
+{
+    (void)time;
+    (void)pos;
+}
+
+static bool seek_index_find(unsigned long time, struct seek_point *lo,
+                            struct seek_point *hi)
+{
+    (void)time;
+    (void)lo;
+    (void)hi;
+    return false;
+}
+
 static void init_ci(void)
 {
     /* --- Our "fake" implementations of the codec API functions. --- */
@@ -553,6 +580,8 @@ static void init_ci(void)
     ci.get_command = get_command;
     ci.loop_track = loop_track;
     ci.strip_filesize = strip_filesize;
+    ci.seek_index_add = seek_index_add;
+    ci.seek_index_find = seek_index_find;
 
     /* --- "Core" functions --- */
 
@@ -628,6 +657,55 @@ static void codec_thread(void)
     codec_playing = false;
 }
 
+/* Get the compression level of an APE file from the start of the file,
+   which has to be in audiobuf. Returns 0 if it cannot be determined. */
+static int ape_compression_level(size_t size)
+{
+    const unsigned char *buf = audiobuf;
+    unsigned long pos = 6;
+
+    if (size < 8 || rb->memcmp(buf, "MAC ", 4))
+        return 0;
+
+    /* 3.98 and later files have the level in the header after the
+       descriptor */
+    if ((buf[4] | (buf[5] << 8)) >= 3980)
+    {
+        if (size < 12)
+            return 0;
+        pos = buf[8] | (buf[9] << 8) | (buf[10] << 16) |
+              ((unsigned long)buf[11] << 24);
+    }
+
+    if (pos + 2 > size)
+        return 0;
+
+    return (buf[pos] | (buf[pos+1] << 8)) / 1000;
+}
+
+static void log_ape_stats(void)
+{
+    char str[48];
+    unsigned long speed;
+    int i;
+
+    for (i = 0; i < APE_NUM_LEVELS; i++)
+    {
+        if (ape_stats[i].files == 0)
+            continue;
+
+        if (ape_stats[i].ticks > 0)
+            speed = ape_stats[i].duration * 10000 / ape_stats[i].ticks;
+        else
+            speed = 0;
+
+        rb->snprintf(str, sizeof(str), "APE -c%d: %d.%02d%% realtime (%d)",
+                     (i + 1) * 1000, (int)speed/100, (int)speed%100,
+                     ape_stats[i].files);
+        log_text(str, true);
+    }
+}
+
 static enum plugin_status test_track(const char* filename)
 {
     size_t n;
@@ -686,6 +764,10 @@ static enum plugin_status test_track(const char* filename)
         log_text("Read failed.",true);
         goto exit;
     }
+
+    ape_level = 0;
+    if (track.id3.codectype == AFMT_APE)
+        ape_level = ape_compression_level(n);
     
 
     /* Initialise the function pointers in the codec API */
@@ -761,6 +843,17 @@ static enum plugin_status test_track(const char* filename)
 
         rb->snprintf(str,sizeof(str),"%d.%02d%% realtime",(int)speed/100,(int)speed%100);
         log_text(str,true);
+
+        if (ape_level > 0 && ape_level <= APE_NUM_LEVELS)
+        {
+            rb->snprintf(str,sizeof(str),"APE compression level - %d",
+                         ape_level * 1000);
+            log_text(str,true);
+
+            ape_stats[ape_level-1].duration += duration;
+            ape_stats[ape_level-1].ticks += ticks;
+            ape_stats[ape_level-1].files++;
+        }
         
 #if (CONFIG_PLATFORM & PLATFORM_NATIVE)
         /* show effective clockrate in MHz needed for realtime decoding */
@@ -992,6 +1085,7 @@ menu:
         ch[1]=0;
 
         DEBUGF("Scanning directory \"%s\"\n",dirpath);
+        rb->memset(ape_stats, 0, sizeof(ape_stats));
         dir = rb->opendir(dirpath);
         if (dir) {
             entry = rb->readdir(dir);
@@ -1013,6 +1107,8 @@ menu:
             
             rb->closedir(dir);
         }
+
+        log_ape_stats();
     } else {
         /* Just test the file */
         res = test_track(parameter);
@@ -4,6 +4,12 @@
 /* Explicit path to avoid issues with name clashes (libopus) */
 #include "../firmware/export/config.h"
 
+/* Hosted targets with an FPU run the DSP filtering stages on float samples
+ * rather than Q-format fixed point */
+#if defined(HAVE_FPU) && (CONFIG_PLATFORM & PLATFORM_HOSTED)
+#define HAVE_DSP_FLOAT
+#endif
+
 #ifndef __ASSEMBLER__
 
 /* NULL, offsetof, size_t */
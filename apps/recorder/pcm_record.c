@@ -125,6 +125,13 @@
  * Leave a generous 64k margin for metadata being added to file. */
 #define MAX_NUM_REC_BYTES   ((size_t)0x7fff0000u)
 
+#if (CONFIG_PLATFORM & PLATFORM_NATIVE)
+/* Reserve the file's disk space this far ahead of what was written so the
+ * clusters are allocated in long contiguous runs. Whatever isn't used is
+ * given back when the file is closed. */
+#define STREAM_PREALLOC_SIZE (4*1024*1024)
+#endif
+
 /***************************************************************************/
 extern struct codec_api ci;            /* in codec_thread.c */
 extern struct event_queue audio_queue; /* in audio_thread.c */
@@ -159,6 +166,9 @@ static uint32_t      rec_errors;         /* Mirror of errors but private to
 
 /** Stats on encoded data for current file **/
 static int           rec_fd = -1;        /* Currently open file descriptor */
+#ifdef STREAM_PREALLOC_SIZE
+static off_t         rec_reserved;       /* File size reserved so far      */
+#endif
 static size_t        num_rec_bytes;      /* Number of bytes recorded       */
 static uint64_t      num_rec_samples;    /* Number of PCM samples recorded */
 static uint64_t      encbuf_rec_count;   /* Count of slots written to buffer
@@ -814,6 +824,16 @@ static bool stream_flush_buf(void)
     if (stream_buf_used == 0)
         return true;
 
+#ifdef STREAM_PREALLOC_SIZE
+    off_t pos = lseek(rec_fd, 0, SEEK_CUR);
+    if (pos >= 0 && pos + (off_t)stream_buf_used > rec_reserved)
+    {
+        /* Just a hint; a full disk is reported by the write */
+        rec_reserved = pos + stream_buf_used + STREAM_PREALLOC_SIZE;
+        fpreallocate(rec_fd, rec_reserved);
+    }
+#endif /* STREAM_PREALLOC_SIZE */
+
     ssize_t rc = write(rec_fd, stream_buffer, stream_buf_used);
 
     if (LIKELY(rc == stream_buf_used))
@@ -859,6 +879,9 @@ static bool open_rec_file(bool create)
     stream_discard_buf();
     int oflags = create ? O_CREAT|O_TRUNC : 0;
     rec_fd = open(fname_buf->path, O_RDWR|oflags, 0666);
+#ifdef STREAM_PREALLOC_SIZE
+    rec_reserved = 0;
+#endif
 
     if (rec_fd < 0)
     {
@@ -0,0 +1,366 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Copyright (C) 2026 by the Rockbox contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+
+/* Persistent seek index
+ *
+ * Formats without a usable seek table (VBR MP3 without a TOC, FLAC without
+ * a SEEKTABLE...) can only be seeked by estimation or bisection. While such
+ * a track is played from the start, the codec reports the position of a
+ * frame every now and then and the points are kept in a sorted table. When
+ * the codec later has to seek, it asks for the points around the target and
+ * only has to interpolate between them.
+ *
+ * The table is written to SEEK_INDEX_DIR once the disk spins anyway, merged
+ * with what is already stored for the track, and read back the first time
+ * the track is seeked in. Reading and writing is deferred this way so that
+ * the index never causes a spinup by itself.
+ */
+#include "config.h"
+#include "system.h"
+#include "kernel.h"
+#include "file.h"
+#include "dir.h"
+#include "crc32.h"
+#include "ata_idle_notify.h"
+#include "metadata.h"
+#include "codecs.h"
+#include "seek_index.h"
+#include "string-extra.h"
+#include <stdio.h>
+
+/* Define LOGF_ENABLE to enable logf output in this file */
+/*#define LOGF_ENABLE*/
+#include "logf.h"
+
+/* When the table is full every other point is dropped, so the table covers
+   tracks of any length with gradually less resolution */
+#if MEMORYSIZE <= 2
+#define SEEK_INDEX_POINTS   128
+#else
+#define SEEK_INDEX_POINTS   512
+#endif
+
+#define SEEK_INDEX_MAGIC    0x53494b01 /* "SIK" + version */
+
+struct seek_index_header
+{
+    uint32_t magic;       /* SEEK_INDEX_MAGIC */
+    uint32_t size;        /* Size of the audio data (mp3entry.filesize) */
+    uint32_t offset;      /* Start of the audio data */
+    uint32_t min_gap;     /* Smallest allowed distance between points */
+    uint32_t count;       /* Number of points following the header */
+    char path[MAX_PATH];  /* Track the index belongs to */
+};
+
+struct seek_index
+{
+    struct seek_index_header hdr;
+    struct seek_point points[SEEK_INDEX_POINTS];
+};
+
+/* Variables are commented with the threads that use them:
+ * C=codec, S=storage idle callback */
+static struct seek_index cur_index;     /* (C) Index of the current track */
+static bool cur_dirty = false;          /* (C) Points were added */
+static bool cur_loaded = false;         /* (C) Stored index was merged in */
+
+static struct seek_index save_index;    /* (C,S) Index waiting to be saved */
+static bool save_pending = false;       /* (C,S) save_index must be written */
+static struct mutex save_mutex;         /* Protects save_index */
+
+/* Return the index of the first point later than time */
+static uint32_t index_search(const struct seek_index *idx, uint32_t time)
+{
+    uint32_t lo = 0, hi = idx->hdr.count;
+
+    while (lo < hi)
+    {
+        uint32_t mid = (lo + hi) / 2;
+
+        if (idx->points[mid].time <= time)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/* Drop every other point and don't let the table fill up any faster than
+   it just did */
+static void index_decimate(struct seek_index *idx)
+{
+    struct seek_point *p = idx->points;
+    uint32_t count = idx->hdr.count;
+    uint32_t i, gap;
+
+    for (i = 0; 2*i < count; i++)
+        p[i] = p[2*i];
+
+    idx->hdr.count = i;
+
+    if (i > 1)
+    {
+        gap = (p[i-1].time - p[0].time) / (i - 1);
+        if (gap > idx->hdr.min_gap)
+            idx->hdr.min_gap = gap;
+    }
+}
+
+/* Insert a point unless it is too close to a neighbour or contradicts the
+   order of the points around it. Returns true if the point was added. */
+static bool index_insert(struct seek_index *idx, uint32_t time, uint32_t pos)
+{
+    struct seek_point *p = idx->points;
+    uint32_t i;
+
+    while (1)
+    {
+        i = index_search(idx, time);
+
+        if (i > 0 && (time - p[i-1].time < idx->hdr.min_gap ||
+                      pos <= p[i-1].pos))
+            return false;
+
+        if (i < idx->hdr.count && (p[i].time - time < idx->hdr.min_gap ||
+                                   pos >= p[i].pos))
+            return false;
+
+        if (idx->hdr.count < SEEK_INDEX_POINTS)
+            break;
+
+        index_decimate(idx);
+    }
+
+    memmove(&p[i+1], &p[i], (idx->hdr.count - i) * sizeof (*p));
+    p[i].time = time;
+    p[i].pos = pos;
+    idx->hdr.count++;
+
+    return true;
+}
+
+static void index_filename(char *buf, size_t bufsize, const char *path)
+{
+    snprintf(buf, bufsize, SEEK_INDEX_DIR "/%08lx.idx",
+             (unsigned long)crc_32(path, strlen(path), 0xffffffff));
+}
+
+/* Merge the stored index of the track into idx. Returns the crc of the
+   stored points if there is a valid index file, 0 otherwise. */
+static uint32_t index_load(struct seek_index *idx)
+{
+    struct seek_index_header hdr;
+    struct seek_point buf[32];
+    char filename[MAX_PATH];
+    uint32_t crc = 0;
+    uint32_t count, i;
+    int fd;
+
+    index_filename(filename, sizeof (filename), idx->hdr.path);
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    if (read(fd, &hdr, sizeof (hdr)) != sizeof (hdr) ||
+        hdr.magic != SEEK_INDEX_MAGIC ||
+        hdr.size != idx->hdr.size ||
+        hdr.offset != idx->hdr.offset ||
+        hdr.count > SEEK_INDEX_POINTS ||
+        hdr.path[MAX_PATH-1] != '\0' ||
+        strcmp(hdr.path, idx->hdr.path))
+    {
+        logf("seek index: %s is stale", filename);
+        close(fd);
+        return 0;
+    }
+
+    if (hdr.min_gap > idx->hdr.min_gap)
+        idx->hdr.min_gap = hdr.min_gap;
+
+    crc = 0xffffffff;
+
+    for (count = hdr.count; count > 0; )
+    {
+        uint32_t n = MIN(count, ARRAYLEN(buf));
+        ssize_t size = n * sizeof (buf[0]);
+
+        if (read(fd, buf, size) != size)
+        {
+            crc = 0;
+            break;
+        }
+
+        crc = crc_32(buf, size, crc);
+
+        for (i = 0; i < n; i++)
+            index_insert(idx, buf[i].time, buf[i].pos);
+
+        count -= n;
+    }
+
+    close(fd);
+
+    logf("seek index: loaded %lu points", (unsigned long)hdr.count);
+    return crc;
+}
+
+static void index_save(struct seek_index *idx)
+{
+    char filename[MAX_PATH];
+    ssize_t size;
+    uint32_t crc;
+    int fd;
+
+    crc = index_load(idx);
+
+    size = idx->hdr.count * sizeof (idx->points[0]);
+    if (crc != 0 && crc == crc_32(idx->points, size, 0xffffffff))
+        return; /* Nothing new */
+
+    index_filename(filename, sizeof (filename), idx->hdr.path);
+
+    fd = open(filename, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (fd < 0)
+    {
+        mkdir(SEEK_INDEX_DIR);
+        fd = open(filename, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+        if (fd < 0)
+            return;
+    }
+
+    if (write(fd, &idx->hdr, sizeof (idx->hdr)) != sizeof (idx->hdr) ||
+        write(fd, idx->points, size) != size)
+    {
+        logf("seek index: error writing %s", filename);
+        close(fd);
+        remove(filename);
+        return;
+    }
+
+    close(fd);
+    logf("seek index: saved %lu points", (unsigned long)idx->hdr.count);
+}
+
+/* Storage idle callback */
+static void seek_index_flush(void)
+{
+    mutex_lock(&save_mutex);
+
+    if (save_pending)
+    {
+        save_pending = false;
+        index_save(&save_index);
+    }
+
+    mutex_unlock(&save_mutex);
+}
+
+void seek_index_open(const struct mp3entry *id3)
+{
+    /* The codec is run again after seeking in a finished track */
+    if (cur_index.hdr.size == id3->filesize &&
+        cur_index.hdr.offset == id3->first_frame_offset &&
+        !strcmp(cur_index.hdr.path, id3->path))
+        return;
+
+    cur_index.hdr.magic = SEEK_INDEX_MAGIC;
+    cur_index.hdr.size = id3->filesize;
+    cur_index.hdr.offset = id3->first_frame_offset;
+    cur_index.hdr.min_gap = 1;
+    cur_index.hdr.count = 0;
+    memset(cur_index.hdr.path, 0, MAX_PATH);
+    strmemccpy(cur_index.hdr.path, id3->path, MAX_PATH);
+
+    cur_dirty = false;
+    cur_loaded = false;
+}
+
+void seek_index_close(void)
+{
+    if (!cur_dirty)
+        return;
+
+    cur_dirty = false;
+
+    mutex_lock(&save_mutex);
+    /* Whatever was still waiting gets replaced; it was built while the disk
+       did not spin up for a whole track, which is not worth waking it for */
+    save_index.hdr = cur_index.hdr;
+    memcpy(save_index.points, cur_index.points,
+           cur_index.hdr.count * sizeof (cur_index.points[0]));
+    save_pending = true;
+    mutex_unlock(&save_mutex);
+
+    register_storage_idle_func(seek_index_flush);
+}
+
+void seek_index_add(unsigned long time, off_t pos)
+{
+    if (index_insert(&cur_index, time, pos))
+        cur_dirty = true;
+}
+
+bool seek_index_find(unsigned long time, struct seek_point *lo,
+                     struct seek_point *hi)
+{
+    bool changed = false;
+    uint32_t i;
+
+    if (!cur_loaded)
+    {
+        cur_loaded = true;
+        index_load(&cur_index);
+
+        /* Pick up what is still waiting to be written for the same track */
+        mutex_lock(&save_mutex);
+        if (save_pending && save_index.hdr.size == cur_index.hdr.size &&
+            !strcmp(save_index.hdr.path, cur_index.hdr.path))
+        {
+            for (i = 0; i < save_index.hdr.count; i++)
+                index_insert(&cur_index, save_index.points[i].time,
+                             save_index.points[i].pos);
+        }
+        mutex_unlock(&save_mutex);
+    }
+
+    i = index_search(&cur_index, time);
+
+    if (i > 0 && cur_index.points[i-1].time > lo->time)
+    {
+        *lo = cur_index.points[i-1];
+        changed = true;
+    }
+
+    if (i < cur_index.hdr.count && cur_index.points[i].time < hi->time)
+    {
+        *hi = cur_index.points[i];
+        changed = true;
+    }
+
+    return changed;
+}
+
+void INIT_ATTR seek_index_init(void)
+{
+    mutex_init(&save_mutex);
+}
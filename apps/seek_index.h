@@ -0,0 +1,44 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Copyright (C) 2026 by the Rockbox contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#ifndef _SEEK_INDEX_H_
+#define _SEEK_INDEX_H_
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/* Per-track seek indexes are kept here, one file per track */
+#define SEEK_INDEX_DIR ROCKBOX_DIR "/seekidx"
+
+struct mp3entry;
+struct seek_point;
+
+void seek_index_init(void);
+
+/* Called by the codec thread around each run of the codec */
+void seek_index_open(const struct mp3entry *id3);
+void seek_index_close(void);
+
+/* Implementation of the codec API calls */
+void seek_index_add(unsigned long time, off_t pos);
+bool seek_index_find(unsigned long time, struct seek_point *lo,
+                     struct seek_point *hi);
+
+#endif /* _SEEK_INDEX_H_ */
@@ -585,9 +585,13 @@ static bool settings_write_config(const char* filename, int options)
     int i;
     int fd;
     char value[MAX_PATH];
+    int origin = storage_set_origin(STORAGE_ORIGIN_SETTINGS);
     fd = open(filename,O_CREAT|O_TRUNC|O_WRONLY, 0666);
     if (fd < 0)
+    {
+        storage_set_origin(origin);
         return false;
+    }
 
     if (options != SETTINGS_SAVE_RESUMEINFO)
     {
@@ -651,6 +655,7 @@ static bool settings_write_config(const char* filename, int options)
     }
 #endif
     close(fd);
+    storage_set_origin(origin);
     return true;
 }
 
@@ -1075,6 +1080,7 @@ void settings_apply(bool read_disk)
     dsp_timestretch_enable(global_settings.timestretch_enabled);
 #endif
     dsp_set_compressor(&global_settings.compressor_settings);
+    dsp_set_limiter(&global_settings.limiter_settings);
 
 #ifdef HAVE_SPDIF_POWER
     spdif_power_enable(global_settings.spdif_enable);
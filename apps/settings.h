@@ -187,6 +187,11 @@ enum { SCROLLBAR_OFF = 0, SCROLLBAR_LEFT, SCROLLBAR_RIGHT };
 enum { AUTORESUME_NEXTTRACK_NEVER = 0, AUTORESUME_NEXTTRACK_ALWAYS,
        AUTORESUME_NEXTTRACK_CUSTOM};
 
+/* background loudness measurement */
+#ifdef HAVE_LOUDNESS_SCAN
+enum { LOUDNESS_SCAN_OFF = 0, LOUDNESS_SCAN_CHARGING, LOUDNESS_SCAN_IDLE };
+#endif
+
 /* Alarm settings */
 #ifdef HAVE_RTC_ALARM
 enum {  ALARM_START_WPS = 0,
@@ -631,6 +636,10 @@ struct user_settings
                                  2=custom */
     unsigned char autoresume_paths[MAX_PATHLIST+1]; /* colon-separated list */
     bool runtimedb;           /* runtime database active? */
+#ifdef HAVE_LOUDNESS_SCAN
+    int loudness_scan;        /* measure loudness of untagged tracks:
+                                 0=off, 1=while charging, 2=when idle */
+#endif
     unsigned char tagcache_scan_paths[MAX_PATHLIST+1];
     unsigned char tagcache_db_path[MAX_PATHNAME+1];
 #endif /* HAVE_TAGCACHE */
@@ -839,6 +848,7 @@ struct user_settings
 #endif
 
     struct compressor_settings compressor_settings;
+    struct limiter_settings limiter_settings;
 
     int sleeptimer_duration; /* In minutes; 0=off */
     bool sleeptimer_on_startup;
@@ -647,6 +647,18 @@ static void compressor_set(int val)
     dsp_set_compressor(&global_settings.compressor_settings);
 }
 
+static void limiter_set(int val)
+{
+    (void)val;
+    dsp_set_limiter(&global_settings.limiter_settings);
+}
+
+static void limiter_enable(bool enable)
+{
+    (void)enable;
+    dsp_set_limiter(&global_settings.limiter_settings);
+}
+
 static const char* db_format(char* buffer, size_t buffer_size, int value,
                       const char* unit)
 {
@@ -1753,6 +1765,15 @@ const struct settings_list settings[] = {
 
     OFFON_SETTING(0, runtimedb, LANG_RUNTIMEDB_ACTIVE, false,
                   "gather runtime data", NULL),
+#ifdef HAVE_LOUDNESS_SCAN
+    CHOICE_SETTING(0, loudness_scan, LANG_LOUDNESS_SCAN,
+                   LOUDNESS_SCAN_CHARGING,
+                   "measure loudness", "off,charging,idle",
+                   NULL, 3,
+                   ID2P(LANG_OFF),
+                   ID2P(LANG_LOUDNESS_SCAN_CHARGING),
+                   ID2P(LANG_LOUDNESS_SCAN_IDLE)),
+#endif
     TEXT_SETTING(0, tagcache_scan_paths, "database scan paths",
                  DEFAULT_TAGCACHE_SCAN_PATHS, NULL, NULL),
     TEXT_SETTING(0, tagcache_db_path, "database path",
@@ -1926,6 +1947,20 @@ const struct settings_list settings[] = {
                        "compressor release time", UNIT_MS, 100, 1000,
                        100, NULL, NULL, compressor_set),
 
+    /* limiter */
+    OFFON_SETTING(F_SOUNDSETTING, limiter_settings.enabled, LANG_LIMITER,
+                  false, "limiter enabled", limiter_enable),
+    INT_SETTING_NOWRAP(F_SOUNDSETTING, limiter_settings.ceiling,
+                       LANG_LIMITER_CEILING, -10,
+                       "limiter ceiling", UNIT_DB, -60, 0,
+                       1, db_format, get_dec_talkid, limiter_set),
+    INT_SETTING_NOWRAP(F_TIME_SETTING | F_SOUNDSETTING,
+                       limiter_settings.lookahead,
+                       LANG_LIMITER_LOOKAHEAD, 5,
+                       "limiter lookahead", UNIT_MS,
+                       LIMITER_LOOKAHEAD_MIN, LIMITER_LOOKAHEAD_MAX,
+                       1, NULL, NULL, limiter_set),
+
 #ifdef AUDIOHW_HAVE_BASS_CUTOFF
     SOUND_SETTING(F_NO_WRAP, bass_cutoff, LANG_BASS_CUTOFF,
                   "bass cutoff", SOUND_BASS_CUTOFF),
@@ -91,6 +91,10 @@
 #ifndef __PCTOOL__
 #include "lang.h"
 #include "eeprom_settings.h"
+#include "storage.h"
+#endif
+#ifdef HAVE_LOUDNESS_SCAN
+#include "loudness_scan.h"
 #endif
 #define USR_CANCEL false
 #else/*!defined(PLUGIN)*/
@@ -113,10 +117,10 @@
 #define IDX_BUF_DEPTH 64
 
 /* Tag Cache Header version 'TCHxx'. Increment when changing internal structures. */
-#define TAGCACHE_MAGIC  0x54434810
+#define TAGCACHE_MAGIC  0x54434811
 
 /* Dump store/restore header version 'TCSxx'. */
-#define TAGCACHE_STATEFILE_MAGIC 0x54435301
+#define TAGCACHE_STATEFILE_MAGIC 0x54435302
 
 /* How much to allocate extra space for ramcache. */
 #define TAGCACHE_RESERVE 32768
@@ -185,6 +189,11 @@ static long tagcache_stack[(DEFAULT_STACK_SIZE + 0x4000)/sizeof(long)];
 static const char tagcache_thread_name[] = "tagcache";
 #endif
 
+#ifdef HAVE_LOUDNESS_SCAN
+/* Next entry to check for a loudness measurement */
+static long loudness_scan_idx = 0;
+#endif
+
 /* Previous path when scanning directory tree recursively. */
 static char curpath[TAGCACHE_BUFSZ];
 /* Shared buffer for several build_index fns to reduce stack usage */
@@ -222,7 +231,7 @@ static const char * const tags_str[] = { "artist", "album", "genre", "title",
     "filename", "composer", "comment", "albumartist", "grouping", "year",
     "discnumber", "tracknumber", "canonicalartist", "bitrate", "length",
     "playcount", "rating", "playtime", "lastplayed", "commitid", "mtime",
-    "lastelapsed", "lastoffset"
+    "lastelapsed", "lastoffset", "loudness", "truepeak"
 #if !defined(LOGF_ENABLE) || !defined(LOGF_CLAUSES)
 };
 #define logf_clauses(...) do { } while(0)
@@ -2807,6 +2816,8 @@ static bool build_numeric_indices(struct tagcache_header *h, int tmpfd)
                 tmpdb_copy_tag(tag_commitid);
                 tmpdb_copy_tag(tag_lastelapsed);
                 tmpdb_copy_tag(tag_lastoffset);
+                tmpdb_copy_tag(tag_loudness);
+                tmpdb_copy_tag(tag_truepeak);
 
                 /* Avoid processing this entry again. */
                 idx.flag |= FLAG_RESURRECTED;
@@ -3571,6 +3582,11 @@ static bool commit(void)
             tagcache_start_scan();
 #endif /* HAVE_TC_RAMCACHE */
 
+#ifdef HAVE_LOUDNESS_SCAN
+        /* Look for new entries to measure */
+        loudness_scan_idx = 0;
+#endif
+
         rc = true;
     } /*!USR_CANCEL*/
 
@@ -5268,10 +5284,65 @@ static bool NO_INLINE db_file_exists(const char* filename)
     return file_exists(buf);
 }
 
+#ifdef HAVE_LOUDNESS_SCAN
+static bool loudness_scan_stop(void)
+{
+    return !queue_empty(&tagcache_queue) || !loudness_scan_allowed();
+}
+
+/* Measure the loudness of the next entry that hasn't been measured yet */
+static void loudness_scan_next(void)
+{
+    struct tagcache_search tcs;
+    struct index_entry idx;
+    char buf[TAGCACHE_BUFSZ];
+    long idx_id = -1;
+    long loudness, peak;
+
+    if (!loudness_scan_allowed() || !tagcache_search(&tcs, tag_filename))
+        return;
+
+    while (loudness_scan_idx < current_tcmh.tch.entry_count)
+    {
+        long i = loudness_scan_idx++;
+
+        if (get_index(tcs.masterfd, i, &idx, true) &&
+            idx.tag_seek[tag_truepeak] == LOUDNESS_PEAK_UNMEASURED &&
+            tagcache_retrieve(&tcs, i, tag_filename, buf, sizeof(buf)))
+        {
+            idx_id = i;
+            break;
+        }
+
+        if (!queue_empty(&tagcache_queue))
+            break;
+
+        do_timed_yield();
+    }
+
+    /* Don't keep the database locked while decoding */
+    tagcache_search_finish(&tcs);
+
+    if (idx_id < 0)
+        return;
+
+    if (!loudness_scan_track(buf, &loudness, &peak, loudness_scan_stop))
+    {
+        /* Interrupted, start over with it next time */
+        loudness_scan_idx = idx_id;
+        return;
+    }
+
+    tagcache_update_numeric(idx_id, tag_loudness, loudness);
+    tagcache_update_numeric(idx_id, tag_truepeak, peak);
+}
+#endif /* HAVE_LOUDNESS_SCAN */
+
 static void tagcache_thread(void)
 {
     struct queue_event ev;
     bool check_done = false;
+    storage_set_origin(STORAGE_ORIGIN_TAGCACHE);
     cpu_boost(true);
     /* If the previous cache build/update was interrupted, commit
      * the changes first in foreground. */
@@ -5348,6 +5419,10 @@ static void tagcache_thread(void)
                 check_done = false;
                 /* fallthrough */
             case SYS_TIMEOUT:
+#ifdef HAVE_LOUDNESS_SCAN
+                if (check_done && tc_stat.ready)
+                    loudness_scan_next();
+#endif
                 if (check_done || !tc_stat.ready)
                     break ;
 
@@ -5501,6 +5576,9 @@ void tagcache_init(void)
                sizeof(tc_stat.db_path));
     mutex_init(&command_queue_mutex);
     queue_init(&tagcache_queue, true);
+#ifdef HAVE_LOUDNESS_SCAN
+    loudness_scan_init();
+#endif
     create_thread(tagcache_thread, tagcache_stack,
                   sizeof(tagcache_stack), 0, tagcache_thread_name
                   IF_PRIO(, PRIORITY_BACKGROUND)
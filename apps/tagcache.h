@@ -35,7 +35,7 @@ enum tag_type { tag_artist = 0, tag_album, tag_genre, tag_title,
     tag_filename, tag_composer, tag_comment, tag_albumartist, tag_grouping, tag_year,
     tag_discnumber, tag_tracknumber, tag_virt_canonicalartist, tag_bitrate, tag_length,
     tag_playcount, tag_rating, tag_playtime, tag_lastplayed, tag_commitid, tag_mtime,
-    tag_lastelapsed, tag_lastoffset,
+    tag_lastelapsed, tag_lastoffset, tag_loudness, tag_truepeak,
     /* Real tags end here, count them. */
     TAG_COUNT,
     /* Virtual tags */
@@ -64,6 +64,7 @@ enum tag_type { tag_artist = 0, tag_album, tag_genre, tag_title,
     (1LU << tag_playcount) | (1LU << tag_rating) | (1LU << tag_playtime) | \
     (1LU << tag_lastplayed) | (1LU << tag_commitid) | (1LU << tag_mtime) | \
     (1LU << tag_lastelapsed) | (1LU << tag_lastoffset) | \
+    (1LU << tag_loudness) | (1LU << tag_truepeak) | \
     (1LU << tag_virt_length_min) | (1LU << tag_virt_length_sec) | \
     (1LU << tag_virt_playtime_min) | (1LU << tag_virt_playtime_sec) | \
     (1LU << tag_virt_entryage) | (1LU << tag_virt_autoscore))
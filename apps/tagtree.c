@@ -393,6 +393,8 @@ static int get_tag(int *tag)
         TAG_MATCH("grouping", tag_grouping) \
         TAG_MATCH("entryage", tag_virt_entryage) \
         TAG_MATCH("commitid", tag_commitid) \
+        TAG_MATCH("loudness", tag_loudness) \
+        TAG_MATCH("truepeak", tag_truepeak) \
         TAG_MATCH("%include", var_include) \
         TAG_MATCH("playcount", tag_playcount) \
         TAG_MATCH("autoscore", tag_virt_autoscore) \
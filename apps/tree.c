@@ -1211,6 +1211,8 @@ void tree_mem_init(void)
     cache->max_entries = global_settings.max_files_in_dir;
     cache->entries_handle =
             core_alloc_ex(cache->max_entries*(sizeof(struct entry)), &ops);
+
+    ft_mem_init();
 }
 
 bool bookmark_play(char *resume_file, int index, unsigned long elapsed,
@@ -1342,21 +1344,21 @@ void tree_flush(void)
 
 #ifdef HAVE_DIRCACHE
     int old_val = global_status.dircache_size;
-#ifdef HAVE_EEPROM_SETTINGS
-    bool savecache = false;
-#endif
 
     if (global_settings.dircache)
     {
+    #ifdef DIRCACHE_SNAPSHOT
+        /* suspending throws the cache away so save it first; it's checked
+           against the disk when it's loaded */
+        dircache_save();
+    #endif
+
         dircache_suspend();
 
         struct dircache_info info;
         dircache_get_info(&info);
 
         global_status.dircache_size = info.last_size;
-    #ifdef HAVE_EEPROM_SETTINGS
-        savecache = firmware_settings.initialized;
-    #endif
     }
     else
     {
@@ -1365,11 +1367,6 @@ void tree_flush(void)
 
     if (old_val != global_status.dircache_size)
         status_save(true);
-
-    #ifdef HAVE_EEPROM_SETTINGS
-        if (savecache)
-            dircache_save();
-    #endif
 #endif /* HAVE_DIRCACHE */
 }
 
@@ -312,6 +312,31 @@ int samedir(DIR *dirp1, DIR *dirp2)
     return rc;
 }
 
+/* get the serial number of the latest change to any directory's entries */
+unsigned int dir_get_serial(void)
+{
+    file_internal_lock_READER();
+    unsigned int serial = fileobj_mgr_change_serial();
+    file_internal_unlock_READER();
+    return serial;
+}
+
+/* returns true if the directory's entries may have changed since 'serial'
+   was obtained from dir_get_serial(); errors count as changed */
+bool dir_changed_since(DIR *dirp, unsigned int serial)
+{
+    struct dirstr_desc * const dir = GET_DIRSTR(READER, dirp);
+    if (!dir)
+        return true;
+
+    /* with root contents not mounted there is only the volume list */
+    bool changed = fileobj_mgr_dir_changed(
+        (dir->stream.flags & FDO_BUSY) ? dir->stream.infop : NULL, serial);
+
+    RELEASE_DIRSTR(READER, dir);
+    return changed;
+}
+
 /* test directory existence (returns 'false' if a file) */
 bool dir_exists(const char *dirname)
 {
@@ -25,6 +25,7 @@
 #include "string-extra.h"
 #include <stdbool.h>
 #include <stdlib.h>
+#include <ctype.h>
 #include "debug.h"
 #include "system.h"
 #include "logf.h"
@@ -52,7 +53,8 @@
  * |xxxxxx|rrrrrrrrr|0|dddddd|0|
  *
  * Subsequent x are allocated from the front, d are allocated from the back,
- * using the reserve buffer for entries added after initial scan.
+ * using the reserve buffer for entries added after initial scan. The name
+ * hashes of large directories are allocated among the names.
  *
  * After a while the cache may look like:
  * |xxxxxxxx|rrrrr|0|dddddddd|0|
@@ -212,7 +214,7 @@ static struct dircache
     size_t       sizeused;            /* bytes of .size bytes actually used */
     union {
     unsigned int numentries;          /* entry count (including holes) */
-#ifdef HAVE_EEPROM_SETTINGS
+#ifdef DIRCACHE_SNAPSHOT
     size_t       sizeentries;         /* used when persisting */
 #endif
     };
@@ -220,6 +222,16 @@ static struct dircache
     size_t       sizenames;           /* size of all names (including holes) */
     size_t       namesfree;           /* amount of wasted name space */
     int          nextnamefree;        /* hint of next free name in buffer */
+    /* name hashes of large directories */
+    struct dircache_hash
+    {
+        int            diridx;        /* hashed directory (0 if unused) */
+        int            table;         /* name index of the bucket array */
+        uint32_t       size    : 31;  /* number of buckets (power of 2) */
+        uint32_t       partial :  1;  /* not every name is in the table */
+        uint32_t       used;          /* stamp of last use */
+    } hashes[DIRCACHE_NUM_HASHES];
+    uint32_t     hashstamp;           /* last stamp of hash use */
     /* per-volume data */
     struct dircache_volume            /* per volume cache data */
     {
@@ -246,6 +258,8 @@ static struct dircache_runinfo
     bool         enabled;          /* dircache master enable switch */
     unsigned int thread_id;        /* current/last thread id */
     bool         thread_done;      /* thread has exited */
+    dc_serial_t  loadserial;       /* entries with serial numbers up to this
+                                      came with a loaded cache (0 if none) */
     /* cache buffer info */
     int          handle;           /* buflib buffer handle */
     size_t       bufsize;          /* size of buflib allocation - 1 */
@@ -287,6 +301,7 @@ static struct dircache_runinfo
 
 #define DCRIVOL_i(i)             (&dircache_runinfo.dcrivol[i])
 #define DCRIVOL_infop(infop)     (&dircache_runinfo.dcrivol[BASEINFO_VOL(infop)])
+#define DCRIVOL_dirinfop(dirinfop) (&dircache_runinfo.dcrivol[BASEINFO_VOL(dirinfop)])
 #define DCRIVOL_bindp(bindp)     (&dircache_runinfo.dcrivol[BASEBINDING_VOL(bindp)])
 #define DCRIVOL(x)               DCRIVOL_##x(x)
 
@@ -294,7 +309,7 @@ static struct dircache_runinfo
 #define DIRCACHE_STUFFED(reserve_used) \
     ((reserve_used) > 3*DIRCACHE_RESERVE / 4)
 
-#ifdef HAVE_EEPROM_SETTINGS
+#ifdef DIRCACHE_SNAPSHOT
 /**
  * remove the snapshot file
  */
@@ -310,7 +325,7 @@ static int open_dircache_file(int oflag)
 {
     return open(DIRCACHE_FILE, oflag, 0666);
 }
-#endif /* HAVE_EEPROM_SETTINGS */
+#endif /* DIRCACHE_SNAPSHOT */
 
 #ifdef DIRCACHE_DUMPSTER
 /**
@@ -737,6 +752,24 @@ static void entry_name_copy(char *dst, const struct dircache_entry *ce)
     *dst = '\0';
 }
 
+/**
+ * compare the entry's name with a name read from the storage
+ */
+static bool entry_name_equal(const struct dircache_entry *ce,
+                             const char *name)
+{
+    size_t len = strlen(name);
+
+    if (LIKELY(!ce->tinyname))
+    {
+        return len == CE_NAMESIZE(ce->namelen) &&
+               !memcmp(get_name(ce->name), name, len);
+    }
+
+    return len <= MAX_TINYNAME &&
+           !strncmp((const char *)ce->namebuf, name, MAX_TINYNAME);
+}
+
 /**
  * set the namesfree hint to a new position
  */
@@ -751,9 +784,9 @@ static void set_namesfree_hint(const unsigned char *hintp)
 }
 
 /**
- * allocate a buffer to use for a new name
+ * allocate a buffer for a new name from the free gaps between names
  */
-static int alloc_name(size_t size)
+static int alloc_name_gap(size_t size)
 {
     int nameidx = 0;
 
@@ -823,21 +856,40 @@ static int alloc_name(size_t size)
         }
     }
 
+    return nameidx;
+}
+
+/**
+ * allocate a buffer for a new name from the unused space
+ */
+static int alloc_name_new(size_t size)
+{
+    if (dircache_buf_remaining() <= size)
+    {
+        dircache.last_size = 0;
+        return 0;
+    }
+
+    dircache.names     -= size;
+    dircache.sizenames += size;
+    dircache.size      += size;
+    dircache.sizeused  += size;
+    *get_name(dircache.names - 1) = 0;
+
+    return dircache.names;
+}
+
+/**
+ * allocate a buffer to use for a new name
+ */
+static int alloc_name(size_t size)
+{
+    int nameidx = alloc_name_gap(size);
+
     if (!nameidx)
     {
         /* no sufficiently long free gaps; allocate anew */
-        if (dircache_buf_remaining() <= size)
-        {
-            dircache.last_size = 0;
-            return 0;
-        }
-
-        dircache.names     -= size;
-        dircache.sizenames += size;
-        nameidx             = dircache.names;
-        dircache.size      += size;
-        dircache.sizeused  += size;
-        *get_name(dircache.names - 1) = 0;
+        nameidx = alloc_name_new(size);
     }
 
     return nameidx;
@@ -938,6 +990,218 @@ static int entry_reassign_name(struct dircache_entry *ce,
     return entry_assign_name(ce, newname, newlen);
 }
 
+/**
+ * Name hashes:
+ * A directory with many entries is given an open-addressed table of the
+ * indexes of its entries, placed by a hash of their names, the first time a
+ * name is looked up in it while it is complete. Any change to the directory's
+ * contents frees the table, to be built again on the next lookup.
+ *
+ * The buckets are allocated among the names, so they must never read as free
+ * name space (0xff) or a claimed tiny block (0xfe); each one holds an entry
+ * index spread 7 bits to a byte.
+ */
+#define HASH_BUCKETSIZE 4
+
+static inline int hash_get_bucket(const unsigned char *table, unsigned int b)
+{
+    const unsigned char *p = &table[b*HASH_BUCKETSIZE];
+    return p[0] | p[1] << 7 | p[2] << 14 | p[3] << 21;
+}
+
+static inline void hash_set_bucket(unsigned char *table, unsigned int b,
+                                   int idx)
+{
+    unsigned char *p = &table[b*HASH_BUCKETSIZE];
+    p[0] = idx & 0x7f;
+    p[1] = (idx >> 7) & 0x7f;
+    p[2] = (idx >> 14) & 0x7f;
+    p[3] = (idx >> 21) & 0x7f;
+}
+
+/**
+ * hash a name the way strcasecmp() compares it
+ */
+static uint32_t hash_name(const char *name)
+{
+    /* FNV-1a */
+    uint32_t h = 0x811c9dc5;
+    while (*name)
+        h = (h ^ (unsigned char)tolower(*name++)) * 0x01000193;
+
+    return h;
+}
+
+/**
+ * return the name hash of the directory (NULL if it has none)
+ */
+static struct dircache_hash * get_dir_hash(int diridx)
+{
+    if (diridx == 0)
+        return NULL;
+
+    for (int i = 0; i < DIRCACHE_NUM_HASHES; i++)
+    {
+        if (dircache.hashes[i].diridx == diridx)
+            return &dircache.hashes[i];
+    }
+
+    return NULL;
+}
+
+/**
+ * free the name hash of the directory, if it has one; call whenever its
+ * contents change
+ */
+static void hash_discard(int diridx)
+{
+    struct dircache_hash *dchp = get_dir_hash(diridx);
+    if (!dchp)
+        return;
+
+    free_name(dchp->table, dchp->size*HASH_BUCKETSIZE);
+    dchp->diridx = 0;
+}
+
+/**
+ * make a name hash for the directory; returns NULL if it is too small to
+ * bother with or there isn't room
+ */
+static struct dircache_hash * hash_build(int diridx, int down)
+{
+    unsigned int count = 0;
+    for (int idx = down; idx; idx = get_entry(idx)->next)
+        count++;
+
+    if (count < DIRCACHE_HASH_MIN)
+        return NULL;
+
+    /* keep it at most 2/3 full */
+    unsigned int size = DIRCACHE_HASH_MIN;
+    while (size < count + count / 2)
+        size *= 2;
+
+    /* take the least recently used slot */
+    struct dircache_hash *dchp = &dircache.hashes[0];
+    for (int i = 0; i < DIRCACHE_NUM_HASHES; i++)
+    {
+        struct dircache_hash *p = &dircache.hashes[i];
+        if (!p->diridx)
+        {
+            dchp = p;
+            break;
+        }
+
+        if (p->used < dchp->used)
+            dchp = p;
+    }
+
+    hash_discard(dchp->diridx);
+
+    /* use a gap if there is one; otherwise only take from the reserve what
+       leaves enough of it for new entries */
+    size_t bytes = size*HASH_BUCKETSIZE;
+    int nameidx = alloc_name_gap(bytes);
+    if (!nameidx && dircache_buf_remaining() >= bytes + DIRCACHE_RESERVE / 2)
+        nameidx = alloc_name_new(bytes);
+
+    if (!nameidx)
+        return NULL;
+
+    unsigned char *table = get_name(nameidx);
+    memset(table, 0, bytes);
+
+    bool partial = false;
+    char name[DC_MAX_NAME + 1];
+
+    for (int idx = down; idx;)
+    {
+        struct dircache_entry *ce = get_entry(idx);
+        entry_name_copy(name, ce);
+
+    #ifdef HAVE_FILESYSTEM_CODEPAGE
+        /* lookups would compare the codepage-decoded short name; leave those
+           that decoding would change to a scan */
+        if (ce->direntries == 1 && !is_dotdir_name(name))
+        {
+            const unsigned char *p = (const unsigned char *)name;
+            while (*p && *p < 0x80)
+                p++;
+
+            if (*p)
+            {
+                partial = true;
+                idx = ce->next;
+                continue;
+            }
+        }
+    #endif /* HAVE_FILESYSTEM_CODEPAGE */
+
+        /* if names collide, the first stays first just as in a scan */
+        unsigned int b = hash_name(name) & (size - 1);
+        while (hash_get_bucket(table, b))
+            b = (b + 1) & (size - 1);
+
+        hash_set_bucket(table, b, idx);
+        idx = ce->next;
+    }
+
+    dchp->diridx  = diridx;
+    dchp->table   = nameidx;
+    dchp->size    = size;
+    dchp->partial = partial;
+    return dchp;
+}
+
+/**
+ * look up a name in a directory whose contents are complete
+ *
+ * returns: > 0 = index of the entry
+ *            0 = no such entry
+ *          < 0 = couldn't tell; the directory has to be scanned
+ */
+static int hash_find(int diridx, const char *name)
+{
+    int *downp = get_downidxp(diridx);
+    if (!downp)
+        return -1;
+
+    struct dircache_hash *dchp = get_dir_hash(diridx);
+    if (!dchp && !(dchp = hash_build(diridx, *downp)))
+        return -1;
+
+    dchp->used = ++dircache.hashstamp;
+
+    const unsigned char *table = get_name(dchp->table);
+    unsigned int mask = dchp->size - 1;
+    char cename[DC_MAX_NAME + 1];
+
+    for (unsigned int b = hash_name(name) & mask;; b = (b + 1) & mask)
+    {
+        int idx = hash_get_bucket(table, b);
+        if (!idx)
+            break;
+
+        entry_name_copy(cename, get_entry(idx));
+        if (!strcasecmp(name, cename))
+            return idx;
+    }
+
+    return dchp->partial ? -1 : 0;
+}
+
+/**
+ * adjust the name hashes' table indexes after the names moved
+ */
+static void hash_move_tables(ptrdiff_t offset)
+{
+    for (int i = 0; i < DIRCACHE_NUM_HASHES; i++)
+    {
+        if (dircache.hashes[i].diridx)
+            dircache.hashes[i].table += offset;
+    }
+}
+
 /**
  * allocate a dircache_entry from memory using freed ones if available
  */
@@ -1008,6 +1272,7 @@ static void free_orphan_entry(struct dircache_runinfo_volume *dcrivolp,
     }
 
     entry_unassign_name(ce);
+    hash_discard(idx);
 
     /* no serialnum says "it's free" (for cache-wide iterators) */
     ce->serialnum = 0;
@@ -1050,6 +1315,7 @@ static void remove_entry(struct dircache_runinfo_volume *dcrivolp,
 {
     /* unlink it from its list */
     *prevp = ce->next;
+    hash_discard(ce->up);
 
     if (dcrivolp)
     {
@@ -1080,6 +1346,32 @@ static void free_subentries(struct dircache_runinfo_volume *dcrivolp, int *downp
     }
 }
 
+/**
+ * did the entry come with a loaded cache and has the scan yet to find it on
+ * the storage? such an entry may be stale and is never handed out
+ */
+static inline bool entry_is_loaded(const struct dircache_entry *ce)
+{
+    return ce->serialnum <= dircache_runinfo.loadserial;
+}
+
+/**
+ * free the loaded entry at *prevp, and its children, that is no longer on the
+ * storage
+ */
+static void free_loaded_entry(struct dircache_runinfo_volume *dcrivolp,
+                              int *prevp)
+{
+    int idx = *prevp;
+    struct dircache_entry *ce = get_entry(idx);
+
+    if ((ce->attr & ATTR_DIRECTORY) && ce->down)
+        free_subentries(dcrivolp, &ce->down);
+
+    remove_entry(dcrivolp, ce, prevp);
+    free_orphan_entry(dcrivolp, ce, idx);
+}
+
 /**
  * free the specified file entry and its children
  */
@@ -1133,6 +1425,13 @@ static void insert_file_entry(struct file_base_info *dirinfop,
         if (nextce->direntry > ce->direntry)
             break;
 
+        if (nextce->direntry == ce->direntry && entry_is_loaded(nextce))
+        {
+            /* whatever was loaded for this slot isn't there any more */
+            free_loaded_entry(DCRIVOL(dirinfop), nextp);
+            continue;
+        }
+
         /* now, nothing should be equal to ours or that is a bug since it
            would already exist (and it shouldn't because it's just been
            created or moved) */
@@ -1144,6 +1443,7 @@ static void insert_file_entry(struct file_base_info *dirinfop,
     ce->up   = diridx;
     ce->next = *nextp;
     *nextp   = get_index(ce);
+    hash_discard(diridx);
 }
 
 /**
@@ -1162,6 +1462,10 @@ static struct dircache_entry * remove_file_entry(struct file_base_info *infop)
  */
 static void establish_frontier(int idx, uint32_t code)
 {
+    /* only complete directories are looked up by hash */
+    if (code != FRONTIER_SETTLED)
+        hash_discard(idx);
+
     if (idx < 0)
     {
         int volume = IF_MV_VOL(-idx - 1);
@@ -1226,6 +1530,36 @@ static void process_events(void)
 }
 
 #if defined (DIRCACHE_NATIVE)
+/**
+ * check a loaded entry against what the scan read from the storage in its
+ * slot; if it's the same file, bring the details that change with its
+ * contents up to date and make it a known entry
+ */
+static bool sab_check_loaded(struct dircache_entry *ce,
+                             const struct fat_direntry *fatentp,
+                             const struct file_base_info *infop)
+{
+    /* FAT doesn't stamp a directory when its contents change so a directory
+       is only known to be the same one here; its contents are checked when
+       the scan gets to it */
+    if (ce->direntries != infop->fatfile.e.entries ||
+        ce->firstcluster != fatentp->firstcluster ||
+        ((ce->attr ^ fatentp->attr) & ATTR_DIRECTORY) ||
+        !entry_name_equal(ce, fatentp->name))
+    {
+        return false;
+    }
+
+    if (!(fatentp->attr & ATTR_DIRECTORY))
+        ce->filesize = fatentp->filesize;
+
+    ce->attr      = fatentp->attr;
+    ce->wrtdate   = fatentp->wrtdate;
+    ce->wrttime   = fatentp->wrttime;
+    ce->serialnum = next_serialnum();
+    return true;
+}
+
 /**
  * scan and build the contents of a subdirectory
  */
@@ -1234,6 +1568,7 @@ static void sab_process_sub(struct sab *sabp)
     struct fat_direntry *const fatentp = get_dir_fatent();
     struct filestr_base *const streamp = &sabp->stream;
     struct file_base_info *const infop = &sabp->info;
+    struct dircache_runinfo_volume *const dcrivolp = DCRIVOL(infop);
 
     int idx = infop->dcfile.idx;
     int *downp = get_downidxp(idx);
@@ -1276,13 +1611,39 @@ static void sab_process_sub(struct sab *sabp)
                 if (rc < 0)
                     sabp->quit = true;
                 else
+                {
+                    /* anything loaded that is left wasn't found */
+                    int prev;
+                    while ((prev = *compp->prevp))
+                    {
+                        struct dircache_entry *ce = get_entry(prev);
+                        if (entry_is_loaded(ce))
+                            free_loaded_entry(dcrivolp, compp->prevp);
+                        else
+                            compp->prevp = &ce->next;
+                    }
+
                     compp->prevp = downp; /* rewind list */
+                }
 
                 break;
             }
 
             struct dircache_entry *ce;
-            int prev = *compp->prevp;
+            int prev;
+
+            /* loaded entries in slots before this one are gone */
+            while ((prev = *compp->prevp))
+            {
+                ce = get_entry(prev);
+                if (ce->direntry >= infop->fatfile.e.entry)
+                    break;
+
+                if (entry_is_loaded(ce))
+                    free_loaded_entry(dcrivolp, compp->prevp);
+                else
+                    compp->prevp = &ce->next;
+            }
 
             if (prev)
             {
@@ -1294,8 +1655,27 @@ static void sab_process_sub(struct sab *sabp)
                 ce = get_entry(prev);
                 if (ce->direntry == infop->fatfile.e.entry)
                 {
-                    compp->prevp = &ce->next;
-                    continue; /* already there */
+                    if (!entry_is_loaded(ce))
+                    {
+                        compp->prevp = &ce->next;
+                        continue; /* already there */
+                    }
+
+                    if (sab_check_loaded(ce, fatentp, infop))
+                    {
+                        /* loaded and unchanged; resolve it as if added */
+                        compp->prevp = &ce->next;
+                        infop->fatfile.firstcluster = ce->firstcluster;
+                        infop->fatfile.dircluster   = dircluster;
+                        infop->dcfile.idx           = prev;
+                        infop->dcfile.serialnum     = ce->serialnum;
+                        binding_resolve(infop);
+                        continue;
+                    }
+
+                    /* something else is in its slot now */
+                    free_loaded_entry(dcrivolp, compp->prevp);
+                    prev = *compp->prevp;
                 }
             }
 
@@ -1548,6 +1928,33 @@ void dircache_rewinddir_dirent(struct dirscan_info *scanp)
     dircache_dcfile_init(&scanp->dcscan);
 }
 
+/**
+ * fill in what an internal scan returns for the entry
+ */
+static int fill_internal(struct file_base_info *infop,
+                         struct fat_direntry *fatent,
+                         int idx, const struct dircache_entry *ce)
+{
+    /* FS entry information that we maintain */
+    entry_name_copy(fatent->name, ce);
+    fatent->shortname[0]     = '\0';
+    fatent->attr             = ce->attr;
+    /* file code file scanning does not need time information */
+    fatent->filesize         = (ce->attr & ATTR_DIRECTORY) ? 0 : ce->filesize;
+    fatent->firstcluster     = ce->firstcluster;
+
+    /* FS entry directory information */
+    infop->fatfile.e.entry   = ce->direntry;
+    infop->fatfile.e.entries = ce->direntries;
+
+    /* dircache file binding information */
+    infop->dcfile.idx        = idx;
+    infop->dcfile.serialnum  = ce->serialnum;
+
+    /* return whether this needs decoding */
+    return ce->direntries == 1 ? 2 : 1;
+}
+
 /**
  * this function is the back end to file API internal scanning, which requires
  * much more detail about the directory entries; this is allowed to make
@@ -1588,6 +1995,11 @@ int dircache_readdir_internal(struct filestr_base *stream,
 
     struct dircache_entry *ce = get_entry(idx);
 
+    /* loaded entries of a directory that is yet to be checked may be stale;
+       they aren't there as far as anyone but the scan is concerned */
+    while (ce && entry_is_loaded(ce))
+        ce = get_entry(idx = ce->next);
+
     if (frontier != FRONTIER_SETTLED && !(stream->flags & FF_CACHEONLY))
     {
         /* the directory being read is reported to be incompletely cached;
@@ -1606,24 +2018,7 @@ int dircache_readdir_internal(struct filestr_base *stream,
         goto read_eod;
     }
 
-    /* FS entry information that we maintain */
-    entry_name_copy(fatent->name, ce);
-    fatent->shortname[0]     = '\0';
-    fatent->attr             = ce->attr;
-    /* file code file scanning does not need time information */
-    fatent->filesize         = (ce->attr & ATTR_DIRECTORY) ? 0 : ce->filesize;
-    fatent->firstcluster     = ce->firstcluster;
-
-    /* FS entry directory information */
-    infop->fatfile.e.entry   = ce->direntry;
-    infop->fatfile.e.entries = ce->direntries;
-
-    /* dircache file binding information */
-    infop->dcfile.idx        = idx;
-    infop->dcfile.serialnum  = ce->serialnum;
-
-    /* return whether this needs decoding */
-    int rc = ce->direntries == 1 ? 2 : 1;
+    int rc = fill_internal(infop, fatent, idx, ce);
 
     if (frontier == FRONTIER_SETTLED)
     {
@@ -1643,6 +2038,47 @@ read_eod:
     return 0;    
 }
 
+/**
+ * find an entry by name for an internal scan without reading the directory,
+ * if the cache can; a found entry is returned as dircache_readdir_internal()
+ * would return it
+ *
+ * returns: > 0 = found
+ *            0 = no such entry
+ *          < 0 = the directory has to be read
+ */
+int dircache_find_internal(struct filestr_base *stream,
+                           struct file_base_info *infop,
+                           const char *name,
+                           struct fat_direntry *fatent)
+{
+    /* call with writer exclusion */
+    struct file_base_info *dirinfop = stream->infop;
+
+    infop->dcfile.serialnum = 0;
+
+    if (!dirinfop->dcfile.serialnum)
+        return -1;
+
+    int diridx = dirinfop->dcfile.idx;
+    if (get_frontier(diridx) != FRONTIER_SETTLED)
+        return -1;
+
+    int idx = hash_find(diridx, name);
+    if (idx < 0)
+        return idx;
+
+    if (idx == 0)
+    {
+        /* as if read to the end */
+        fat_empty_fat_direntry(fatent);
+        infop->fatfile.e.entries = 0;
+        return 0;
+    }
+
+    return fill_internal(infop, fatent, idx, get_entry(idx));
+}
+
 /**
  * rewind the scan position for an internal scan
  */
@@ -1826,6 +2262,8 @@ static void reset_cache(void)
     dircache.namesfree    = 0;
     dircache.nextnamefree = 0;
     *get_name(dircache.names - 1) = 0;
+    memset(dircache.hashes, 0, sizeof (dircache.hashes));
+    dircache_runinfo.loadserial = 0;
     /* dircache.last_serialnum stays */
     /* dircache.reserve_used stays */
     /* dircache.last_size stays */
@@ -1897,7 +2335,7 @@ static int prepare_build(bool *realloced)
     /* called holding dircache lock */
     size_t size = dircache.last_size;
 
-#ifdef HAVE_EEPROM_SETTINGS
+#ifdef DIRCACHE_SNAPSHOT
     if (realloced)
     {
         dircache_unlock();
@@ -1907,7 +2345,7 @@ static int prepare_build(bool *realloced)
         if (dircache_runinfo.suspended)
             return -1;
     }
-#endif /* HAVE_EEPROM_SETTINGS */
+#endif /* DIRCACHE_SNAPSHOT */
 
     bool stuffed = DIRCACHE_STUFFED(dircache.reserve_used);
     if (dircache_runinfo.bufsize > size && !stuffed)
@@ -1995,6 +2433,7 @@ static void compact_cache(void)
              ce->name += offset;
     }
 
+    hash_move_tables(offset);
     dircache.names += offset;
 
     /* assumes beelzelib doesn't do things like calling callbacks or changing
@@ -2015,6 +2454,8 @@ static void dircache_thread(void)
 {
     struct queue_event ev;
 
+    storage_set_origin(STORAGE_ORIGIN_DIRCACHE);
+
     /* calls made within the loop reopen the lock */
     dircache_lock();
 
@@ -2055,6 +2496,7 @@ static void dircache_thread(void)
      }
 
      dircache_unlock();
+     storage_set_origin(STORAGE_ORIGIN_OTHER); /* let the next one have it */
 }
 
 /**
@@ -2551,7 +2993,7 @@ static int check_file_serialnum(const struct dircache_file *dcfilep)
     if (idx > 0)
     {
         struct dircache_entry *ce = get_entry(idx);
-        if (!ce || !(s = ce->serialnum))
+        if (!ce || !(s = ce->serialnum) || entry_is_loaded(ce))
             return -EBADF;
     }
     else /* idx < 0 */
@@ -2984,7 +3426,7 @@ void dircache_dcfile_init(struct dircache_file *dcfilep)
     dcfilep->serialnum = 0;
 }
 
-#ifdef HAVE_EEPROM_SETTINGS
+#ifdef DIRCACHE_SNAPSHOT
 
 #ifdef HAVE_HOTSWAP
 /* NOTE: This is hazardous to the filesystem of any sort of removable
@@ -2995,7 +3437,7 @@ void dircache_dcfile_init(struct dircache_file *dcfilep)
 #endif
 
 /* dircache persistence file header magic */
-#define DIRCACHE_MAGIC  0x00d0c0a1
+#define DIRCACHE_MAGIC  0x00d0c0a2
 
 /* dircache persistence file header */
 struct dircache_maindata
@@ -3022,7 +3464,8 @@ static bool dircache_is_clean(bool saving)
 
 /**
  * function to load the internal cache structure from disk to initialize
- * the dircache really fast with little disk access.
+ * the dircache really fast with little disk access; the contents are then
+ * checked against the storage in the background.
  */
 int INIT_ATTR dircache_load(void)
 {
@@ -3135,12 +3578,43 @@ int INIT_ATTR dircache_load(void)
             if (!ce->tinyname)
                 ce->name += offset;
         }
+
+        hash_move_tables(offset);
     }
 
     dircache.reserve_used = 0;
 
-    /* enable the cache but do not try to build it */
+    /* the storage may have been written since it was saved, by anything; the
+       background scan goes over every directory, keeping the loaded entries
+       it finds unchanged and replacing the rest, and until it has been
+       through a directory its loaded contents are hidden and it is read
+       through to the storage */
+    dircache_runinfo.loadserial = dircache.last_serialnum;
+
+    FOR_EACH_CACHE_ENTRY(ce)
+    {
+        if ((ce->attr & ATTR_DIRECTORY) &&
+            !(ce->tinyname && is_dotdir_name((const char *)ce->namebuf)))
+            establish_frontier(get_index(ce), FRONTIER_NEW | FRONTIER_RENEW);
+    }
+
+    FOR_EACH_VOLUME(-1, i)
+    {
+        struct dircache_volume *dcvolp = DCVOL(i);
+        if (dcvolp->status == DIRCACHE_IDLE)
+            continue;
+
+        dcvolp->status     = DIRCACHE_SCANNING;
+        dcvolp->start_tick = current_tick;
+        establish_frontier(-i - 1, FRONTIER_NEW | FRONTIER_RENEW);
+
+        if (!volume_ismounted(IF_MV(i)))
+            reset_volume(IF_MV(i));
+    }
+
+    /* enable the cache and have it checked in the background */
     dircache_enable_internal(false);
+    dircache_thread_post(NULL);
 
     /* cache successfully loaded */
     core_unpin(handle);
@@ -3255,7 +3729,7 @@ error:
     close(fd);
     return rc;
 }
-#endif /* HAVE_EEPROM_SETTINGS */
+#endif /* DIRCACHE_SNAPSHOT */
 
 /**
  * main one-time initialization function that must be called before any other
@@ -26,7 +26,7 @@
 #include "fs_defines.h"
 #include "bitarray.h"
 
-/* Cache: LRU cache with separately-chained hashtable
+/* Cache: 2Q cache with separately-chained hashtable
  *
  * Each entry of the map is the mapped location of the hashed sector value
  * where each bit in each map entry indicates which corresponding cache
@@ -40,9 +40,8 @@
  * all bits, the sector is not cached.
  *
  * To avoid long chains, the map entry count should be much greater than the
- * number of cache entries. Since the cache is an LRU design, no buffer entry
- * in the array is intrinsically associated with any particular sector number
- * or volume.
+ * number of cache entries. No buffer entry in the array is intrinsically
+ * associated with any particular sector number or volume.
  *
  * Example 6-sector cache with 8-entry map:
  * cache entry 543210
@@ -55,25 +54,62 @@
  *             001001 <- collision
  *             000000
  * volume map  111101 <- entry usage by the volume (OR of all map entries)
+ *
+ * Replacement: sectors enter the "in" queue, which is FIFO and kept to a
+ * quarter of the cache once the "main" queue has anything in it. What falls
+ * out of it is remembered in a small ghost list of sector numbers only. A
+ * sector that misses while still remembered there has proven to be reused
+ * and goes to the main queue, which is LRU. Going through a long directory
+ * or a whole FAT once therefore only cycles the in queue and leaves the
+ * sectors in the main queue alone.
+ *
+ * The classes are treated differently where it matters:
+ * - directory sectors only get into the main queue through the ghost list,
+ *   since scans read them over and over while going through their entries
+ * - FAT and other sectors are also promoted when they are referenced again
+ *   after something else has been; references in a row (walking the entries
+ *   of one FAT sector) still count as one
+ * - prefetched sectors enter the in queue and their first reference is
+ *   not counted as a reuse
  */
 
 enum dce_flags /* flags for each cache entry */
 {
-    DCE_INUSE = 0x01, /* entry in use and valid */
-    DCE_DIRTY = 0x02, /* entry is dirty in need of writeback */
-    DCE_BUF   = 0x04, /* entry is being used as a general buffer */
+    DCE_INUSE    = 0x01, /* entry in use and valid */
+    DCE_DIRTY    = 0x02, /* entry is dirty in need of writeback */
+    DCE_BUF      = 0x04, /* entry is being used as a general buffer */
+    DCE_PREFETCH = 0x08, /* entry was read ahead and not referenced yet */
+};
+
+enum dc_queue
+{
+    DCQ_IN = 0,          /* first-time and correlated references (FIFO) */
+    DCQ_MAIN,            /* proven reuse (LRU) */
+    DCQ_NUM_QUEUES,
 };
 
 struct disk_cache_entry
 {
-    struct lldc_node node;  /* LRU list links */
+    struct lldc_node node;  /* queue links */
     unsigned char flags;    /* entry flags */
+    unsigned char queue;    /* queue the entry is on */
 #ifdef HAVE_MULTIVOLUME
     unsigned char volume;   /* volume of sector */
 #endif
     sector_t sector;   /* cached disk sector number */
 };
 
+/* sector numbers of what was evicted from the in queue lately */
+#define DC_NUM_GHOSTS (DC_NUM_ENTRIES * 2)
+
+struct disk_cache_ghost
+{
+#ifdef HAVE_MULTIVOLUME
+    unsigned char volume;   /* volume of sector */
+#endif
+    sector_t sector;        /* evicted sector number */
+};
+
 BITARRAY_TYPE_DECLARE(cache_map_entry_t, cache_map, DC_NUM_ENTRIES)
 
 static inline unsigned int map_sector(sector_t sector)
@@ -82,7 +118,12 @@ static inline unsigned int map_sector(sector_t sector)
     return sector % DC_MAP_NUM_ENTRIES;
 }
 
-static struct lldc_head cache_lru; /* LRU cache list (head = LRU item) */
+static struct lldc_head cache_queue[DCQ_NUM_QUEUES]; /* head = oldest item */
+static unsigned int cache_queue_count[DCQ_NUM_QUEUES];
+static struct disk_cache_entry *cache_last_ref; /* last referenced entry */
+static struct disk_cache_ghost cache_ghost[DC_NUM_GHOSTS];
+static unsigned int cache_ghost_next;
+static struct dc_stats cache_stats;
 static struct disk_cache_entry cache_entry[DC_NUM_ENTRIES];
 static cache_map_entry_t cache_map_entry[NUM_VOLUMES][DC_MAP_NUM_ENTRIES];
 static cache_map_entry_t cache_vol_map[NUM_VOLUMES] IBSS_ATTR;
@@ -94,8 +135,7 @@ struct mutex disk_cache_mutex SHAREDBSS_ATTR;
 #define CACHE_VOL_MAP(volume) \
     cache_vol_map[IF_MV_VOL(volume)]
 
-#define DCE_LRU()      ((struct disk_cache_entry *)cache_lru.head)
-#define DCE_NEXT(fce)  ((struct disk_cache_entry *)(fce)->node.next)
+#define DCE_OLDEST(q)  ((struct disk_cache_entry *)cache_queue[q].head)
 #define NODE_DCE(node) ((struct disk_cache_entry *)(node))
 
 /* get the cache index from a pointer to a buffer */
@@ -123,59 +163,169 @@ static inline void cache_bitmap_clear_bit(int volume, unsigned int mapnum,
     (void)volume;
 }
 
-/* make entry MRU by moving it to the list tail */
-static inline void touch_cache_entry(struct disk_cache_entry *which)
+/* take the entry off of its queue */
+static void cache_queue_remove(struct disk_cache_entry *dce)
+{
+    lldc_remove(&cache_queue[dce->queue], &dce->node);
+    cache_queue_count[dce->queue]--;
+}
+
+/* put the entry at the newest end of a queue */
+static void cache_queue_insert_last(struct disk_cache_entry *dce,
+                                    unsigned int queue)
+{
+    dce->queue = queue;
+    lldc_insert_last(&cache_queue[queue], &dce->node);
+    cache_queue_count[queue]++;
+}
+
+/* put the entry at the oldest end of the in queue so it's reused first */
+static void cache_queue_insert_first(struct disk_cache_entry *dce)
+{
+    dce->queue = DCQ_IN;
+    lldc_insert_first(&cache_queue[DCQ_IN], &dce->node);
+    cache_queue_count[DCQ_IN]++;
+}
+
+/* remember an entry evicted from the in queue */
+static void cache_ghost_add(struct disk_cache_entry *dce)
+{
+    struct disk_cache_ghost *ghost = &cache_ghost[cache_ghost_next];
+
+#ifdef HAVE_MULTIVOLUME
+    ghost->volume = dce->volume;
+#endif
+    ghost->sector = dce->sector;
+
+    if (++cache_ghost_next >= DC_NUM_GHOSTS)
+        cache_ghost_next = 0;
+}
+
+/* find and forget a remembered sector; true if it was there */
+static bool cache_ghost_remove(IF_MV(int volume,) sector_t sector)
+{
+    for (unsigned int i = 0; i < DC_NUM_GHOSTS; i++)
+    {
+        struct disk_cache_ghost *ghost = &cache_ghost[i];
+
+        if (ghost->sector == sector IF_MV( && ghost->volume == volume ))
+        {
+            ghost->sector = (sector_t)-1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* a referenced entry was found in the cache */
+static void cache_reference(struct disk_cache_entry *dce, unsigned int how)
 {
-    struct lldc_node *lru = cache_lru.head;
-    struct lldc_node *node = &which->node;
-
-    if (node == lru->prev)  /* already MRU */
-        ; /**/
-    else if (node == lru)   /* is the LRU? just rotate list */
-        cache_lru.head = lru->next;
-    else                    /* somewhere else; move it */
+    struct disk_cache_entry *last = cache_last_ref;
+    cache_last_ref = dce;
+
+    if (dce->flags & DCE_PREFETCH)
+    {
+        /* first reference to a prefetched sector */
+        dce->flags &= ~DCE_PREFETCH;
+        cache_stats.prefetch_hits++;
+        return;
+    }
+
+    if (dce->queue == DCQ_MAIN)
     {
-        lldc_remove(&cache_lru, node);
-        lldc_insert_last(&cache_lru, node);
+        /* make entry MRU by moving it to the queue tail */
+        struct lldc_node *node = &dce->node;
+        struct lldc_node *head = cache_queue[DCQ_MAIN].head;
+
+        if (node == head->prev) /* already MRU */
+            ; /**/
+        else if (node == head)  /* is the LRU? just rotate the queue */
+            cache_queue[DCQ_MAIN].head = head->next;
+        else                    /* somewhere else; move it */
+        {
+            lldc_remove(&cache_queue[DCQ_MAIN], node);
+            lldc_insert_last(&cache_queue[DCQ_MAIN], node);
+        }
+    }
+    else if (dce != last && (how & DC_CLASS_MASK) != DC_DIR)
+    {
+        /* not a repeat of the previous reference; it's reused */
+        cache_queue_remove(dce);
+        cache_queue_insert_last(dce, DCQ_MAIN);
+        cache_stats.promotions++;
     }
 }
 
-/* remove LRU entry from the cache list to use as a buffer */
-static struct disk_cache_entry * cache_remove_lru_entry(void)
+/* remove an entry from the queues that is to be reused; the in queue is
+   emptied first when it is over its share or nothing else is left; there is
+   always one since dc_get_buffer() never takes the last */
+static struct disk_cache_entry * cache_remove_victim(void)
 {
-    struct lldc_node *lru = cache_lru.head;
+    unsigned int total = cache_queue_count[DCQ_IN] +
+                         cache_queue_count[DCQ_MAIN];
 
-    /* at least one is reserved for client */
-    if (lru == lru->next)
-        return NULL;
+    struct disk_cache_entry *dce = DCE_OLDEST(DCQ_IN);
 
-    /* remove it; next-LRU becomes the LRU */
-    lldc_remove(&cache_lru, lru);
-    return NODE_DCE(lru);
+    if (dce && dce->flags &&
+        cache_queue_count[DCQ_IN] <= total / 4 &&
+        cache_queue_count[DCQ_MAIN] > 0)
+    {
+        /* in queue holds its share; take from the main queue */
+        dce = DCE_OLDEST(DCQ_MAIN);
+    }
+    else if (!dce)
+    {
+        dce = DCE_OLDEST(DCQ_MAIN);
+    }
+    else if ((dce->flags & (DCE_INUSE|DCE_PREFETCH)) == DCE_INUSE)
+    {
+        /* referenced sectors leaving the in queue are remembered */
+        cache_ghost_add(dce);
+    }
+
+    if (cache_last_ref == dce)
+        cache_last_ref = NULL;
+
+    cache_queue_remove(dce);
+    return dce;
 }
 
-/* return entry to the cache list and set it LRU */
-static void cache_return_lru_entry(struct disk_cache_entry *fce)
+/* return entry to the cache and have it reused first */
+static void cache_return_entry(struct disk_cache_entry *dce)
 {
-    lldc_insert_first(&cache_lru, &fce->node);
+    cache_queue_insert_first(dce);
 }
 
-/* discard the entry's data and mark it unused */
-static inline void cache_discard_entry(struct disk_cache_entry *dce,
-                                       unsigned int index)
+/* remove the entry's sector from the map and mark it unused */
+static inline void cache_unmap_entry(struct disk_cache_entry *dce,
+                                     unsigned int index)
 {
     cache_bitmap_clear_bit(IF_MV_VOL(dce->volume), map_sector(dce->sector),
                            index);
     dce->flags = 0;
 }
 
+/* discard the entry's data and have it reused first */
+static void cache_discard_entry(struct disk_cache_entry *dce,
+                                unsigned int index)
+{
+    cache_unmap_entry(dce, index);
+    cache_queue_remove(dce);
+    cache_return_entry(dce);
+
+    if (cache_last_ref == dce)
+        cache_last_ref = NULL;
+}
+
 /* search the cache for the specified sector, returning a buffer, either
    to the specified sector, if it exists, or a new/evicted entry that must
    be filled */
-void * dc_cache_probe(IF_MV(int volume,) sector_t sector,
+void * dc_cache_probe(IF_MV(int volume,) sector_t sector, unsigned int how,
                       unsigned int *flagsp)
 {
     unsigned int mapnum = map_sector(sector);
+    unsigned int class = how & DC_CLASS_MASK;
 
     FOR_EACH_BITARRAY_SET_BIT(&CACHE_MAP_ENTRY(volume, mapnum), index)
     {
@@ -184,19 +334,40 @@ void * dc_cache_probe(IF_MV(int volume,) sector_t sector,
         if (dce->sector == sector)
         {
             *flagsp = DCE_INUSE;
-            touch_cache_entry(dce);
+
+            if (!(how & DC_PREFETCH))
+            {
+                cache_stats.hits[class]++;
+                cache_reference(dce, how);
+            }
+
             return cache_buffer[index];
         }
     }
 
-    /* sector not found so the LRU is the victim */
-    struct disk_cache_entry *dce = DCE_LRU();
-    cache_lru.head = dce->node.next;
+    /* sector not found so take a victim */
+    struct disk_cache_entry *dce = cache_remove_victim();
 
     unsigned int index = DCIDX_FROM_DCE(dce);
     void *buf = cache_buffer[index];
     unsigned int old_flags = dce->flags;
 
+    if (how & DC_PREFETCH)
+    {
+        cache_queue_insert_last(dce, DCQ_IN);
+        cache_stats.prefetched++;
+    }
+    else
+    {
+        /* back soon after leaving the in queue? then it's reused */
+        bool reused = cache_ghost_remove(IF_MV(volume,) sector);
+        cache_queue_insert_last(dce, reused ? DCQ_MAIN : DCQ_IN);
+        cache_last_ref = dce;
+        cache_stats.misses[class]++;
+        if (reused)
+            cache_stats.promotions++;
+    }
+
     if (old_flags)
     {
         int old_volume = IF_MV_VOL(dce->volume);
@@ -215,7 +386,7 @@ void * dc_cache_probe(IF_MV(int volume,) sector_t sector,
     cache_bitmap_set_bit(IF_MV_VOL(volume), mapnum, index);
 
 finish_setup:
-    dce->flags  = DCE_INUSE;
+    dce->flags  = (how & DC_PREFETCH) ? DCE_INUSE|DCE_PREFETCH : DCE_INUSE;
 #ifdef HAVE_MULTIVOLUME
     dce->volume = volume;
 #endif
@@ -286,7 +457,11 @@ void * dc_get_buffer(void)
     dc_lock_cache();
 
     void *buf = NULL;
-    struct disk_cache_entry *dce = cache_remove_lru_entry();
+    struct disk_cache_entry *dce = NULL;
+
+    /* at least one is reserved for the cache itself */
+    if (cache_queue_count[DCQ_IN] + cache_queue_count[DCQ_MAIN] > 1)
+        dce = cache_remove_victim();
 
     if (dce)
     {
@@ -301,7 +476,7 @@ void * dc_get_buffer(void)
             if (flags & DCE_DIRTY)
                 dc_writeback_callback(IF_MV(dce->volume,) dce->sector, buf);
 
-            cache_discard_entry(dce, index);
+            cache_unmap_entry(dce, index);
         }
 
         dce->flags = DCE_BUF;
@@ -327,17 +502,33 @@ void dc_release_buffer(void *buf)
     if (dce->flags & DCE_BUF)
     {
         dce->flags = 0;
-        cache_return_lru_entry(dce);
+        cache_return_entry(dce);
     }
 
     dc_unlock_cache();
 }
 
+/* copy the cache's counters */
+void dc_get_stats(struct dc_stats *stats)
+{
+    dc_lock_cache();
+    *stats = cache_stats;
+    stats->queued[DCQ_IN] = cache_queue_count[DCQ_IN];
+    stats->queued[DCQ_MAIN] = cache_queue_count[DCQ_MAIN];
+    dc_unlock_cache();
+}
+
 /* one-time init at startup */
 void dc_init(void)
 {
     mutex_init(&disk_cache_mutex);
-    lldc_init(&cache_lru);
+
+    for (unsigned int q = 0; q < DCQ_NUM_QUEUES; q++)
+        lldc_init(&cache_queue[q]);
+
     for (unsigned int i = 0; i < DC_NUM_ENTRIES; i++)
-        lldc_insert_last(&cache_lru, &cache_entry[i].node);
+        cache_queue_insert_last(&cache_entry[i], DCQ_IN);
+
+    for (unsigned int i = 0; i < DC_NUM_GHOSTS; i++)
+        cache_ghost[i].sector = (sector_t)-1;
 }
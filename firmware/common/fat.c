@@ -36,6 +36,9 @@
 #include "debug.h"
 #include "panic.h"
 #include "disk.h"
+#ifndef BOOTLOADER
+#include "core_alloc.h"
+#endif
 /*#define LOGF_ENABLE*/
 #include "logf.h"
 
@@ -211,6 +214,21 @@ struct fsinfo
 #define update_fat_entry            update_fat_entry32
 #define fat_recalc_free_internal    fat_recalc_free_internal32
 #endif /* HAVE_FAT16SUPPORT */
+
+#ifndef BOOTLOADER
+/* Keep maps of the runs of contiguous clusters in recently seeked files, so
+   that seeking doesn't have to walk the cluster chain */
+#define FAT_EXTENT_MAPS         4   /* Files mapped at once */
+#define FAT_EXTENT_MAP_SIZE     32  /* Runs mapped per file */
+/* Keep a count of the free entries of every FAT32 sector in RAM, so that
+   allocating doesn't have to read through the full parts of the FAT */
+#define FAT_FREE_MAP
+#define FAT_FREE_MAP_MAX_SECTORS 32768 /* 64kB; larger FATs go unmapped */
+/* Read this many bytes of FAT at once when a cluster chain being followed
+   runs into the next FAT sector */
+#define FAT_READAHEAD_SIZE      2048
+#endif
+
 struct bpb;
 static void update_fsinfo32(struct bpb *fat_bpb);
 
@@ -275,6 +293,12 @@ static struct bpb
 #if defined(MAX_VIRT_SECTOR_SIZE) || defined(MAX_VARIABLE_LOG_SECTOR)
     uint16_t sector_size;
 #endif
+#ifdef FAT_FREE_MAP
+    int freemap;      /* buflib handle of the free map, or 0 if none */
+#endif
+#ifdef FAT_READAHEAD_SIZE
+    sector_t fat_ra_next; /* FAT sector following the last one read */
+#endif
 } fat_bpbs[NUM_VOLUMES]; /* mounted partition info */
 
 #ifdef STORAGE_NEEDS_BOUNCE_BUFFER
@@ -315,6 +339,7 @@ static uint8_t fat_bounce_buffers[NUM_VOLUMES][BOUNCE_SECTOR_SIZE*FAT_BOUNCE_SEC
         }                                            \
         _bpb; })
 
+
 enum add_dir_entry_flags
 {
     DIRENT_RETURN      = 0x01, /* return the new short entry */
@@ -350,11 +375,24 @@ static void cache_discard(IF_MV_NONVOID(struct bpb *fat_bpb))
     dc_unlock_cache();
 }
 
+/* tells the cache what kind of sector it is looking at */
+static inline unsigned int cache_sector_class(struct bpb *fat_bpb,
+                                              sector_t secnum)
+{
+    if (IS_FAT_SECTOR(fat_bpb, secnum))
+        return DC_FAT;
+    else if (secnum < fat_bpb->fatrgnstart)
+        return DC_MISC;
+    else
+        return DC_DIR;
+}
+
 /* caches a FAT or data area sector */
 static void * cache_sector(struct bpb *fat_bpb, sector_t secnum)
 {
     unsigned int flags;
-    void *buf = dc_cache_probe(IF_MV(fat_bpb->volume,) secnum, &flags);
+    void *buf = dc_cache_probe(IF_MV(fat_bpb->volume,) secnum,
+                               cache_sector_class(fat_bpb, secnum), &flags);
 
     if (!flags)
     {
@@ -375,13 +413,74 @@ static void * cache_sector(struct bpb *fat_bpb, sector_t secnum)
 /* returns a raw buffer for a sector; buffer counts as INUSE but filesystem
  * contents are NOT loaded before returning - use when completely overwriting
  * a sector's contents in order to avoid a fill */
-static void * cache_sector_buffer(IF_MV(struct bpb *fat_bpb,)
-                                  sector_t secnum)
+static void * cache_sector_buffer(struct bpb *fat_bpb, sector_t secnum)
 {
     unsigned int flags;
-    return dc_cache_probe(IF_MV(fat_bpb->volume,) secnum, &flags);
+    return dc_cache_probe(IF_MV(fat_bpb->volume,) secnum,
+                          cache_sector_class(fat_bpb, secnum), &flags);
 }
 
+#ifdef FAT_READAHEAD_SIZE
+/* caches a FAT sector for following a cluster chain; when the chain has
+   gone on from the previously read FAT sector, the following ones are read
+   along with it and put in the cache as prefetched */
+static void * cache_fat_sector(struct bpb *fat_bpb, sector_t secnum)
+{
+    static uint8_t readahead_buf[FAT_READAHEAD_SIZE] STORAGE_ALIGN_ATTR;
+
+    unsigned int flags;
+    uint8_t *buf = dc_cache_probe(IF_MV(fat_bpb->volume,) secnum, DC_FAT,
+                                  &flags);
+    if (flags)
+        return buf;
+
+    unsigned long count = 1;
+    unsigned int secsize = LOG_SECTOR_SIZE(fat_bpb);
+
+    if (secnum == fat_bpb->fat_ra_next)
+    {
+        count = MIN(FAT_READAHEAD_SIZE / secsize,
+                    fat_bpb->fatrgnend - secnum);
+        if (count < 1)
+            count = 1;
+    }
+
+    fat_bpb->fat_ra_next = secnum + count;
+
+    int rc = storage_read_sectors(IF_MD(fat_bpb->drive,)
+                                  secnum + fat_bpb->startsector, count,
+                                  count > 1 ? readahead_buf : buf);
+    if (UNLIKELY(rc < 0))
+    {
+        DEBUGF("%s() - Could not read sector %llu"
+               " (error %d)\n", __func__, (uint64_t)secnum, rc);
+        dc_discard_buf(buf);
+        fat_bpb->fat_ra_next = 0;
+        return NULL;
+    }
+
+    if (count > 1)
+    {
+        memcpy(buf, readahead_buf, secsize);
+
+        /* the requested sector was just put in the in queue and can't be
+           its oldest entry again after these few */
+        for (unsigned long i = 1; i < count; i++)
+        {
+            void *rabuf = dc_cache_probe(IF_MV(fat_bpb->volume,) secnum + i,
+                                         DC_FAT | DC_PREFETCH, &flags);
+            /* if cached it may have been changed; keep that */
+            if (!flags)
+                memcpy(rabuf, readahead_buf + i*secsize, secsize);
+        }
+    }
+
+    return buf;
+}
+#else /* !FAT_READAHEAD_SIZE */
+#define cache_fat_sector cache_sector
+#endif /* FAT_READAHEAD_SIZE */
+
 /* flush a cache buffer to storage */
 void dc_writeback_callback(IF_MV(int volume,) sector_t sector, void *buf)
 {
@@ -861,7 +960,7 @@ static long get_next_cluster16(struct bpb *fat_bpb, long startcluster)
 
     dc_lock_cache();
 
-    uint16_t *sec = cache_sector(fat_bpb, sector + fat_bpb->fatrgnstart);
+    uint16_t *sec = cache_fat_sector(fat_bpb, sector + fat_bpb->fatrgnstart);
     if (!sec)
     {
         dc_unlock_cache();
@@ -1020,7 +1119,7 @@ static long get_next_cluster32(struct bpb *fat_bpb, long startcluster)
 
     dc_lock_cache();
 
-    uint32_t *sec = cache_sector(fat_bpb, sector + fat_bpb->fatrgnstart);
+    uint32_t *sec = cache_fat_sector(fat_bpb, sector + fat_bpb->fatrgnstart);
     if (!sec)
     {
         dc_unlock_cache();
@@ -1038,6 +1137,148 @@ static long get_next_cluster32(struct bpb *fat_bpb, long startcluster)
     return next;
 }
 
+/** Free space map **/
+
+#ifdef FAT_FREE_MAP
+/* One count per FAT sector; the counts of sectors not looked at yet are
+   unknown. They get filled in as the allocator reads the FAT, or all at once
+   when the free space is recalculated. The allocation is movable, so the
+   data pointer must be fetched again after anything that may yield. */
+#define FREEMAP_UNKNOWN 0xffff
+
+static uint16_t * freemap_get(struct bpb *fat_bpb)
+{
+    return fat_bpb->freemap > 0 ? core_get_data(fat_bpb->freemap) : NULL;
+}
+
+static void freemap_init(struct bpb *fat_bpb)
+{
+    fat_bpb->freemap = 0;
+
+#ifdef HAVE_FAT16SUPPORT
+    if (fat_bpb->is_fat16)
+        return; /* small enough to scan */
+#endif
+
+    if (fat_bpb->fatsize > FAT_FREE_MAP_MAX_SECTORS)
+        return;
+
+    int handle = core_alloc(fat_bpb->fatsize * sizeof (uint16_t));
+    if (handle <= 0)
+    {
+        DEBUGF("%s: no room for the free map\n", __func__);
+        return;
+    }
+
+    memset(core_get_data(handle), 0xff, fat_bpb->fatsize * sizeof (uint16_t));
+    fat_bpb->freemap = handle;
+}
+
+static void freemap_destroy(struct bpb *fat_bpb)
+{
+    if (fat_bpb->freemap > 0)
+        core_free(fat_bpb->freemap);
+
+    fat_bpb->freemap = 0;
+}
+
+/* count the free entries of a cached FAT32 sector */
+static unsigned int freemap_count32(struct bpb *fat_bpb, unsigned long nr,
+                                    const uint32_t *sec)
+{
+    unsigned int count = 0;
+
+    for (unsigned long j = 0; j < CLUSTERS_PER_FAT_SECTOR; j++)
+    {
+        unsigned long c = nr * CLUSTERS_PER_FAT_SECTOR + j;
+
+        if (c < 2 || c > fat_bpb->dataclusters + 1)
+            continue;
+
+        if (!(letoh32(sec[j]) & 0x0fffffff))
+            count++;
+    }
+
+    return count;
+}
+
+static void freemap_set(struct bpb *fat_bpb, unsigned long nr,
+                        unsigned int count)
+{
+    uint16_t *map = freemap_get(fat_bpb);
+    if (map)
+        map[nr] = count;
+}
+
+static void freemap_adjust(struct bpb *fat_bpb, unsigned long nr, int delta)
+{
+    uint16_t *map = freemap_get(fat_bpb);
+    if (map && map[nr] != FREEMAP_UNKNOWN)
+        map[nr] += delta;
+}
+
+/* true if the sector is known to have no free entries */
+static bool freemap_full(struct bpb *fat_bpb, unsigned long nr)
+{
+    uint16_t *map = freemap_get(fat_bpb);
+    return map && map[nr] == 0;
+}
+
+/* true if the sector's count is known */
+static bool freemap_known(struct bpb *fat_bpb, unsigned long nr)
+{
+    uint16_t *map = freemap_get(fat_bpb);
+    return !map || map[nr] != FREEMAP_UNKNOWN;
+}
+
+/* Returns where a new cluster chain should start looking for free space:
+   at the first FAT sector from the hint on that is known to be completely
+   free, so that new files get a run of clusters to themselves instead of
+   being scattered through the holes left behind by deleted ones */
+static unsigned long freemap_run_hint(struct bpb *fat_bpb, unsigned long hint)
+{
+    uint16_t *map = freemap_get(fat_bpb);
+    if (!map || hint == 0xffffffff)
+        return hint;
+
+    unsigned long start = hint / CLUSTERS_PER_FAT_SECTOR;
+
+    for (unsigned long i = 0; i < fat_bpb->fatsize; i++)
+    {
+        unsigned long nr = (i + start) % fat_bpb->fatsize;
+        if (map[nr] == CLUSTERS_PER_FAT_SECTOR)
+            return nr * CLUSTERS_PER_FAT_SECTOR;
+    }
+
+    return hint;
+}
+
+#else /* !FAT_FREE_MAP */
+
+static inline void freemap_init(struct bpb *fat_bpb)
+    { (void)fat_bpb; }
+static inline void freemap_destroy(struct bpb *fat_bpb)
+    { (void)fat_bpb; }
+static inline unsigned int freemap_count32(struct bpb *fat_bpb,
+                                           unsigned long nr,
+                                           const uint32_t *sec)
+    { (void)fat_bpb; (void)nr; (void)sec; return 0; }
+static inline void freemap_set(struct bpb *fat_bpb, unsigned long nr,
+                               unsigned int count)
+    { (void)fat_bpb; (void)nr; (void)count; }
+static inline void freemap_adjust(struct bpb *fat_bpb, unsigned long nr,
+                                  int delta)
+    { (void)fat_bpb; (void)nr; (void)delta; }
+static inline bool freemap_full(struct bpb *fat_bpb, unsigned long nr)
+    { (void)fat_bpb; (void)nr; return false; }
+static inline bool freemap_known(struct bpb *fat_bpb, unsigned long nr)
+    { (void)fat_bpb; (void)nr; return true; }
+static inline unsigned long freemap_run_hint(struct bpb *fat_bpb,
+                                             unsigned long hint)
+    { (void)fat_bpb; return hint; }
+
+#endif /* FAT_FREE_MAP */
+
 static long find_free_cluster32(struct bpb *fat_bpb, long startcluster)
 {
     unsigned long entry = startcluster;
@@ -1047,10 +1288,21 @@ static long find_free_cluster32(struct bpb *fat_bpb, long startcluster)
     for (unsigned long i = 0; i < fat_bpb->fatsize; i++)
     {
         unsigned long nr = (i + sector) % fat_bpb->fatsize;
+
+        /* skip over sectors known to be full without reading them */
+        if (freemap_full(fat_bpb, nr))
+        {
+            offset = 0;
+            continue;
+        }
+
         uint32_t *sec = cache_sector(fat_bpb, nr + fat_bpb->fatrgnstart);
         if (!sec)
             break;
 
+        if (!freemap_known(fat_bpb, nr))
+            freemap_set(fat_bpb, nr, freemap_count32(fat_bpb, nr, sec));
+
         for (unsigned long j = 0; j < CLUSTERS_PER_FAT_SECTOR; j++)
         {
             unsigned long k = (j + offset) % CLUSTERS_PER_FAT_SECTOR;
@@ -1106,14 +1358,22 @@ static int update_fat_entry32(struct bpb *fat_bpb, unsigned long entry,
     if (val)
     {
         /* being allocated */
-        if (!(curval & 0x0fffffff) && fat_bpb->fsinfo.freecount > 0)
-            fat_bpb->fsinfo.freecount--;
+        if (!(curval & 0x0fffffff))
+        {
+            if (fat_bpb->fsinfo.freecount > 0)
+                fat_bpb->fsinfo.freecount--;
+
+            freemap_adjust(fat_bpb, sector, -1);
+        }
     }
     else
     {
         /* being freed */
         if (curval & 0x0fffffff)
+        {
             fat_bpb->fsinfo.freecount++;
+            freemap_adjust(fat_bpb, sector, 1);
+        }
     }
 
     DEBUGF("%lu free clusters\n", (unsigned long)fat_bpb->fsinfo.freecount);
@@ -1136,6 +1396,8 @@ static void fat_recalc_free_internal32(struct bpb *fat_bpb)
         if (!sec)
             break;
 
+        unsigned int count = 0;
+
         for (unsigned long j = 0; j < CLUSTERS_PER_FAT_SECTOR; j++)
         {
             unsigned long c = i * CLUSTERS_PER_FAT_SECTOR + j;
@@ -1146,16 +1408,212 @@ static void fat_recalc_free_internal32(struct bpb *fat_bpb)
             if (letoh32(sec[j]) & 0x0fffffff)
                 continue;
 
-            free++;
+            count++;
             if (fat_bpb->fsinfo.nextfree == 0xffffffff)
                 fat_bpb->fsinfo.nextfree = c;
         }
+
+        freemap_set(fat_bpb, i, count);
+        free += count;
     }
 
     fat_bpb->fsinfo.freecount = free;
     update_fsinfo32(fat_bpb);
 }
 
+
+/** Cluster extent maps **/
+
+#ifdef FAT_EXTENT_MAPS
+/* A map holds the runs of a file's cluster chain from its start up to where
+   it was walked so far or the map got full. Chains are only ever appended
+   to while a file is open, otherwise they are freed, so a map stays valid
+   until clusters are freed on its volume. The maps are looked up again
+   after anything that may yield, since another thread could have taken the
+   map in the meantime. */
+struct fat_extent
+{
+    unsigned long clusternum;   /* cluster number in the file... */
+    long          cluster;      /* ...of the first cluster of the run */
+    unsigned long count;        /* number of clusters in the run */
+};
+
+static struct fat_extent_map
+{
+    struct bpb       *bpb;          /* volume of the file (NULL = unused) */
+    long             firstcluster;  /* first cluster of the file */
+    unsigned long    covered;       /* clusters mapped from the start */
+    unsigned long    lastuse;       /* when last used, for recycling */
+    int              count;         /* runs in ext[] */
+    struct fat_extent ext[FAT_EXTENT_MAP_SIZE];
+} fat_extent_maps[FAT_EXTENT_MAPS];
+
+static unsigned long fat_extent_clock;
+
+/* Return the map of a file, if it has one */
+static struct fat_extent_map * extent_map_find(struct bpb *fat_bpb,
+                                               long firstcluster)
+{
+    for (int i = 0; i < FAT_EXTENT_MAPS; i++)
+    {
+        struct fat_extent_map *map = &fat_extent_maps[i];
+        if (map->bpb == fat_bpb && map->firstcluster == firstcluster)
+        {
+            map->lastuse = ++fat_extent_clock;
+            return map;
+        }
+    }
+
+    return NULL;
+}
+
+/* Return the map of a file, recycling the least recently used one if the
+   file has none yet */
+static struct fat_extent_map * extent_map_get(struct bpb *fat_bpb,
+                                              long firstcluster)
+{
+    if (firstcluster <= 0)
+        return NULL; /* empty file or FAT16 root dir */
+
+    struct fat_extent_map *map = extent_map_find(fat_bpb, firstcluster);
+    if (map)
+        return map;
+
+    map = &fat_extent_maps[0];
+    for (int i = 1; i < FAT_EXTENT_MAPS; i++)
+    {
+        if (fat_extent_maps[i].lastuse < map->lastuse)
+            map = &fat_extent_maps[i];
+    }
+
+    map->bpb               = fat_bpb;
+    map->firstcluster      = firstcluster;
+    map->covered           = 1;
+    map->lastuse           = ++fat_extent_clock;
+    map->count             = 1;
+    map->ext[0].clusternum = 0;
+    map->ext[0].cluster    = firstcluster;
+    map->ext[0].count      = 1;
+    return map;
+}
+
+/* Return the clusternum'th cluster of the file or 0 if it isn't mapped */
+static long extent_map_lookup(const struct fat_extent_map *map,
+                              unsigned long clusternum)
+{
+    if (!map || clusternum >= map->covered)
+        return 0;
+
+    int lo = 0, hi = map->count - 1;
+
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if (map->ext[mid].clusternum <= clusternum)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    return map->ext[lo].cluster + (clusternum - map->ext[lo].clusternum);
+}
+
+/* Return the last mapped cluster of the file and its number in *clusternum
+   or 0 if there is no map */
+static long extent_map_last(const struct fat_extent_map *map,
+                            long *clusternum)
+{
+    if (!map)
+        return 0;
+
+    const struct fat_extent *ext = &map->ext[map->count - 1];
+    *clusternum = map->covered - 1;
+    return ext->cluster + ext->count - 1;
+}
+
+/* Record that cluster is the clusternum'th cluster of the file */
+static void extent_map_note(struct bpb *fat_bpb, long firstcluster,
+                            unsigned long clusternum, long cluster)
+{
+    struct fat_extent_map *map = extent_map_find(fat_bpb, firstcluster);
+
+    /* only the next cluster after the mapped ones can be added */
+    if (!map || clusternum != map->covered)
+        return;
+
+    struct fat_extent *ext = &map->ext[map->count - 1];
+
+    if (cluster != ext->cluster + (long)ext->count)
+    {
+        if (map->count >= FAT_EXTENT_MAP_SIZE)
+            return; /* full; the rest of the file needs walking */
+
+        ext++;
+        map->count++;
+        ext->clusternum = clusternum;
+        ext->cluster    = cluster;
+        ext->count      = 0;
+    }
+
+    ext->count++;
+    map->covered++;
+}
+
+/* Forget all maps of a volume; called when any of its clusters are freed */
+static void extent_maps_discard(struct bpb *fat_bpb)
+{
+    for (int i = 0; i < FAT_EXTENT_MAPS; i++)
+    {
+        if (fat_extent_maps[i].bpb == fat_bpb)
+        {
+            fat_extent_maps[i].bpb = NULL;
+            fat_extent_maps[i].lastuse = 0;
+        }
+    }
+}
+#else /* !FAT_EXTENT_MAPS */
+struct fat_extent_map;
+
+static inline struct fat_extent_map * extent_map_find(struct bpb *fat_bpb,
+                                                      long firstcluster)
+{
+    return NULL;
+    (void)fat_bpb; (void)firstcluster;
+}
+
+static inline struct fat_extent_map * extent_map_get(struct bpb *fat_bpb,
+                                                     long firstcluster)
+{
+    return NULL;
+    (void)fat_bpb; (void)firstcluster;
+}
+
+static inline long extent_map_lookup(const struct fat_extent_map *map,
+                                     unsigned long clusternum)
+{
+    return 0;
+    (void)map; (void)clusternum;
+}
+
+static inline long extent_map_last(const struct fat_extent_map *map,
+                                   long *clusternum)
+{
+    return 0;
+    (void)map; (void)clusternum;
+}
+
+static inline void extent_map_note(struct bpb *fat_bpb, long firstcluster,
+                                   unsigned long clusternum, long cluster)
+{
+    (void)fat_bpb; (void)firstcluster; (void)clusternum; (void)cluster;
+}
+
+static inline void extent_maps_discard(struct bpb *fat_bpb)
+{
+    (void)fat_bpb;
+}
+#endif /* FAT_EXTENT_MAPS */
+
 static int fat_mount_internal(struct bpb *fat_bpb)
 {
     int rc;
@@ -1394,8 +1852,10 @@ static long next_write_cluster(struct bpb *fat_bpb, long oldcluster)
 
         dc_lock_cache();
 
+        /* a new chain starts in free space of its own if there is any */
         long findstart = oldcluster > 0 ?
-            oldcluster + 1 : (long)fat_bpb->fsinfo.nextfree;
+            oldcluster + 1 : (long)freemap_run_hint(fat_bpb,
+                                                   fat_bpb->fsinfo.nextfree);
 
         cluster = find_free_cluster(fat_bpb, findstart);
 
@@ -1452,7 +1912,7 @@ static int fat_extend_dir(struct bpb *fat_bpb, struct fat_filestr *dirstr)
     {
         dc_lock_cache();
 
-        void *sec = cache_sector_buffer(IF_MV(fat_bpb,) ++sector);
+        void *sec = cache_sector_buffer(fat_bpb, ++sector);
         if (!sec)
         {
             dc_unlock_cache();
@@ -2015,6 +2475,8 @@ static int free_direntries(struct bpb *fat_bpb, struct fat_file *file)
 
 static int free_cluster_chain(struct bpb *fat_bpb, long startcluster)
 {
+    extent_maps_discard(fat_bpb);
+
     for (long last = startcluster, next; last; last = next)
     {
         next = get_next_cluster(fat_bpb, last);
@@ -2394,6 +2856,7 @@ int fat_closewrite(struct fat_filestr *filestr, uint32_t size,
     if (!size && file->firstcluster)
     {
         /* empty file */
+        extent_maps_discard(fat_bpb);
         rc = update_fat_entry(fat_bpb, file->firstcluster, 0);
         if (rc < 0)
             FAT_ERROR(rc * 10 - 2);
@@ -2458,9 +2921,50 @@ sector_t fat_query_sectornum(const struct fat_filestr *filestr)
     return fat_bpb->bpb_secperclus*filestr->clusternum + filestr->sectornum + 1;
 }
 
+#ifdef HAVE_STORAGE_ASYNC
+/* requests a read may be queued into rather than done at once */
+struct fat_async
+{
+    struct storage_request *reqs;
+    int count;
+    int max;
+};
+
+/* queue a read of file sectors instead of waiting for it; returns false if
+   the read must be done synchronously */
+static bool transfer_async(struct bpb *fat_bpb, struct fat_async *fa,
+                           sector_t start, long count, char *buf)
+{
+    if (!fa || fa->count >= fa->max)
+        return false;
+
+#ifdef STORAGE_NEEDS_BOUNCE_BUFFER
+    if (STORAGE_OVERLAP((uintptr_t)buf))
+        return false;
+#endif
+
+    struct storage_request *req = &fa->reqs[fa->count++];
+#ifdef HAVE_MULTIDRIVE
+    req->drive    = fat_bpb->drive;
+#endif
+    req->start    = start + fat_bpb->startsector;
+    req->count    = count;
+    req->buf      = buf;
+    req->secsize  = LOG_SECTOR_SIZE(fat_bpb);
+    req->flags    = 0;
+    req->callback = NULL;
+    storage_request_submit(req);
+    return true;
+}
+#else
+struct fat_async;
+#define transfer_async(fat_bpb, fa, start, count, buf) \
+    ({ (void)(fa); false; })
+#endif /* HAVE_STORAGE_ASYNC */
+
 /* helper for fat_readwrite */
-static long transfer(struct bpb *fat_bpb, sector_t start, long count,
-                     char *buf, bool write)
+static long transfer(struct bpb *fat_bpb, struct fat_async *fa,
+                     sector_t start, long count, char *buf, bool write)
 {
     long rc = 0;
 
@@ -2486,6 +2990,10 @@ static long transfer(struct bpb *fat_bpb, sector_t start, long count,
                    (uint64_t)(start + count - fat_bpb->totalsectors));
         }
     }
+    else if (transfer_async(fat_bpb, fa, start, count, buf))
+    {
+        return 0;
+    }
 
 #ifdef STORAGE_NEEDS_BOUNCE_BUFFER
     if(UNLIKELY(STORAGE_OVERLAP((uintptr_t)buf))) {
@@ -2533,8 +3041,8 @@ static long transfer(struct bpb *fat_bpb, sector_t start, long count,
     return 0;
 }
 
-long fat_readwrite(struct fat_filestr *filestr, unsigned long sectorcount,
-                   void *buf, bool write)
+static long readwrite(struct fat_filestr *filestr, unsigned long sectorcount,
+                      void *buf, bool write, struct fat_async *fa)
 {
     struct fat_file * const file = filestr->fatfilep;
     struct bpb * const fat_bpb = FAT_BPB(file->volume);
@@ -2603,8 +3111,26 @@ long fat_readwrite(struct fat_filestr *filestr, unsigned long sectorcount,
         if (++sectornum >= fat_bpb->bpb_secperclus)
         {
             /* out of sectors in this cluster; get the next cluster */
-            long newcluster = write ? next_write_cluster(fat_bpb, cluster) :
-                                      get_next_cluster(fat_bpb, cluster);
+            long newcluster = 0;
+
+            if (!write)
+            {
+                newcluster = extent_map_lookup(
+                    extent_map_find(fat_bpb, file->firstcluster),
+                    clusternum + 1);
+            }
+
+            if (!newcluster)
+            {
+                newcluster = write ? next_write_cluster(fat_bpb, cluster) :
+                                     get_next_cluster(fat_bpb, cluster);
+                if (newcluster)
+                {
+                    extent_map_note(fat_bpb, file->firstcluster,
+                                    clusternum + 1, newcluster);
+                }
+            }
+
             if (newcluster)
             {
                 cluster = newcluster;
@@ -2628,7 +3154,7 @@ long fat_readwrite(struct fat_filestr *filestr, unsigned long sectorcount,
         if (sector != last || count >= FAT_MAX_TRANSFER_SIZE)
         {
             /* not sequential/over limit */
-            rc = transfer(fat_bpb, last - count + 1, count, buf, write);
+            rc = transfer(fat_bpb, fa, last - count + 1, count, buf, write);
             if (rc < 0)
                 FAT_ERROR(rc * 10 - 2);
 
@@ -2644,7 +3170,7 @@ long fat_readwrite(struct fat_filestr *filestr, unsigned long sectorcount,
     if (count)
     {
         /* transfer any remainder */
-        rc = transfer(fat_bpb, last - count + 1, count, buf, write);
+        rc = transfer(fat_bpb, fa, last - count + 1, count, buf, write);
         if (rc < 0)
             FAT_ERROR(rc * 10 - 3);
 
@@ -2665,6 +3191,27 @@ fat_error:
     return rc;
 }
 
+long fat_readwrite(struct fat_filestr *filestr, unsigned long sectorcount,
+                   void *buf, bool write)
+{
+    return readwrite(filestr, sectorcount, buf, write, NULL);
+}
+
+#ifdef HAVE_STORAGE_ASYNC
+/* like reading with fat_readwrite() but the runs of contiguous sectors are
+   queued as storage requests, up to 'max' of them, and *countp is set to how
+   many were; the data is there only once these are done */
+long fat_read_async(struct fat_filestr *filestr, unsigned long sectorcount,
+                    void *buf, struct storage_request *reqs, int *countp,
+                    int max)
+{
+    struct fat_async fa = { .reqs = reqs, .count = 0, .max = max };
+    long rc = readwrite(filestr, sectorcount, buf, false, &fa);
+    *countp = fa.count;
+    return rc;
+}
+#endif /* HAVE_STORAGE_ASYNC */
+
 void fat_rewind(struct fat_filestr *filestr)
 {
     /* rewind the file position */
@@ -2720,13 +3267,33 @@ int fat_seek(struct fat_filestr *filestr, unsigned long seeksector)
         clusternum = seeksector / fat_bpb->bpb_secperclus;
         sectornum = seeksector % fat_bpb->bpb_secperclus;
 
+        long firstcluster = cluster;
         long numclusters = clusternum;
+        long fromnum = 0;
 
-        if (filestr->clusternum && clusternum >= filestr->clusternum)
+        struct fat_extent_map *map = extent_map_get(fat_bpb, firstcluster);
+        long mapped = extent_map_lookup(map, clusternum);
+
+        if (mapped)
+        {
+            /* it's on the map */
+            cluster = mapped;
+            numclusters = 0;
+        }
+        else if ((mapped = extent_map_last(map, &fromnum)))
+        {
+            /* walk on from the end of the map */
+            cluster = mapped;
+            numclusters -= fromnum;
+        }
+
+        if (filestr->clusternum && clusternum >= filestr->clusternum &&
+            filestr->clusternum > fromnum && numclusters)
         {
             /* seek forward from current position */
+            fromnum = filestr->clusternum;
             cluster = filestr->lastcluster;
-            numclusters -= filestr->clusternum;
+            numclusters = clusternum - fromnum;
         }
 
         for (long i = 0; i < numclusters; i++)
@@ -2739,6 +3306,8 @@ int fat_seek(struct fat_filestr *filestr, unsigned long seeksector)
                        "(sector %lu, cluster %ld)\n", seeksector, i);
                 FAT_ERROR(FAT_SEEK_EOF);
             }
+
+            extent_map_note(fat_bpb, firstcluster, ++fromnum, cluster);
         }
 
         sector = cluster2sec(fat_bpb, cluster) + sectornum;
@@ -2790,6 +3359,111 @@ fat_error:
     return rc;
 }
 
+int fat_preallocate(struct fat_filestr *filestr, unsigned long sectorcount)
+{
+    DEBUGF("%s(): %lu\n", __func__, sectorcount);
+
+    struct fat_file * const file = filestr->fatfilep;
+    struct bpb * const fat_bpb = FAT_BPB(file->volume);
+    if (!fat_bpb)
+        return -1;
+
+    long first = file->firstcluster;
+
+#ifdef HAVE_FAT16SUPPORT
+    if (first < 0)
+        return -2; /* the FAT16 root dir can't grow */
+#endif /* HAVE_FAT16SUPPORT */
+
+    long want = sectorcount / fat_bpb->bpb_secperclus +
+                (sectorcount % fat_bpb->bpb_secperclus ? 1 : 0);
+    long last = first;
+    long clusternum = first ? 0 : -1;
+
+    if (first)
+    {
+        /* go to the end of the chain from as far along as is known */
+        long fromnum;
+        long mapped = extent_map_last(extent_map_get(fat_bpb, first),
+                                      &fromnum);
+        if (mapped)
+        {
+            last = mapped;
+            clusternum = fromnum;
+        }
+
+        if (filestr->lastcluster > 0 && filestr->clusternum > clusternum)
+        {
+            last = filestr->lastcluster;
+            clusternum = filestr->clusternum;
+        }
+
+        while (clusternum + 1 < want)
+        {
+            long next = get_next_cluster(fat_bpb, last);
+            if (!next)
+                break;
+
+            last = next;
+            extent_map_note(fat_bpb, first, ++clusternum, next);
+        }
+    }
+
+    if (clusternum + 1 >= want)
+        return 0; /* already there */
+
+    int rc = 0;
+
+    dc_lock_cache();
+
+    /* a new chain starts in free space of its own if there is any */
+    long findstart = last ? last + 1 :
+        (long)freemap_run_hint(fat_bpb, fat_bpb->fsinfo.nextfree);
+
+    while (clusternum + 1 < want)
+    {
+        long cluster = find_free_cluster(fat_bpb, findstart);
+
+        if (cluster && last && cluster != last + 1 &&
+            clusternum + 2 < want)
+        {
+            /* the run ended; rather than filling the gaps in used space with
+               what's still to come, continue where there is room for it */
+            long runstart = freemap_run_hint(fat_bpb, cluster);
+            if (runstart != cluster)
+            {
+                long runcluster = find_free_cluster(fat_bpb, runstart);
+                if (runcluster)
+                    cluster = runcluster;
+            }
+        }
+
+        if (!cluster)
+        {
+            DEBUGF("Disk full!\n");
+            rc = FAT_RC_ENOSPC;
+            break;
+        }
+
+        update_fat_entry(fat_bpb, cluster, FAT_EOF_MARK);
+
+        if (last)
+            update_fat_entry(fat_bpb, last, cluster);
+        else
+            file->firstcluster = first = cluster;
+
+        extent_map_note(fat_bpb, first, ++clusternum, cluster);
+        last = cluster;
+        findstart = cluster + 1;
+    }
+
+    dc_unlock_cache();
+
+    /* the FAT sectors touched go out together */
+    cache_commit(fat_bpb);
+    return rc;
+}
+
 
 /** Directory stream functions **/
 
@@ -2955,6 +3629,9 @@ int fat_mount(IF_MV(int volume,) IF_MD(int drive,) unsigned long startsector)
 #if defined(MAX_VIRT_SECTOR_SIZE) || defined(MAX_VARIABLE_LOG_SECTOR)
     fat_bpb->sector_size = disk_get_log_sector_size(IF_MD(drive));
 #endif
+#ifdef FAT_READAHEAD_SIZE
+    fat_bpb->fat_ra_next = 0;
+#endif
 
     rc = fat_mount_internal(fat_bpb);
     if (rc < 0)
@@ -2963,6 +3640,8 @@ int fat_mount(IF_MV(int volume,) IF_MD(int drive,) unsigned long startsector)
     /* it worked */
     fat_bpb->mounted = true;
 
+    freemap_init(fat_bpb);
+
     /* calculate freecount if unset */
     if (fat_bpb->fsinfo.freecount == 0xffffffff)
         fat_recalc_free(IF_MV(fat_bpb->volume));
@@ -2986,6 +3665,8 @@ int fat_unmount(IF_MV_NONVOID(int volume))
 
     /* free the entries for this volume */
     cache_discard(IF_MV(fat_bpb));
+    extent_maps_discard(fat_bpb);
+    freemap_destroy(fat_bpb);
     fat_bpb->mounted = false;
 
     return 0;
@@ -3038,10 +3719,11 @@ bool fat_size(IF_MV(int volume,) sector_t *size, sector_t *free)
     if (!fat_bpb)
         return false;
 
-    unsigned long factor = fat_bpb->bpb_secperclus * LOG_SECTOR_SIZE(fat_bpb) / 1024;
+    /* in half-KiB, so that clusters smaller than 1 KiB don't count as 0 */
+    unsigned long factor = fat_bpb->bpb_secperclus * LOG_SECTOR_SIZE(fat_bpb) / 512;
 
-    if (size) *size = fat_bpb->dataclusters * factor;
-    if (free) *free = fat_bpb->fsinfo.freecount * factor;
+    if (size) *size = (sector_t)fat_bpb->dataclusters * factor / 2;
+    if (free) *free = (sector_t)fat_bpb->fsinfo.freecount * factor / 2;
 
     return true;
 }
@@ -609,9 +609,14 @@ static inline ssize_t readwrite_partial(struct filestr_desc *file,
     return nbyte;
 }
 
-/* read from or write to the file; back end to read() and write() */
+#ifndef HAVE_STORAGE_ASYNC
+struct file_async;
+#endif
+
+/* read from or write to the file; back end to read() and write(); a read given
+   'fa' queues whole sector runs instead of waiting for them */
 static ssize_t readwrite(struct filestr_desc *file, void *buf, size_t nbyte,
-                         bool write)
+                         bool write, struct file_async *fa)
 {
 #ifndef LOGF_ENABLE /* wipes out log before you can save it */
     DEBUGF("readwrite(%p,%lx,%lu,%s)\n",
@@ -723,7 +728,24 @@ static ssize_t readwrite(struct filestr_desc *file, void *buf, size_t nbyte,
                 }
             }
 
+#ifdef HAVE_STORAGE_ASYNC
+            if (fa)
+            {
+                int queued;
+                rc = fat_read_async(&file->stream.fatstr, runlen, buf,
+                                    &fa->req[fa->count], &queued,
+                                    FILE_ASYNC_RUNS - fa->count);
+                fa->count += queued;
+            }
+            else
+            {
+                rc = fat_readwrite(&file->stream.fatstr, runlen, buf, write);
+            }
+#else /* !HAVE_STORAGE_ASYNC */
+            (void)fa;
             rc = fat_readwrite(&file->stream.fatstr, runlen, buf, write);
+#endif /* HAVE_STORAGE_ASYNC */
+
             if (rc < 0)
             {
                 DEBUGF("I/O error %sing %ld sectors\n",
@@ -889,6 +911,52 @@ file_error:
     return rc;
 }
 
+/* reserve space for the file to grow to the specified length without
+   changing its size; what isn't used is given back by fsync() or close() */
+int fpreallocate(int fildes, off_t length)
+{
+    DEBUGF("fpreallocate(fd=%d,len=%ld)\n", fildes, (long)length);
+
+    struct filestr_desc * const file = GET_FILESTR(READER, fildes);
+    if (!file)
+        FILE_ERROR_RETURN(ERRNO, -1);
+
+    int rc;
+
+    if (!(file->stream.flags & FD_WRITE))
+    {
+        DEBUGF("Descriptor is read-only mode\n");
+        FILE_ERROR(EBADF, -2);
+    }
+
+    if (length < 0)
+    {
+        DEBUGF("Length %ld is invalid\n", (long)length);
+        FILE_ERROR(EINVAL, -3);
+    }
+
+    if ((uint64_t)length > FILE_SIZE_MAX)
+        FILE_ERROR(EFBIG, -4);
+
+    uint16_t sector_size = fat_file_sector_size(IF_MV(file->stream.fatstr.fatfilep));
+
+    fileobj_change_flags(&file->stream, FO_TRUNC, FO_TRUNC);
+
+    rc = fat_preallocate(&file->stream.fatstr,
+                         filesize_sectors(sector_size, length));
+    if (rc < 0)
+    {
+        if (rc == FAT_RC_ENOSPC)
+            FILE_ERROR(ENOSPC, -5);
+        else
+            FILE_ERROR(EIO, rc * 10 - 6);
+    }
+
+file_error:
+    RELEASE_FILESTR(READER, file);
+    return rc;
+}
+
 /* synchronize changes to a file */
 int fsync(int fildes)
 {
@@ -951,15 +1019,98 @@ ssize_t read(int fildes, void *buf, size_t nbyte)
         FILE_ERROR(EBADF, -2);
     }
 
-    rc = readwrite(file, buf, nbyte, false);
+    rc = readwrite(file, buf, nbyte, false, NULL);
+    if (rc < 0)
+        FILE_ERROR(ERRNO, rc * 10 - 3);
+
+file_error:
+    RELEASE_FILESTR(READER, file);
+    return rc;
+}
+
+#ifdef HAVE_STORAGE_ASYNC
+/* wait for all requests of an asynchronous read; returns the first error */
+static int read_async_wait(struct file_async *fa)
+{
+    int rc = 0;
+
+    for (int i = 0; i < fa->count; i++)
+    {
+        int reqrc = storage_request_wait(&fa->req[i]);
+        if (reqrc < 0 && rc == 0)
+            rc = reqrc;
+    }
+
+    return rc;
+}
+
+/* start reading from a file; the bytes are in the buffer only once
+   read_finish() returns, which must be called if this doesn't fail */
+ssize_t read_submit(int fildes, void *buf, size_t nbyte,
+                    struct file_async *fa)
+{
+    fa->nbyte = 0;
+    fa->count = 0;
+
+    struct filestr_desc * const file = GET_FILESTR(READER, fildes);
+    if (!file)
+        FILE_ERROR_RETURN(ERRNO, -1);
+
+    ssize_t rc;
+
+    if (file->stream.flags & FD_WRONLY)
+    {
+        DEBUGF("read_submit(fd=%d,buf=%p,nb=%lu) - "
+               "descriptor is write-only mode\n",
+               fildes, buf, (unsigned long)nbyte);
+        FILE_ERROR(EBADF, -2);
+    }
+
+    rc = readwrite(file, buf, nbyte, false, fa);
     if (rc < 0)
+    {
+        /* nothing may be left writing into the buffer */
+        read_async_wait(fa);
+        fa->count = 0;
         FILE_ERROR(ERRNO, rc * 10 - 3);
+    }
+
+    fa->nbyte = rc;
 
 file_error:
     RELEASE_FILESTR(READER, file);
     return rc;
 }
 
+/* is a read started by read_submit() done? */
+bool read_poll(struct file_async *fa)
+{
+    for (int i = 0; i < fa->count; i++)
+    {
+        if (!storage_request_poll(&fa->req[i]))
+            return false;
+    }
+
+    return true;
+}
+
+/* wait for a read started by read_submit() to be done and return the number of
+   bytes read, like read() */
+ssize_t read_finish(struct file_async *fa)
+{
+    int rc = read_async_wait(fa);
+    fa->count = 0;
+
+    if (rc < 0)
+    {
+        DEBUGF("read_finish - I/O error %d\n", rc);
+        FILE_ERROR_RETURN(EIO, -1);
+    }
+
+    return fa->nbyte;
+}
+#endif /* HAVE_STORAGE_ASYNC */
+
 /* write on a file */
 ssize_t write(int fildes, const void *buf, size_t nbyte)
 {
@@ -977,7 +1128,7 @@ ssize_t write(int fildes, const void *buf, size_t nbyte)
         FILE_ERROR(EBADF, -2);
     }
 
-    rc = readwrite(file, (void *)buf, nbyte, true);
+    rc = readwrite(file, (void *)buf, nbyte, true, NULL);
     if (rc < 0)
         FILE_ERROR(ERRNO, rc * 10 - 3);
 
@@ -454,13 +454,19 @@ static NO_INLINE int open_path_component(struct pathwalk *walkp,
     fat_filestr_init(&stream->fatstr, &parentp->info.fatfile);
     rewinddir_internal(&compp->info);
 
-    while ((rc = readdir_internal(stream, &compp->info, &dir_fatent)) > 0)
+    /* the cache may know without a scan */
+    rc = find_internal(stream, &compp->info, compname, &dir_fatent);
+
+    if (rc < 0)
     {
-        if (rc > 1 && !(callflags & FF_NOISO))
-            iso_decode_d_name(dir_fatent.name);
+        while ((rc = readdir_internal(stream, &compp->info, &dir_fatent)) > 0)
+        {
+            if (rc > 1 && !(callflags & FF_NOISO))
+                iso_decode_d_name(dir_fatent.name);
 
-        if (!strcasecmp(compname, dir_fatent.name))
-            break;
+            if (!strcasecmp(compname, dir_fatent.name))
+                break;
+        }
     }
 
     if (rc == 0)
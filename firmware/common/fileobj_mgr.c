@@ -53,6 +53,22 @@ static struct mutex stream_mutexes[MAX_FILEOBJS] SHAREDBSS_ATTR;
 static struct ll_head free_bindings;
 static struct ll_head busy_bindings[NUM_VOLUMES];
 
+/* the last few directories whose entries changed, so that a caller holding
+   on to a listing can tell if it is still current without reading it again */
+#define DIR_CHANGE_LOG_SIZE 16
+static struct dir_change
+{
+#ifdef HAVE_MULTIVOLUME
+    int           volume;     /* volume of the directory */
+#endif
+    long          dircluster; /* first cluster of the directory */
+    unsigned int  serial;     /* serial number of its latest change */
+} dir_change_log[DIR_CHANGE_LOG_SIZE];
+static unsigned int dir_change_serial; /* serial number of the latest change */
+static unsigned int dir_change_floor;  /* serial numbers before this one can't
+                                          be trusted (mount/unmount) */
+static unsigned int dir_change_next;   /* next log slot to fill */
+
 #define BUSY_BINDINGS(volume) \
     (&busy_bindings[IF_MV_VOL(volume)])
 
@@ -94,11 +110,45 @@ static struct ll_head busy_bindings[NUM_VOLUMES];
                __func__, (fobp), (callflags));                   \
     }
 
+/* records that the entries of the file's parent directory have changed */
+static void dir_change_record(const struct file_base_info *infop)
+{
+    const struct fat_file *file = &infop->fatfile;
+    struct dir_change *last =
+        &dir_change_log[(dir_change_next - 1) % DIR_CHANGE_LOG_SIZE];
+
+    dir_change_serial++;
+
+    /* repeated changes in one directory (eg. a file being written and
+       synced over and over) shouldn't push everything else out */
+    if (dir_change_serial - last->serial != 1 ||
+        last->dircluster != file->dircluster
+            IF_MV( || last->volume != file->volume ))
+    {
+        last = &dir_change_log[dir_change_next++ % DIR_CHANGE_LOG_SIZE];
+#ifdef HAVE_MULTIVOLUME
+        last->volume = file->volume;
+#endif
+        last->dircluster = file->dircluster;
+    }
+
+    last->serial = dir_change_serial;
+}
+
+/* anything listed before now is to be considered stale */
+static void dir_change_reset(void)
+{
+    dir_change_floor = ++dir_change_serial;
+}
+
 /* syncs information for the stream's old and new parent directory if any are
    currently opened */
 static void fileobj_sync_parent(const struct file_base_info *infop[],
                                 int count)
 {
+    for (int i = 0; i < count; i++)
+        dir_change_record(infop[i]);
+
     FOR_EACH_BINDING(infop[0]->volume, fobp)
     {
         if ((fobp->flags & (FO_DIRECTORY|FO_REMOVED)) != FO_DIRECTORY)
@@ -409,9 +459,56 @@ void fileobj_change_flags(struct filestr_base *stream,
     fobp->flags = (fobp->flags & ~mask) | (flags & mask);
 }
 
+/* returns the serial number of the latest directory change */
+unsigned int fileobj_mgr_change_serial(void)
+{
+    return dir_change_serial;
+}
+
+/* returns true if the directory's entries may have changed after 'serial' */
+bool fileobj_mgr_dir_changed(const struct file_base_info *dirinfop,
+                             unsigned int serial)
+{
+    if ((int)(serial - dir_change_floor) < 0)
+        return true; /* there was a mount or unmount since */
+
+    if (serial == dir_change_serial)
+        return false;
+
+    if (!dirinfop)
+        return false; /* only mounting changes a bare namespace directory */
+
+    const struct fat_file *dir = &dirinfop->fatfile;
+
+    for (unsigned int i = 1; i <= DIR_CHANGE_LOG_SIZE; i++)
+    {
+        const struct dir_change *change =
+            &dir_change_log[(dir_change_next - i) % DIR_CHANGE_LOG_SIZE];
+
+        if ((int)(change->serial - serial) <= 0)
+            return false; /* rest of the log is older */
+
+        if (change->dircluster == dir->firstcluster
+                IF_MV( && change->volume == dir->volume ))
+            return true;
+    }
+
+    /* more directories changed than were logged */
+    return true;
+}
+
+/* a volume was mounted */
+void fileobj_mgr_mount(IF_MV_NONVOID(int volume))
+{
+    IF_MV( (void)volume; )
+    dir_change_reset();
+}
+
 /* mark all open streams on a device as "nonexistant" */
 void fileobj_mgr_unmount(IF_MV_NONVOID(int volume))
 {
+    dir_change_reset();
+
     FOR_EACH_VOLUME(volume, v)
     {
         struct fileobj_binding *fobp;
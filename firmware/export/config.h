@@ -978,6 +978,33 @@ Lyre prototype 1 */
 #define HAVE_PICTUREFLOW_INTEGRATION
 #endif
 
+/* Measure the loudness of untagged tracks in the background and keep it in
+ * the database */
+#if defined(HAVE_TAGCACHE) && (MEMORYSIZE >= 8) && !defined(BOOTLOADER) \
+    && !defined(__PCTOOL__)
+#define HAVE_LOUDNESS_SCAN
+#endif
+
+/* Decode lossy formats ahead into a larger PCM buffer in bursts, letting the
+ * CPU sleep in between */
+#if (MEMORYSIZE >= 8) && !defined(BOOTLOADER) && !defined(__PCTOOL__)
+#define HAVE_BURST_DECODE
+#endif
+
+/* Carry out storage requests in a thread of their own, most urgent first and
+ * in sector order otherwise, so that callers can go on while they are done */
+#if (CONFIG_PLATFORM & PLATFORM_NATIVE) && (MEMORYSIZE >= 8) \
+    && !defined(BOOTLOADER) && !defined(__PCTOOL__)
+#define HAVE_STORAGE_ASYNC
+#endif
+
+/* Account storage traffic to the subsystems causing it and keep a trace of
+ * the latest transfers */
+#if (CONFIG_PLATFORM & PLATFORM_NATIVE) && !defined(BOOTLOADER) \
+    && !defined(__PCTOOL__)
+#define HAVE_STORAGE_TRACE
+#endif
+
 #ifdef BOOTLOADER
 
 #ifdef HAVE_BOOTLOADER_USB_MODE
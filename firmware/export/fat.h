@@ -160,11 +160,18 @@ void fat_filestr_init(struct fat_filestr *filestr, struct fat_file *file);
 sector_t fat_query_sectornum(const struct fat_filestr *filestr);
 long fat_readwrite(struct fat_filestr *filestr, unsigned long sectorcount,
                    void *buf, bool write);
+#ifdef HAVE_STORAGE_ASYNC
+struct storage_request;
+long fat_read_async(struct fat_filestr *filestr, unsigned long sectorcount,
+                    void *buf, struct storage_request *reqs, int *countp,
+                    int max);
+#endif
 void fat_rewind(struct fat_filestr *filestr);
 int fat_seek(struct fat_filestr *filestr, unsigned long sector);
 void fat_seek_to_stream(struct fat_filestr *filestr,
                         const struct fat_filestr *filestr_seek_to);
 int fat_truncate(const struct fat_filestr *filestr);
+int fat_preallocate(struct fat_filestr *filestr, unsigned long sectorcount);
 
 /** Directory stream functions **/
 struct filestr_cache;
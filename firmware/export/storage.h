@@ -335,4 +335,107 @@ int storage_driver_type(int drive);
 
 int storage_read_sectors(IF_MD(int drive,) sector_t start, int count, void* buf);
 int storage_write_sectors(IF_MD(int drive,) sector_t start, int count, const void* buf);
+
+#ifdef HAVE_STORAGE_ASYNC
+/* Asynchronous requests, carried out by the storage I/O thread. Requests of
+ * higher priority threads go first, the others in ascending sector order from
+ * where the last transfer ended. Requests that continue one another on the
+ * disk and in memory are done in a single transfer. While requests are queued,
+ * storage_read_sectors() and storage_write_sectors() queue theirs as well.
+ */
+enum storage_request_flags
+{
+    STORAGE_REQ_WRITE = 0x1, /* write instead of read */
+};
+
+#define STORAGE_REQ_PENDING 1 /* rc of a request not done yet */
+
+struct storage_request
+{
+    /* set by the submitter */
+#ifdef HAVE_MULTIDRIVE
+    int drive;              /* drive to transfer from/to */
+#endif
+    sector_t start;         /* first sector */
+    int count;              /* number of sectors */
+    void *buf;              /* data */
+    unsigned int secsize;   /* bytes per sector, or 0 to never merge */
+    unsigned int flags;     /* storage_request_flags */
+    /* called by the I/O thread with the result once done, before the
+       request is marked done; may be NULL */
+    void (*callback)(struct storage_request *req, int rc);
+    /* set by the queue */
+    volatile int rc;        /* STORAGE_REQ_PENDING, then 0 or error */
+    int priority;           /* priority of the submitting thread */
+#ifdef HAVE_STORAGE_TRACE
+    int origin;             /* storage_origin of the submitting thread */
+#endif
+    struct storage_request *next;   /* next queued */
+    struct storage_request *merged; /* next done by the same transfer */
+    struct semaphore done;  /* released when done */
+};
+
+void storage_request_submit(struct storage_request *req);
+bool storage_request_poll(struct storage_request *req);
+int storage_request_wait(struct storage_request *req);
+#endif /* HAVE_STORAGE_ASYNC */
+
+/* Subsystems that storage traffic is accounted to. A thread's transfers go
+ * to the origin it last set; threads that never set one count as "other". */
+enum storage_origin
+{
+    STORAGE_ORIGIN_OTHER = 0,
+    STORAGE_ORIGIN_BUFFERING,   /* buffering thread */
+    STORAGE_ORIGIN_AUDIO,       /* audio and codec threads */
+    STORAGE_ORIGIN_TAGCACHE,    /* database */
+    STORAGE_ORIGIN_DIRCACHE,    /* directory cache scans */
+    STORAGE_ORIGIN_PLAYLIST,    /* playlist control file */
+    STORAGE_ORIGIN_SETTINGS,    /* settings and resume info */
+    STORAGE_ORIGIN_FONT,        /* glyphs and glyph cache */
+    STORAGE_NUM_ORIGINS
+};
+
+#ifdef HAVE_STORAGE_TRACE
+enum storage_trace_flags
+{
+    STORAGE_TRACE_WRITE = 0x1,  /* a write */
+    STORAGE_TRACE_WAKE  = 0x2,  /* storage was idle; for disks, a spin-up */
+    STORAGE_TRACE_ERROR = 0x4,  /* the transfer failed */
+};
+
+/* most recent transfers kept by the trace */
+#define STORAGE_TRACE_SIZE 128
+
+struct storage_trace_entry
+{
+    long          tick;         /* when it was done */
+    sector_t      start;        /* first sector */
+    unsigned int  count;        /* number of sectors */
+#ifdef HAVE_MULTIDRIVE
+    unsigned char drive;
+#endif
+    unsigned char origin;       /* storage_origin */
+    unsigned char flags;        /* storage_trace_flags */
+};
+
+struct storage_origin_stats
+{
+    unsigned long transfers;    /* requests done */
+    unsigned long read;         /* sectors read */
+    unsigned long written;      /* sectors written */
+    unsigned long wakes;        /* transfers that woke up idle storage */
+};
+
+/* set the calling thread's origin; returns the previous one to restore */
+int storage_set_origin(int origin);
+/* copy out the counters, indexed by origin */
+void storage_get_origin_stats(struct storage_origin_stats *stats);
+void storage_reset_origin_stats(void);
+/* copy out up to 'max' of the latest transfers, oldest first; returns the
+   number copied */
+int storage_get_trace(struct storage_trace_entry *entries, int max);
+#else
+static inline int storage_set_origin(int origin)
+    { (void)origin; return STORAGE_ORIGIN_OTHER; }
+#endif /* HAVE_STORAGE_TRACE */
 #endif
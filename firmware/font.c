@@ -37,6 +37,7 @@
 #include "string-extra.h"
 #include "font.h"
 #include "file.h"
+#include "storage.h"
 #include "core_alloc.h"
 #include "debug.h"
 #include "panic.h"
@@ -739,6 +740,7 @@ load_cache_entry(struct font_cache_entry* p, void* callback_data)
 
     ucschar_t char_code = p->_char_code;
     int fd;
+    int origin = storage_set_origin(STORAGE_ORIGIN_FONT);
 
     lock_font_handle(pf->handle, true);
     if (pf->file_width_offset)
@@ -789,6 +791,7 @@ load_cache_entry(struct font_cache_entry* p, void* callback_data)
     read(pf->fd, p->bitmap, src_bytes);
 
     lock_font_handle(pf->handle, false);
+    storage_set_origin(origin);
 }
 
 /*
@@ -947,6 +950,7 @@ static void glyph_cache_save(int font_id)
     {
         char filename[MAX_PATH];
         font_path_to_glyph_path(pdata->path, filename);
+        int origin = storage_set_origin(STORAGE_ORIGIN_FONT);
         fd = open(filename, O_WRONLY|O_CREAT|O_TRUNC, 0666);
         if (fd >= 0)
         {
@@ -962,6 +966,7 @@ static void glyph_cache_save(int font_id)
                 cache_fd = -1;
             }
         }
+        storage_set_origin(origin);
     }
     core_put_data_pinned(pdata);
     return;
@@ -51,6 +51,12 @@
 #define DIRCACHE_MIN     (1024*1024*1) /* 1 MB - provision min size */
 #define DIRCACHE_LIMIT   (1024*1024*6) /* 6 MB - provision max size */
 
+/* directories holding at least this many entries get a name hash, built
+   when a name is first looked up in them, so that opening a path doesn't have
+   to compare every name; hashes are kept for this many directories at once */
+#define DIRCACHE_HASH_MIN    64
+#define DIRCACHE_NUM_HASHES  16
+
 /* make it easy to change serialnumber size without modifying anything else;
    32 bits allows 21845 builds before wrapping in a 6MB cache that is filled
    exclusively with entries and nothing else (32 byte entries), making that
@@ -77,6 +83,13 @@ typedef uint32_t dc_serial_t;
 #define DIRCACHE_NATIVE
 #endif
 
+#if defined(HAVE_EEPROM_SETTINGS) || \
+    (defined(DIRCACHE_NATIVE) && !defined(HAVE_HOTSWAP))
+/* the cache may be saved on shutdown and loaded again on boot, when it is
+   checked against the storage */
+#define DIRCACHE_SNAPSHOT
+#endif
+
 struct dircache_file
 {
     int         idx;        /* this file's cache index */
@@ -124,6 +137,10 @@ int dircache_readdir_internal(struct filestr_base *stream,
                               struct file_base_info *infop,
                               struct fat_direntry *fatent);
 void dircache_rewinddir_internal(struct file_base_info *info);
+int dircache_find_internal(struct filestr_base *stream,
+                           struct file_base_info *infop,
+                           const char *name,
+                           struct fat_direntry *fatent);
 #endif /* DIRCACHE_NATIVE */
 
 
@@ -201,10 +218,10 @@ void dircache_dump(void);
 /** Misc. stuff **/
 void dircache_dcfile_init(struct dircache_file *dcfilep);
 
-#ifdef HAVE_EEPROM_SETTINGS
+#ifdef DIRCACHE_SNAPSHOT
 int dircache_load(void);
 int dircache_save(void);
-#endif /* HAVE_EEPROM_SETTINGS */
+#endif /* DIRCACHE_SNAPSHOT */
 
 void dircache_init(size_t last_size) INIT_ATTR;
 
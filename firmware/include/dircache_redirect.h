@@ -233,6 +233,7 @@ standard_redirect:
     root_mount_path(RB_ROOT_CONTENTS_DIR, NSITEM_CONTENTS);
 #endif /* HAVE_MULTIBOOT */
 
+    fileobj_mgr_mount(IF_MV(volume));
 #ifdef HAVE_DIRCACHE
     dircache_mount();
 #endif
@@ -300,6 +301,19 @@ static inline void rewinddir_internal(struct file_base_info *infop)
 #endif
 }
 
+static inline int find_internal(struct filestr_base *stream,
+                                struct file_base_info *infop,
+                                const char *name,
+                                struct fat_direntry *fatent)
+{
+#ifdef HAVE_DIRCACHE
+    return dircache_find_internal(stream, infop, name, fatent);
+#else
+    (void)stream; (void)infop; (void)name; (void)fatent;
+    return -1;
+#endif
+}
+
 
 /** Misc. stuff **/
 
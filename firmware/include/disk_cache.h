@@ -36,13 +36,36 @@ static inline void dc_unlock_cache(void)
     mutex_unlock(&disk_cache_mutex);
 }
 
-void * dc_cache_probe(IF_MV(int volume,) sector_t secnum,
+/* what is probed for; the cache treats the classes differently */
+enum dc_probe_flags
+{
+    DC_MISC       = 0x0, /* anything not below (boot sector, fsinfo) */
+    DC_DIR        = 0x1, /* directory sector */
+    DC_FAT        = 0x2, /* FAT sector */
+    DC_NUM_CLASSES,
+    DC_CLASS_MASK = 0x3,
+    DC_PREFETCH   = 0x4, /* read ahead; not a reference */
+};
+
+struct dc_stats
+{
+    unsigned long hits[DC_NUM_CLASSES];   /* found in the cache */
+    unsigned long misses[DC_NUM_CLASSES]; /* had to be read */
+    unsigned long promotions;    /* moved to the main queue when reused */
+    unsigned long prefetched;    /* sectors read ahead */
+    unsigned long prefetch_hits; /* sectors read ahead that were used */
+    unsigned int  queued[2];     /* entries in the in and main queues */
+};
+
+void * dc_cache_probe(IF_MV(int volume,) sector_t secnum, unsigned int how,
                       unsigned int *flags);
 void dc_dirty_buf(void *buf);
 void dc_discard_buf(void *buf);
 void dc_commit_all(IF_MV_NONVOID(int volume));
 void dc_discard_all(IF_MV_NONVOID(int volume));
 
+void dc_get_stats(struct dc_stats *stats);
+
 void dc_init(void) INIT_ATTR;
 
 /* in addition to filling, writeback is implemented by the client */
@@ -53,6 +53,10 @@ struct filestr_base * fileobj_get_next_stream(const struct filestr_base *stream,
                                               const struct filestr_base *s);
 void fileobj_change_flags(struct filestr_base *stream,
                           unsigned int flags, unsigned int mask);
+unsigned int fileobj_mgr_change_serial(void);
+bool fileobj_mgr_dir_changed(const struct file_base_info *dirinfop,
+                             unsigned int serial);
+void fileobj_mgr_mount(IF_MV_NONVOID(int volume));
 void fileobj_mgr_unmount(IF_MV_NONVOID(int volume));
 
 void fileobj_mgr_init(void) INIT_ATTR;
@@ -62,6 +62,29 @@ int     relate(const char *path1, const char *path2);
 bool    file_exists(const char *path);
 #endif /* !FILEFUNCTIONS_DECLARED */
 
+/* native only: reserve storage for a file to be written sequentially */
+int fpreallocate(int fildes, off_t length);
+
+#if defined(HAVE_STORAGE_ASYNC) && !defined(PLUGIN) && !defined(CODEC)
+#include "storage.h"
+
+/* most runs of contiguous sectors a single read_submit() queues; the rest of
+   the read is done before it returns */
+#define FILE_ASYNC_RUNS 4
+
+struct file_async
+{
+    ssize_t nbyte;                  /* bytes the read will have got */
+    int count;                      /* number of requests queued */
+    struct storage_request req[FILE_ASYNC_RUNS];
+};
+
+ssize_t read_submit(int fildes, void *buf, size_t nbyte,
+                    struct file_async *fa);
+bool    read_poll(struct file_async *fa);
+ssize_t read_finish(struct file_async *fa);
+#endif /* HAVE_STORAGE_ASYNC && !PLUGIN && !CODEC */
+
 #if !defined(RB_FILESYSTEM_OS) && !defined (FILEFUNCTIONS_DEFINED)
 #define open(path, oflag, ...) open(path, oflag)
 #define creat(path, mode)      creat(path)
@@ -106,5 +129,9 @@ int    samedir(DIR *dirp1, DIR *dirp2);
 bool   dir_exists(const char *dirname);
 #endif /* !DIRFUNCTIONS_DECLARED */
 
+/* native only: tell whether a directory's entries changed since a listing */
+unsigned int dir_get_serial(void);
+bool   dir_changed_since(DIR *dirp, unsigned int serial);
+
 #endif /* _FILESYSTEM_NATIVE__DIR_H_ */
 #endif /* _DIR_H_ */
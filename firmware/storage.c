@@ -18,6 +18,7 @@
  * KIND, either express or implied.
  *
  ****************************************************************************/
+#include <string.h>
 #include "storage.h"
 #include "kernel.h"
 #include "ata_idle_notify.h"
@@ -71,6 +72,10 @@ static unsigned int num_drives;
 static struct event_queue storage_queue SHAREDBSS_ATTR;
 static unsigned int storage_thread_id = 0;
 
+#ifdef HAVE_STORAGE_ASYNC
+static void storage_io_init(void);
+#endif
+
 static union {
 #if (CONFIG_STORAGE & STORAGE_ATA)
     long stk_ata[ATA_THREAD_STACK_SIZE / sizeof (long)];
@@ -362,11 +367,14 @@ int storage_init(void)
 #endif
 
     storage_thread_init();
+#ifdef HAVE_STORAGE_ASYNC
+    storage_io_init();
+#endif
     return rc;
 }
 
-int storage_read_sectors(IF_MD(int drive,) sector_t start, int count,
-                         void* buf)
+static int read_sectors(IF_MD(int drive,) sector_t start, int count,
+                        void* buf)
 {
 #ifdef CONFIG_STORAGE_MULTI
     int driver=(storage_drivers[drive] & DRIVER_MASK)>>DRIVER_OFFSET;
@@ -407,8 +415,8 @@ int storage_read_sectors(IF_MD(int drive,) sector_t start, int count,
 
 }
 
-int storage_write_sectors(IF_MD(int drive,) sector_t start, int count,
-                          const void* buf)
+static int write_sectors(IF_MD(int drive,) sector_t start, int count,
+                         const void* buf)
 {
 #ifdef CONFIG_STORAGE_MULTI
     int driver=(storage_drivers[drive] & DRIVER_MASK)>>DRIVER_OFFSET;
@@ -448,6 +456,458 @@ int storage_write_sectors(IF_MD(int drive,) sector_t start, int count,
 #endif /* CONFIG_STORAGE_MULTI */
 }
 
+#ifdef HAVE_STORAGE_TRACE
+/** Accounting and trace **/
+
+/* with no activity for this long, flash storage counts as woken up by the
+   next transfer */
+#define STORAGE_TRACE_IDLE  (2*HZ)
+
+static struct
+{
+    unsigned int thread;        /* thread_self() of the thread */
+    int origin;                 /* its storage_origin */
+} io_thread_origins[MAXTHREADS];
+static struct storage_origin_stats io_origin_stats[STORAGE_NUM_ORIGINS];
+static struct storage_trace_entry io_trace_buf[STORAGE_TRACE_SIZE];
+static unsigned int io_trace_count;     /* entries ever traced */
+static long io_last_tick;               /* end of the last transfer */
+
+/* the calling thread's origin */
+static int io_self_origin(void)
+{
+    unsigned int self = thread_self();
+
+    for (unsigned int i = 0; i < MAXTHREADS; i++)
+    {
+        if (io_thread_origins[i].thread == self)
+            return io_thread_origins[i].origin;
+    }
+
+    return STORAGE_ORIGIN_OTHER;
+}
+
+int storage_set_origin(int origin)
+{
+    unsigned int self = thread_self();
+    int oldorigin = STORAGE_ORIGIN_OTHER;
+    int slot = -1;
+
+    if ((unsigned int)origin >= STORAGE_NUM_ORIGINS)
+        origin = STORAGE_ORIGIN_OTHER;
+
+    for (unsigned int i = 0; i < MAXTHREADS; i++)
+    {
+        if (io_thread_origins[i].thread == self)
+        {
+            oldorigin = io_thread_origins[i].origin;
+            slot = i;
+            break;
+        }
+
+        if (slot < 0 && !io_thread_origins[i].thread)
+            slot = i;
+    }
+
+    if (slot >= 0)
+    {
+        /* "other" is the default and needs no slot */
+        io_thread_origins[slot].thread =
+            origin != STORAGE_ORIGIN_OTHER ? self : 0;
+        io_thread_origins[slot].origin = origin;
+    }
+
+    return oldorigin;
+}
+
+/* will a transfer started now wake up the storage? */
+static unsigned int io_wake_flag(void)
+{
+#ifdef HAVE_DISK_STORAGE
+    bool idle = !storage_disk_is_active();
+#else
+    bool idle = TIME_AFTER(current_tick, io_last_tick + STORAGE_TRACE_IDLE);
+#endif
+    return (idle || !io_trace_count) ? STORAGE_TRACE_WAKE : 0;
+}
+
+static void io_trace(int origin, IF_MD(int drive,) sector_t start, int count,
+                     unsigned int flags)
+{
+    struct storage_origin_stats *stats = &io_origin_stats[origin];
+
+    stats->transfers++;
+    if (flags & STORAGE_TRACE_WRITE)
+        stats->written += count;
+    else
+        stats->read += count;
+    if (flags & STORAGE_TRACE_WAKE)
+        stats->wakes++;
+
+    struct storage_trace_entry *entry =
+        &io_trace_buf[io_trace_count++ % STORAGE_TRACE_SIZE];
+    entry->tick   = current_tick;
+    entry->start  = start;
+    entry->count  = count;
+#ifdef HAVE_MULTIDRIVE
+    entry->drive  = drive;
+#endif
+    entry->origin = origin;
+    entry->flags  = flags;
+
+    io_last_tick = current_tick;
+}
+
+void storage_get_origin_stats(struct storage_origin_stats *stats)
+{
+    memcpy(stats, io_origin_stats, sizeof (io_origin_stats));
+}
+
+void storage_reset_origin_stats(void)
+{
+    memset(io_origin_stats, 0, sizeof (io_origin_stats));
+}
+
+int storage_get_trace(struct storage_trace_entry *entries, int max)
+{
+    unsigned int count = MIN(io_trace_count, STORAGE_TRACE_SIZE);
+    if (count > (unsigned int)max)
+        count = max;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        unsigned int n = io_trace_count - count + i;
+        entries[i] = io_trace_buf[n % STORAGE_TRACE_SIZE];
+    }
+
+    return count;
+}
+#endif /* HAVE_STORAGE_TRACE */
+
+#ifdef HAVE_STORAGE_ASYNC
+/** Asynchronous requests **/
+
+/* most sectors merged requests may add up to */
+#define STORAGE_IO_MAX_MERGE 256
+
+static struct storage_request *io_queue; /* in order of submission */
+static bool io_busy;                     /* a transfer is being done */
+static sector_t io_head;                 /* sector after the last transfer */
+#ifdef HAVE_MULTIDRIVE
+static int io_head_drive;                /* drive of the last transfer */
+#endif
+static struct mutex io_mutex SHAREDBSS_ATTR;
+static struct semaphore io_work;         /* released once per request */
+static unsigned int io_thread_id = 0;
+static long io_thread_stack[(DEFAULT_STACK_SIZE*2) / sizeof (long)];
+static const char io_thread_name[] = "storage io";
+
+static inline int request_drive(const struct storage_request *req)
+{
+#ifdef HAVE_MULTIDRIVE
+    return req->drive;
+#else
+    (void)req;
+    return 0;
+#endif
+}
+
+/* may these two be done in either order? */
+static bool requests_independent(const struct storage_request *a,
+                                 const struct storage_request *b)
+{
+    if (request_drive(a) != request_drive(b))
+        return true;
+
+    if (!((a->flags | b->flags) & STORAGE_REQ_WRITE))
+        return true; /* reads only */
+
+    return a->start + a->count <= b->start || b->start + b->count <= a->start;
+}
+
+/* may the queued request be done before those submitted ahead of it? */
+static bool request_can_go(const struct storage_request *req)
+{
+    for (struct storage_request *r = io_queue; r != req; r = r->next)
+    {
+        if (!requests_independent(r, req))
+            return false;
+    }
+
+    return true;
+}
+
+/* should request a be done before b? */
+static bool request_before(const struct storage_request *a,
+                           const struct storage_request *b)
+{
+    if (a->priority != b->priority)
+        return a->priority < b->priority; /* lower is more urgent */
+
+    /* elevator: the ones ahead of the head in ascending order, then the ones
+       behind it, again in ascending order */
+#ifdef HAVE_MULTIDRIVE
+    bool a_behind = a->drive != io_head_drive || a->start < io_head;
+    bool b_behind = b->drive != io_head_drive || b->start < io_head;
+#else
+    bool a_behind = a->start < io_head;
+    bool b_behind = b->start < io_head;
+#endif
+
+    if (a_behind != b_behind)
+        return b_behind;
+
+    return a->start < b->start;
+}
+
+static void queue_remove_request(struct storage_request *req)
+{
+    struct storage_request **pp = &io_queue;
+
+    while (*pp != req)
+        pp = &(*pp)->next;
+
+    *pp = req->next;
+}
+
+/* take the next request to do off of the queue, along with those that can be
+   merged into its transfer; returns the total sector count in *countp */
+static struct storage_request * io_take_requests(int *countp)
+{
+    struct storage_request *best = NULL;
+
+    for (struct storage_request *r = io_queue; r; r = r->next)
+    {
+        if (request_can_go(r) && (!best || request_before(r, best)))
+            best = r;
+    }
+
+    if (!best)
+        return NULL;
+
+    queue_remove_request(best);
+    best->merged = NULL;
+
+    struct storage_request *last = best;
+    int count = best->count;
+
+    while (best->secsize)
+    {
+        /* look for a request continuing where this one ends */
+        sector_t end = best->start + count;
+        void *bufend = best->buf + count*best->secsize;
+        struct storage_request *r;
+
+        for (r = io_queue; r; r = r->next)
+        {
+            if (request_drive(r) == request_drive(best) &&
+                r->flags == best->flags && r->secsize == best->secsize &&
+                r->start == end && r->buf == bufend &&
+                count + r->count <= STORAGE_IO_MAX_MERGE &&
+                request_can_go(r))
+                break;
+        }
+
+        if (!r)
+            break;
+
+        queue_remove_request(r);
+        r->merged = NULL;
+        last->merged = r;
+        last = r;
+        count += r->count;
+    }
+
+    *countp = count;
+    return best;
+}
+
+static void NORETURN_ATTR storage_io_thread(void)
+{
+    while (1)
+    {
+        semaphore_wait(&io_work, TIMEOUT_BLOCK);
+
+        mutex_lock(&io_mutex);
+
+        int count;
+        struct storage_request *req = io_take_requests(&count);
+        if (req)
+            io_busy = true;
+
+        mutex_unlock(&io_mutex);
+
+        if (!req)
+            continue; /* was merged into an earlier transfer */
+
+#ifdef HAVE_STORAGE_TRACE
+        unsigned int tflags = io_wake_flag();
+#endif
+        int rc = (req->flags & STORAGE_REQ_WRITE) ?
+            write_sectors(IF_MD(req->drive,) req->start, count, req->buf) :
+            read_sectors(IF_MD(req->drive,) req->start, count, req->buf);
+
+#ifdef HAVE_STORAGE_TRACE
+        /* each merged request counts for its own origin; the first one
+           gets the wake-up */
+        if (rc < 0)
+            tflags |= STORAGE_TRACE_ERROR;
+        for (struct storage_request *r = req; r; r = r->merged)
+        {
+            io_trace(r->origin, IF_MD(r->drive,) r->start, r->count,
+                     tflags | ((r->flags & STORAGE_REQ_WRITE) ?
+                               STORAGE_TRACE_WRITE : 0));
+            tflags &= ~STORAGE_TRACE_WAKE;
+        }
+#endif
+
+        mutex_lock(&io_mutex);
+        io_busy = false;
+        io_head = req->start + count;
+#ifdef HAVE_MULTIDRIVE
+        io_head_drive = req->drive;
+#endif
+        mutex_unlock(&io_mutex);
+
+        while (req)
+        {
+            /* the submitter may reuse it once it's marked done; after that
+               only the release touches it, and that switches threads only
+               when it's through with it */
+            struct storage_request *next = req->merged;
+            int reqrc = rc < 0 ? rc : 0;
+
+            if (req->callback)
+                req->callback(req, reqrc);
+
+            req->rc = reqrc;
+            semaphore_release(&req->done);
+            req = next;
+        }
+    }
+}
+
+/* queue a request; the caller must keep it around until it is done */
+void storage_request_submit(struct storage_request *req)
+{
+    req->rc = STORAGE_REQ_PENDING;
+    req->next = NULL;
+    req->merged = NULL;
+#ifdef HAVE_PRIORITY_SCHEDULING
+    req->priority = thread_get_priority(thread_self());
+#else
+    req->priority = 0;
+#endif
+#ifdef HAVE_STORAGE_TRACE
+    req->origin = io_self_origin();
+#endif
+    semaphore_init(&req->done, 1, 0);
+
+    mutex_lock(&io_mutex);
+
+    struct storage_request **pp = &io_queue;
+    while (*pp)
+        pp = &(*pp)->next;
+
+    *pp = req;
+
+    mutex_unlock(&io_mutex);
+
+    semaphore_release(&io_work);
+}
+
+/* has the request been done? */
+bool storage_request_poll(struct storage_request *req)
+{
+    return req->rc != STORAGE_REQ_PENDING;
+}
+
+/* wait for the request to be done and return its result */
+int storage_request_wait(struct storage_request *req)
+{
+    if (req->rc == STORAGE_REQ_PENDING)
+        semaphore_wait(&req->done, TIMEOUT_BLOCK);
+
+    return req->rc;
+}
+
+/* should a synchronous transfer wait its turn in the queue? */
+static inline bool storage_io_contended(void)
+{
+    return io_thread_id && (io_busy || io_queue) &&
+           thread_self() != io_thread_id;
+}
+
+static int storage_io_sync(IF_MD(int drive,) sector_t start, int count,
+                           void *buf, unsigned int flags)
+{
+    struct storage_request req =
+    {
+    #ifdef HAVE_MULTIDRIVE
+        .drive    = drive,
+    #endif
+        .start    = start,
+        .count    = count,
+        .buf      = buf,
+        .secsize  = 0,
+        .flags    = flags,
+        .callback = NULL,
+    };
+
+    storage_request_submit(&req);
+    return storage_request_wait(&req);
+}
+
+static void storage_io_init(void)
+{
+    mutex_init(&io_mutex);
+    semaphore_init(&io_work, INT_MAX, 0);
+    io_thread_id = create_thread(storage_io_thread, io_thread_stack,
+                                 sizeof (io_thread_stack), 0, io_thread_name
+                                 IF_PRIO(, PRIORITY_BUFFERING)
+                                 IF_COP(, CPU));
+}
+#endif /* HAVE_STORAGE_ASYNC */
+
+int storage_read_sectors(IF_MD(int drive,) sector_t start, int count,
+                         void* buf)
+{
+#ifdef HAVE_STORAGE_ASYNC
+    if (storage_io_contended())
+        return storage_io_sync(IF_MD(drive,) start, count, buf, 0);
+#endif
+#ifdef HAVE_STORAGE_TRACE
+    unsigned int tflags = io_wake_flag();
+    int rc = read_sectors(IF_MD(drive,) start, count, buf);
+    io_trace(io_self_origin(), IF_MD(drive,) start, count,
+             tflags | (rc < 0 ? STORAGE_TRACE_ERROR : 0));
+    return rc;
+#else
+    return read_sectors(IF_MD(drive,) start, count, buf);
+#endif
+}
+
+int storage_write_sectors(IF_MD(int drive,) sector_t start, int count,
+                          const void* buf)
+{
+#ifdef HAVE_STORAGE_ASYNC
+    if (storage_io_contended())
+    {
+        return storage_io_sync(IF_MD(drive,) start, count, (void *)buf,
+                               STORAGE_REQ_WRITE);
+    }
+#endif
+#ifdef HAVE_STORAGE_TRACE
+    unsigned int tflags = io_wake_flag() | STORAGE_TRACE_WRITE;
+    int rc = write_sectors(IF_MD(drive,) start, count, buf);
+    io_trace(io_self_origin(), IF_MD(drive,) start, count,
+             tflags | (rc < 0 ? STORAGE_TRACE_ERROR : 0));
+    return rc;
+#else
+    return write_sectors(IF_MD(drive,) start, count, buf);
+#endif
+}
+
 #ifdef CONFIG_STORAGE_MULTI
 
 #define DRIVER_MASK     0xff000000
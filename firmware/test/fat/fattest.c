@@ -0,0 +1,898 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Copyright (C) 2026 by the Rockbox contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+
+/* Host harness for the filesystem: fat.c, file.c, dir.c, disk.c and the disk
+ * cache are built as they are for the target and run on a disk image held in
+ * memory.
+ *
+ *   fattest format IMAGE MB [16|32 [SECTORS_PER_CLUSTER [mbr]]]
+ *   fattest ls IMAGE
+ *   fattest bench IMAGE [write|read|seek|create|scan|alloc|remove ...]
+ *   fattest fuzz IMAGE [ITERATIONS [SEED]]
+ *
+ * Benchmarks and fuzzing work on a copy of the image; only format writes the
+ * file. Benchmarks report the time taken and what was asked of the disk, so
+ * runs are comparable on counts even where the times are noisy.
+ */
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "file.h"
+#include "dir.h"
+#include "disk.h"
+#include "disk_cache.h"
+#include "core_alloc.h"
+#include "file_internal.h"
+#include "pathfuncs.h"
+#include "fattest.h"
+#include "image.h"
+
+#define BENCH_DIR   "/bench"
+#define SEQ_FILE    BENCH_DIR "/seq.bin"
+#define CHUNK_SIZE  (32*1024)
+
+static unsigned char chunk[CHUNK_SIZE];
+static unsigned long seq_size = 16*1024*1024;
+
+/* failures are expected on damaged images and not worth reporting */
+static bool fuzzing;
+
+static void fail(const char *fmt, ...)
+{
+    if (fuzzing)
+        return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+}
+
+/* small PRNG so that seeds mean the same everywhere */
+static uint32_t rand_state;
+
+static void rand_seed(uint32_t seed)
+{
+    rand_state = seed * 2654435761u + 1;
+}
+
+static uint32_t rand_next(void)
+{
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return rand_state;
+}
+
+/* content of test files at each offset, to check what is read back */
+static unsigned char pattern(unsigned long offset)
+{
+    return (offset >> 9) * 7 + offset;
+}
+
+static void fill_pattern(unsigned char *buf, unsigned long offset, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        buf[i] = pattern(offset + i);
+}
+
+static bool check_pattern(const unsigned char *buf, unsigned long offset,
+                          size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        if (buf[i] != pattern(offset + i))
+        {
+            fail("bad data at offset %lu\n", offset + i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool fs_mount(void)
+{
+    static bool initialized = false;
+    if (!initialized)
+    {
+        core_allocator_init();
+#ifdef HAVE_MULTIVOLUME
+        init_volume_names();
+#endif
+        filesystem_init();
+        initialized = true;
+    }
+
+    update_tick();
+
+    if (disk_mount_all() <= 0)
+    {
+        fail("no FAT volume found\n");
+        return false;
+    }
+
+    return true;
+}
+
+static void fs_unmount(void)
+{
+    disk_unmount_all();
+}
+
+/* writes a file of the test pattern */
+static bool write_file(const char *path, unsigned long size)
+{
+    int fd = open(path, O_WRONLY|O_CREAT|O_TRUNC);
+    if (fd < 0)
+    {
+        fail("can't create %s: %d\n", path, errno);
+        return false;
+    }
+
+    for (unsigned long done = 0; done < size;)
+    {
+        size_t n = MIN(size - done, CHUNK_SIZE);
+        fill_pattern(chunk, done, n);
+
+        if (write(fd, chunk, n) != (ssize_t)n)
+        {
+            fail("can't write %s: %d\n", path, errno);
+            close(fd);
+            return false;
+        }
+
+        done += n;
+    }
+
+    return close(fd) == 0;
+}
+
+/* reads a file through and checks the pattern unless just walking */
+static bool read_file(const char *path, bool check)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    bool ok = true;
+    unsigned long offset = 0;
+    ssize_t n;
+    while ((n = read(fd, chunk, CHUNK_SIZE)) > 0)
+    {
+        if (check && !check_pattern(chunk, offset, n))
+        {
+            ok = false;
+            break;
+        }
+
+        offset += n;
+    }
+
+    if (n < 0)
+        ok = false;
+
+    close(fd);
+    return ok;
+}
+
+/* calls fn for every entry under path, up to the given depth */
+static int walk(const char *path, int depth,
+                bool (*fn)(const char *path, const struct dirinfo *info))
+{
+    DIR *dir = opendir(path);
+    if (!dir)
+        return -1;
+
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) && count < 65536)
+    {
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+            continue;
+
+        char child[MAX_PATH];
+        snprintf(child, sizeof (child), "%s/%s",
+                 strcmp(path, "/") ? path : "", entry->d_name);
+
+        struct dirinfo info = dir_get_info(dir, entry);
+        count++;
+
+        if (fn && !fn(child, &info))
+            break;
+
+        if ((info.attribute & ATTR_DIRECTORY) && depth > 0)
+        {
+            int rc = walk(child, depth - 1, fn);
+            if (rc > 0)
+                count += rc;
+        }
+    }
+
+    closedir(dir);
+    return count;
+}
+
+/** ls **/
+
+static bool ls_entry(const char *path, const struct dirinfo *info)
+{
+    if (info->attribute & ATTR_DIRECTORY)
+        printf("%s/\n", path);
+    else
+        printf("%s %lu\n", path, (unsigned long)info->size);
+
+    return true;
+}
+
+static int cmd_ls(int argc, char *argv[])
+{
+    (void)argc;
+    if (!image_load(argv[0]) || !fs_mount())
+        return 1;
+
+    walk("/", 32, ls_entry);
+
+    sector_t size, free;
+    volume_size(IF_MV(0,) &size, &free);
+    printf("%lu KiB, %lu KiB free\n", (unsigned long)size,
+           (unsigned long)free);
+
+    fs_unmount();
+    return 0;
+}
+
+/** format **/
+
+static int cmd_format(int argc, char *argv[])
+{
+    if (argc < 2)
+        return -1;
+
+    unsigned long mb = strtoul(argv[1], NULL, 0);
+    int fatbits = argc > 2 ? atoi(argv[2]) : 32;
+    unsigned int secperclus = argc > 3 ? strtoul(argv[3], NULL, 0) : 0;
+    bool mbr = argc > 4 && !strcmp(argv[4], "mbr");
+
+    if (!mb || (fatbits != 16 && fatbits != 32))
+        return -1;
+
+    if (!image_create((uint64_t)mb * 2048) ||
+        !mkfs_fat(fatbits, secperclus, mbr))
+        return 1;
+
+    /* check that the firmware takes it */
+    if (!fs_mount())
+        return 1;
+
+    fs_unmount();
+    return image_save(argv[0]) ? 0 : 1;
+}
+
+/** bench **/
+
+struct bench_run
+{
+    long start;
+    struct dc_stats dc;
+};
+
+static void bench_begin(struct bench_run *run, bool cold)
+{
+    if (cold)
+    {
+        /* start from an empty cache */
+        fs_unmount();
+        fs_mount();
+    }
+
+    image_reset_stats();
+    dc_get_stats(&run->dc);
+    run->start = host_time_ms();
+}
+
+static void bench_end(struct bench_run *run, const char *name,
+                      unsigned long long bytes)
+{
+    long ms = host_time_ms() - run->start;
+
+    struct image_stats st;
+    image_get_stats(&st);
+
+    struct dc_stats dc;
+    dc_get_stats(&dc);
+
+    unsigned long hits = 0, misses = 0;
+    for (int i = 0; i < DC_NUM_CLASSES; i++)
+    {
+        hits += dc.hits[i] - run->dc.hits[i];
+        misses += dc.misses[i] - run->dc.misses[i];
+    }
+
+    printf("%-7s %7ld ms", name, ms);
+    if (bytes)
+        printf(" %8.1f MB/s", ms ? bytes / 1000.0 / ms : 0.0);
+    else
+        printf(" %13s", "");
+
+    printf("  req %6lu/%-6lu sec %8llu/%-8llu seek %6lu  cache %3lu%%\n",
+           st.reads, st.writes, st.read_sectors, st.write_sectors, st.seeks,
+           hits + misses ? hits * 100 / (hits + misses) : 100);
+}
+
+static bool ensure_seq_file(void)
+{
+    return file_exists(SEQ_FILE) || write_file(SEQ_FILE, seq_size);
+}
+
+static bool bench_write(void)
+{
+    struct bench_run run;
+    remove(SEQ_FILE);
+    bench_begin(&run, true);
+    if (!write_file(SEQ_FILE, seq_size))
+        return false;
+
+    bench_end(&run, "write", seq_size);
+    return true;
+}
+
+static bool bench_read(void)
+{
+    if (!ensure_seq_file())
+        return false;
+
+    struct bench_run run;
+    bench_begin(&run, true);
+    if (!read_file(SEQ_FILE, true))
+        return false;
+
+    bench_end(&run, "read", seq_size);
+    return true;
+}
+
+static bool bench_seek(void)
+{
+    if (!ensure_seq_file())
+        return false;
+
+    struct bench_run run;
+    bench_begin(&run, true);
+
+    int fd = open(SEQ_FILE, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    rand_seed(1);
+    bool ok = true;
+    for (int i = 0; i < 4096 && ok; i++)
+    {
+        unsigned long offset = rand_next() % (seq_size - 512);
+        ok = lseek(fd, offset, SEEK_SET) == (off_t)offset &&
+             read(fd, chunk, 512) == 512 &&
+             check_pattern(chunk, offset, 512);
+    }
+
+    close(fd);
+    if (!ok)
+        return false;
+
+    bench_end(&run, "seek", 4096*512);
+    return true;
+}
+
+#define CREATE_DIRS  16
+#define CREATE_FILES 128
+
+static bool create_tree(void)
+{
+    char path[MAX_PATH];
+
+    mkdir(BENCH_DIR "/tree");
+    for (int d = 0; d < CREATE_DIRS; d++)
+    {
+        snprintf(path, sizeof (path), BENCH_DIR "/tree/Directory %02d", d);
+        if (mkdir(path) < 0)
+            return false;
+
+        for (int f = 0; f < CREATE_FILES; f++)
+        {
+            /* half short names, half long ones */
+            snprintf(path, sizeof (path),
+                     f & 1 ? BENCH_DIR "/tree/Directory %02d/%02d - "
+                             "A Track With A Long Name.mp3" :
+                             BENCH_DIR "/tree/Directory %02d/TRACK%03d.MP3",
+                     d, f);
+
+            if (!write_file(path, 100 + f * 61))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static bool bench_create(void)
+{
+    struct bench_run run;
+    bench_begin(&run, true);
+    if (!create_tree())
+        return false;
+
+    bench_end(&run, "create", 0);
+    return true;
+}
+
+static bool bench_scan(void)
+{
+    if (!dir_exists(BENCH_DIR "/tree") && !create_tree())
+        return false;
+
+    struct bench_run run;
+    bench_begin(&run, true);
+    int count = walk(BENCH_DIR "/tree", 4, NULL);
+    if (count != CREATE_DIRS * (CREATE_FILES + 1))
+    {
+        fprintf(stderr, "scan found %d entries\n", count);
+        return false;
+    }
+
+    bench_end(&run, "scan", 0);
+
+    /* again, from the cache */
+    bench_begin(&run, false);
+    walk(BENCH_DIR "/tree", 4, NULL);
+    bench_end(&run, "rescan", 0);
+    return true;
+}
+
+#define STREAM_FILE   BENCH_DIR "/stream.bin"
+#define STREAM_OTHER  BENCH_DIR "/other.bin"
+#define STREAM_RESERVE (1024*1024)
+
+/* writes a file while another one grows alongside it, as when recording,
+   then reads it back; with 'reserve', space is reserved ahead of the writes
+   like the recorder does */
+static bool stream_file(const char *name, const char *readname, bool reserve)
+{
+    remove(STREAM_FILE);
+    remove(STREAM_OTHER);
+
+    struct bench_run run;
+    bench_begin(&run, true);
+
+    int fd = open(STREAM_FILE, O_WRONLY|O_CREAT|O_TRUNC);
+    int otherfd = open(STREAM_OTHER, O_WRONLY|O_CREAT|O_TRUNC);
+    if (fd < 0 || otherfd < 0)
+    {
+        fail("can't create stream files: %d\n", errno);
+        return false;
+    }
+
+    unsigned long size = seq_size / 2;
+    unsigned long reserved = 0;
+    bool ok = true;
+
+    for (unsigned long done = 0; ok && done < size;)
+    {
+        size_t n = MIN(size - done, CHUNK_SIZE);
+
+        if (reserve && done + n > reserved)
+        {
+            reserved = done + n + STREAM_RESERVE;
+            fpreallocate(fd, reserved);
+        }
+
+        fill_pattern(chunk, done, n);
+        ok = write(fd, chunk, n) == (ssize_t)n &&
+             write(otherfd, chunk, 4096) == 4096;
+        done += n;
+    }
+
+    ok = close(otherfd) == 0 && ok;
+    ok = close(fd) == 0 && ok;
+    if (!ok)
+    {
+        fail("can't write stream files: %d\n", errno);
+        return false;
+    }
+
+    bench_end(&run, name, size);
+
+    bench_begin(&run, true);
+    if (!read_file(STREAM_FILE, true))
+    {
+        fail("stream file doesn't read back\n");
+        return false;
+    }
+
+    bench_end(&run, readname, size);
+    return true;
+}
+
+static bool bench_stream(void)
+{
+    return stream_file("stream", "sread", false) &&
+           stream_file("reserve", "rread", true);
+}
+
+#define ALLOC_FILES 256
+#define ALLOC_SIZE  (16*1024)
+
+/* writes a file into free space left fragmented by deleting every other one
+   of many small files */
+static bool bench_alloc(void)
+{
+    char path[MAX_PATH];
+
+    mkdir(BENCH_DIR "/frag");
+    for (int i = 0; i < ALLOC_FILES; i++)
+    {
+        snprintf(path, sizeof (path), BENCH_DIR "/frag/%03d.bin", i);
+        if (!write_file(path, ALLOC_SIZE))
+            return false;
+    }
+
+    for (int i = 0; i < ALLOC_FILES; i += 2)
+    {
+        snprintf(path, sizeof (path), BENCH_DIR "/frag/%03d.bin", i);
+        remove(path);
+    }
+
+    struct bench_run run;
+    bench_begin(&run, true);
+    unsigned long size = ALLOC_FILES * ALLOC_SIZE;
+    if (!write_file(BENCH_DIR "/frag/big.bin", size))
+        return false;
+
+    bench_end(&run, "alloc", size);
+
+    return read_file(BENCH_DIR "/frag/big.bin", true);
+}
+
+static bool remove_entry(const char *path, const struct dirinfo *info)
+{
+    if (info->attribute & ATTR_DIRECTORY)
+    {
+        walk(path, 0, remove_entry);
+        rmdir(path);
+    }
+    else
+    {
+        remove(path);
+    }
+
+    return true;
+}
+
+static bool bench_remove(void)
+{
+    struct bench_run run;
+    bench_begin(&run, true);
+    walk(BENCH_DIR, 0, remove_entry);
+    bench_end(&run, "remove", 0);
+    return true;
+}
+
+static const struct
+{
+    const char *name;
+    bool (*fn)(void);
+} benchmarks[] =
+{
+    { "write",  bench_write  },
+    { "read",   bench_read   },
+    { "seek",   bench_seek   },
+    { "create", bench_create },
+    { "scan",   bench_scan   },
+    { "stream", bench_stream },
+    { "alloc",  bench_alloc  },
+    { "remove", bench_remove },
+};
+
+static int cmd_bench(int argc, char *argv[])
+{
+    if (!image_load(argv[0]) || !fs_mount())
+        return 1;
+
+    sector_t size, free;
+    volume_size(IF_MV(0,) &size, &free);
+    if (seq_size / 1024 > free / 4)
+        seq_size = free / 4 * 1024;
+
+    mkdir(BENCH_DIR);
+
+    int rc = 0;
+    for (unsigned int i = 0; i < ARRAYLEN(benchmarks); i++)
+    {
+        bool run = argc < 2;
+        for (int j = 1; j < argc; j++)
+            run |= !strcmp(argv[j], benchmarks[i].name);
+
+        if (run && !benchmarks[i].fn())
+        {
+            fprintf(stderr, "%s failed\n", benchmarks[i].name);
+            rc = 1;
+        }
+    }
+
+    fs_unmount();
+    return rc;
+}
+
+/** fuzz **/
+
+/* where the volume's metadata is, in image sectors */
+static uint64_t meta_start, meta_fat, meta_end;
+
+static uint32_t get16(const unsigned char *p)
+{
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t get32(const unsigned char *p)
+{
+    return get16(p) | get16(p + 2) << 16;
+}
+
+static bool find_metadata(void)
+{
+    const unsigned char *disk = image_data();
+    uint64_t start = 0;
+
+    if (get16(disk + 11) != IMAGE_SECTOR_SIZE)
+        start = get32(disk + 0x1be + 8); /* first partition */
+
+    const unsigned char *bs = disk + start*IMAGE_SECTOR_SIZE;
+    if (start >= image_sectors() || get16(bs + 11) != IMAGE_SECTOR_SIZE)
+        return false;
+
+    uint32_t fatsize = get16(bs + 22) ?: get32(bs + 36);
+    meta_start = start;
+    meta_fat = start + get16(bs + 14);
+    meta_end = meta_fat + bs[16]*fatsize +
+               get16(bs + 17)*32 / IMAGE_SECTOR_SIZE +
+               64*bs[13]; /* and the first few clusters */
+
+    if (meta_end > image_sectors())
+        meta_end = image_sectors();
+
+    return true;
+}
+
+/* gives the image something to corrupt */
+static bool fuzz_populate(void)
+{
+    char path[MAX_PATH];
+
+    if (!fs_mount())
+        return false;
+
+    mkdir("/fuzz");
+    for (int d = 0; d < 4; d++)
+    {
+        snprintf(path, sizeof (path), "/fuzz/Directory number %d", d);
+        mkdir(path);
+
+        for (int f = 0; f < 24; f++)
+        {
+            snprintf(path, sizeof (path),
+                     f & 1 ? "/fuzz/Directory number %d/File with a long "
+                             "name %d.txt" :
+                             "/fuzz/Directory number %d/FILE%d.TXT", d, f);
+            write_file(path, f * 3001);
+        }
+    }
+
+    fs_unmount();
+    return true;
+}
+
+static void fuzz_corrupt(void)
+{
+    unsigned char *disk = image_data();
+    int count = 1 + rand_next() % 8;
+
+    for (int i = 0; i < count; i++)
+    {
+        uint64_t sector;
+        switch (rand_next() % 4)
+        {
+        case 0: /* boot sector and FSInfo */
+            sector = meta_start + rand_next() % 2;
+            break;
+        case 1: /* directories */
+            sector = meta_end - 1 - rand_next() % (meta_end - meta_fat) / 4;
+            break;
+        default: /* FAT */
+            sector = meta_fat + rand_next() % (meta_end - meta_fat);
+            break;
+        }
+
+        unsigned char *p = disk + sector*IMAGE_SECTOR_SIZE +
+                           (rand_next() % IMAGE_SECTOR_SIZE & ~3);
+        static const uint32_t values[] =
+            { 0, 1, 2, 3, 0x0ffffff7, 0x0ffffff8, 0x0fffffff, 0xffffffff };
+
+        switch (rand_next() % 3)
+        {
+        case 0:
+            p[rand_next() % 4] ^= 1 << (rand_next() % 8);
+            break;
+        case 1:
+            p[rand_next() % 4] = rand_next();
+            break;
+        case 2:
+        {
+            uint32_t v = rand_next() & 1 ? values[rand_next() % 8] :
+                                           rand_next() % 0x10000;
+            for (int b = 0; b < 4; b++)
+                p[b] = v >> (b*8);
+            break;
+        }
+        }
+    }
+}
+
+static bool fuzz_read_entry(const char *path, const struct dirinfo *info)
+{
+    if (!(info->attribute & ATTR_DIRECTORY))
+        read_file(path, false);
+
+    return true;
+}
+
+/* one iteration, in a child process: whatever the filesystem makes of the
+   damage, it must neither crash nor hang */
+static int fuzz_child(void *arg)
+{
+    fuzzing = true;
+    rand_seed(*(uint32_t *)arg);
+    fuzz_corrupt();
+
+    if (!fs_mount())
+        return 0; /* refusing it is fine */
+
+    walk("/", 8, fuzz_read_entry);
+
+    mkdir("/new");
+    write_file("/new/file.bin", 70000);
+    rename("/new/file.bin", "/new/renamed.bin");
+    read_file("/new/renamed.bin", false);
+    remove("/new/renamed.bin");
+    rmdir("/new");
+    remove("/fuzz/Directory number 1/FILE4.TXT");
+
+    fs_unmount();
+    return 0;
+}
+
+static int cmd_fuzz(int argc, char *argv[])
+{
+    unsigned long iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000;
+    uint32_t seed = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+
+    if (!image_load(argv[0]) || !fuzz_populate())
+        return 1;
+
+    if (!find_metadata())
+    {
+        fprintf(stderr, "can't find the volume\n");
+        return 1;
+    }
+
+    image_snapshot();
+
+    unsigned long crashes = 0, hangs = 0, panics = 0;
+    for (unsigned long i = 0; i < iterations; i++, seed++)
+    {
+        image_restore();
+
+        int rc = host_run_child(fuzz_child, &seed, 10);
+        if (rc == 0)
+            continue;
+
+        if (rc == FATTEST_PANIC)
+        {
+            panics++;
+            printf("seed %lu: panic\n", (unsigned long)seed);
+        }
+        else if (rc == HOST_CHILD_TIMEOUT)
+        {
+            hangs++;
+            printf("seed %lu: hang\n", (unsigned long)seed);
+        }
+        else
+        {
+            crashes++;
+            printf("seed %lu: crash (%s %d)\n", (unsigned long)seed,
+                   rc >= HOST_CHILD_SIGNAL ? "signal" : "status",
+                   rc >= HOST_CHILD_SIGNAL ? rc - HOST_CHILD_SIGNAL : rc);
+        }
+    }
+
+    printf("%lu runs: %lu crashes, %lu hangs, %lu panics\n",
+           iterations, crashes, hangs, panics);
+
+    return crashes || hangs ? 1 : 0;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "usage: fattest [-v] [-s MB] COMMAND IMAGE ...\n"
+        "  format IMAGE MB [16|32 [SECTORS_PER_CLUSTER [mbr]]]\n"
+        "  ls IMAGE\n"
+        "  bench IMAGE [write|read|seek|create|scan|alloc|remove ...]\n"
+        "  fuzz IMAGE [ITERATIONS [SEED]]\n"
+        "-v prints the filesystem's debug output, -s sets the size of the\n"
+        "file for the read, write and seek benchmarks\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int opt = 1;
+    for (; opt < argc && argv[opt][0] == '-'; opt++)
+    {
+        if (!strcmp(argv[opt], "-v"))
+            fattest_verbose = true;
+        else if (!strcmp(argv[opt], "-s") && opt + 1 < argc)
+            seq_size = strtoul(argv[++opt], NULL, 0) * 1024 * 1024;
+        else
+            break;
+    }
+
+    if (argc - opt < 2)
+    {
+        usage();
+        return 2;
+    }
+
+    static const struct
+    {
+        const char *name;
+        int (*fn)(int argc, char *argv[]);
+    } commands[] =
+    {
+        { "format", cmd_format },
+        { "ls",     cmd_ls     },
+        { "bench",  cmd_bench  },
+        { "fuzz",   cmd_fuzz   },
+    };
+
+    for (unsigned int i = 0; i < ARRAYLEN(commands); i++)
+    {
+        if (!strcmp(argv[opt], commands[i].name))
+        {
+            int rc = commands[i].fn(argc - opt - 1, argv + opt + 1);
+            if (rc < 0)
+                usage();
+
+            return rc < 0 ? 2 : rc;
+        }
+    }
+
+    usage();
+    return 2;
+}
@@ -0,0 +1,247 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Copyright (C) 2026 by the Rockbox contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+
+/* The disk image, held in memory like the ramdisk driver's, and the other
+ * host services the harness needs. This is built against the host's headers;
+ * the filesystem code around it sees only image.h. */
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "image.h"
+
+static unsigned char *image;      /* the disk */
+static unsigned char *snapshot;   /* saved copy, for image_restore() */
+static uint64_t image_nsectors;
+static uint64_t next_sector;      /* where the last request ended */
+static struct image_stats stats;
+
+static bool image_alloc(uint64_t sectors)
+{
+    image_free();
+
+    image = calloc(sectors, IMAGE_SECTOR_SIZE);
+    if (!image)
+    {
+        fprintf(stderr, "out of memory for a %llu sector image\n",
+                (unsigned long long)sectors);
+        return false;
+    }
+
+    image_nsectors = sectors;
+    image_reset_stats();
+    return true;
+}
+
+bool image_load(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < IMAGE_SECTOR_SIZE ||
+        !image_alloc(st.st_size / IMAGE_SECTOR_SIZE))
+    {
+        close(fd);
+        return false;
+    }
+
+    size_t size = image_nsectors * IMAGE_SECTOR_SIZE;
+    for (size_t done = 0; done < size;)
+    {
+        ssize_t rc = read(fd, image + done, size - done);
+        if (rc <= 0)
+        {
+            fprintf(stderr, "%s: short read\n", path);
+            close(fd);
+            return false;
+        }
+
+        done += rc;
+    }
+
+    close(fd);
+    return true;
+}
+
+bool image_create(uint64_t sectors)
+{
+    return image_alloc(sectors);
+}
+
+bool image_save(const char *path)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    size_t size = image_nsectors * IMAGE_SECTOR_SIZE;
+    for (size_t done = 0; done < size;)
+    {
+        ssize_t rc = write(fd, image + done, size - done);
+        if (rc <= 0)
+        {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            close(fd);
+            return false;
+        }
+
+        done += rc;
+    }
+
+    return close(fd) == 0;
+}
+
+void image_snapshot(void)
+{
+    size_t size = image_nsectors * IMAGE_SECTOR_SIZE;
+
+    free(snapshot);
+    snapshot = malloc(size);
+    if (snapshot)
+        memcpy(snapshot, image, size);
+}
+
+void image_restore(void)
+{
+    if (snapshot)
+        memcpy(image, snapshot, image_nsectors * IMAGE_SECTOR_SIZE);
+}
+
+void image_free(void)
+{
+    free(image);
+    free(snapshot);
+    image = snapshot = NULL;
+    image_nsectors = 0;
+}
+
+uint64_t image_sectors(void)
+{
+    return image_nsectors;
+}
+
+unsigned char * image_data(void)
+{
+    return image;
+}
+
+static bool image_request(uint64_t start, int count)
+{
+    if (count <= 0 || start + count > image_nsectors)
+        return false;
+
+    if (start != next_sector)
+    {
+        stats.seeks++;
+        stats.seek_distance += start > next_sector ?
+            start - next_sector : next_sector - start;
+    }
+
+    next_sector = start + count;
+    return true;
+}
+
+int image_read(uint64_t start, int count, void *buf)
+{
+    if (!image_request(start, count))
+        return -1;
+
+    stats.reads++;
+    stats.read_sectors += count;
+    memcpy(buf, image + start*IMAGE_SECTOR_SIZE, count*IMAGE_SECTOR_SIZE);
+    return 0;
+}
+
+int image_write(uint64_t start, int count, const void *buf)
+{
+    if (!image_request(start, count))
+        return -1;
+
+    stats.writes++;
+    stats.write_sectors += count;
+    memcpy(image + start*IMAGE_SECTOR_SIZE, buf, count*IMAGE_SECTOR_SIZE);
+    return 0;
+}
+
+void image_get_stats(struct image_stats *statsp)
+{
+    *statsp = stats;
+}
+
+void image_reset_stats(void)
+{
+    memset(&stats, 0, sizeof (stats));
+}
+
+long host_time_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+int host_run_child(int (*fn)(void *arg), void *arg, unsigned int timeout)
+{
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        return -1;
+    }
+
+    if (pid == 0)
+    {
+        alarm(timeout);
+        _exit(fn(arg));
+    }
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0)
+    {
+        if (errno != EINTR)
+            return -1;
+    }
+
+    if (WIFSIGNALED(status))
+    {
+        return WTERMSIG(status) == SIGALRM ?
+            HOST_CHILD_TIMEOUT : HOST_CHILD_SIGNAL + WTERMSIG(status);
+    }
+
+    return WEXITSTATUS(status);
+}
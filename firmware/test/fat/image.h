@@ -0,0 +1,74 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Copyright (C) 2026 by the Rockbox contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#ifndef IMAGE_H
+#define IMAGE_H
+
+/* Host side of the FAT harness. These are built against the host's own
+ * headers, apart from the Rockbox filesystem code, so only plain types cross
+ * over. */
+#include <stdbool.h>
+#include <stdint.h>
+
+#define IMAGE_SECTOR_SIZE 512
+
+/* what the filesystem asked of the image */
+struct image_stats
+{
+    unsigned long reads;         /* read requests */
+    unsigned long writes;        /* write requests */
+    unsigned long long read_sectors;
+    unsigned long long write_sectors;
+    unsigned long seeks;         /* requests not starting where the last
+                                    one ended */
+    unsigned long long seek_distance; /* sectors between the two */
+};
+
+/* the image is held in memory; nothing goes back to the file unless asked */
+bool image_load(const char *path);
+bool image_create(uint64_t sectors);
+bool image_save(const char *path);
+void image_snapshot(void);
+void image_restore(void);
+void image_free(void);
+
+uint64_t image_sectors(void);
+unsigned char * image_data(void);
+int image_read(uint64_t start, int count, void *buf);
+int image_write(uint64_t start, int count, const void *buf);
+
+void image_get_stats(struct image_stats *stats);
+void image_reset_stats(void);
+
+/* host services */
+long host_time_ms(void);
+
+/* runs fn(arg) in a child process; returns its exit status, or
+   HOST_CHILD_SIGNAL + signal number if it died or HOST_CHILD_TIMEOUT if it
+   ran for longer than timeout seconds */
+#define HOST_CHILD_SIGNAL  0x100
+#define HOST_CHILD_TIMEOUT 0x200
+int host_run_child(int (*fn)(void *arg), void *arg, unsigned int timeout);
+
+/* writes an empty FAT16 or FAT32 volume over the whole image, or into its
+   only partition with an MBR; secperclus 0 picks the usual for the size */
+bool mkfs_fat(int fatbits, unsigned int secperclus, bool mbr);
+
+#endif /* IMAGE_H */
@@ -0,0 +1,41 @@
+/* autoconf.h for the host FAT harness; stands in for the one configure makes
+ * for a target build. The target itself is picked on the command line. */
+#ifndef __BUILD_AUTOCONF_H
+#define __BUILD_AUTOCONF_H
+
+#define arch_none 0
+#define ARCH_NONE 0
+
+#define arch_arm64 1
+#define ARCH_ARM64 1
+
+#define arch_m68k 2
+#define ARCH_M68K 2
+
+#define arch_arm 3
+#define ARCH_ARM 3
+
+#define arch_mips 4
+#define ARCH_MIPS 4
+
+#define arch_x86 5
+#define ARCH_X86 5
+
+#define arch_amd64 6
+#define ARCH_AMD64 6
+
+#define ARCH arch_none
+
+#define ROCKBOX_LITTLE_ENDIAN 1
+
+#define GCCNUM 1000
+
+#undef ROCKBOX_HAS_LOGF
+#undef DO_BOOTCHART
+
+#define ROCKBOX_DIR "/.rockbox"
+#define ROCKBOX_SHARE_PATH ""
+#define ROCKBOX_BINARY_PATH ""
+#define ROCKBOX_LIBRARY_PATH ""
+
+#endif /* __BUILD_AUTOCONF_H */
@@ -0,0 +1,19 @@
+/* Included ahead of everything built for the target side of the harness.
+ *
+ * The target is configured as usual, then the parts the harness doesn't
+ * have are taken back out: there is no dircache thread and no multiboot
+ * redirect, and storage is the image backend in storage-image.c, which
+ * stands in for the ramdisk driver. */
+#ifndef FATTEST_CONFIG_H
+#define FATTEST_CONFIG_H
+
+#include "config.h"
+
+#undef HAVE_DIRCACHE
+#undef HAVE_MULTIBOOT
+#undef HAVE_BOOTDATA
+
+#undef CONFIG_STORAGE
+#define CONFIG_STORAGE STORAGE_RAMDISK
+
+#endif /* FATTEST_CONFIG_H */
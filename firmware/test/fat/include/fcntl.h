@@ -0,0 +1,3 @@
+/* The filesystem code declares open() and friends itself, the way they are
+   on target, so keep the host's declarations out of the way */
+#include "../../../libc/include/fcntl.h"
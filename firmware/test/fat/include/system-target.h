@@ -0,0 +1,16 @@
+/* system-target.h for the host FAT harness: no interrupts, no caches */
+#ifndef SYSTEM_TARGET_H
+#define SYSTEM_TARGET_H
+
+#define disable_irq()
+#define enable_irq()
+#define disable_irq_save() 0
+#define restore_irq(level) ((void)(level))
+#define wait_for_interrupt()
+
+static inline void commit_dcache(void) {}
+static inline void commit_discard_dcache(void) {}
+static inline void commit_discard_idcache(void) {}
+static inline void core_sleep(void) {}
+
+#endif /* SYSTEM_TARGET_H */
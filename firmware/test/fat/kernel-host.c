@@ -0,0 +1,134 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Copyright (C) 2026 by the Rockbox contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+
+/* What the filesystem needs of the kernel and the rest of the firmware. The
+ * harness runs on a single thread, so the locks only have to exist; time is
+ * the host's. */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "config.h"
+#include "kernel.h"
+#include "mrsw_lock.h"
+#include "panic.h"
+#include "debug.h"
+#include "rtc.h"
+#include "fattest.h"
+#include "image.h"
+
+volatile long current_tick;
+
+/* target builds get these from the linker script */
+#define AUDIOBUFFER_SIZE 0x800000
+#define _STR(x) #x
+#define STR(x) _STR(x)
+unsigned char audiobuffer[AUDIOBUFFER_SIZE] __attribute__((aligned(16)));
+__asm__(".globl audiobufend\n"
+        ".set audiobufend, audiobuffer + " STR(AUDIOBUFFER_SIZE));
+
+bool fattest_verbose;
+
+void update_tick(void)
+{
+    current_tick = host_time_ms() / (1000 / HZ);
+}
+
+void yield(void)
+{
+    update_tick();
+}
+
+void mutex_init(struct mutex *m)
+{
+    (void)m;
+}
+
+void mutex_lock(struct mutex *m)
+{
+    (void)m;
+}
+
+void mutex_unlock(struct mutex *m)
+{
+    (void)m;
+}
+
+void mrsw_init(struct mrsw_lock *mrsw)
+{
+    (void)mrsw;
+}
+
+void mrsw_read_acquire(struct mrsw_lock *mrsw)
+{
+    (void)mrsw;
+}
+
+void mrsw_read_release(struct mrsw_lock *mrsw)
+{
+    (void)mrsw;
+}
+
+void mrsw_write_acquire(struct mrsw_lock *mrsw)
+{
+    (void)mrsw;
+}
+
+void mrsw_write_release(struct mrsw_lock *mrsw)
+{
+    (void)mrsw;
+}
+
+/* timestamps are fixed so that images come out the same every run */
+int rtc_read_datetime(struct tm *tm)
+{
+    *tm = (struct tm){ .tm_year = 126, .tm_mon = 0, .tm_mday = 1,
+                       .tm_hour = 12 };
+    return 1;
+}
+
+int rtc_write_datetime(const struct tm *tm)
+{
+    (void)tm;
+    return 1;
+}
+
+void panicf(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    fputs("*PANIC* ", stderr);
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+    va_end(ap);
+    exit(FATTEST_PANIC);
+}
+
+void debugf(const char *fmt, ...)
+{
+    if (!fattest_verbose)
+        return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+}
@@ -0,0 +1,202 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Copyright (C) 2026 by the Rockbox contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+
+/* Formats the image with an empty FAT16 or FAT32 volume, so that tests can
+ * start from a known state. The harness builds fat.c with TEST_FAT, which
+ * tells FAT16 from FAT32 by the BPB rather than by the cluster count, so small
+ * FAT32 images work too. */
+#include <stdio.h>
+#include <string.h>
+#include "image.h"
+
+#define MBR_START       2048 /* sectors before the partition */
+
+#define DIR_ENTRY_SIZE  32
+#define ROOT_ENTRIES    512  /* FAT16 */
+#define RESERVED16      1
+#define RESERVED32      32
+#define FSINFO_SECTOR   1
+#define BACKUP_BOOT     6
+
+static void put16(unsigned char *p, unsigned int v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void put32(unsigned char *p, uint32_t v)
+{
+    put16(p, v);
+    put16(p + 2, v >> 16);
+}
+
+/* the usual cluster size for a volume of this size */
+static unsigned int default_secperclus(uint64_t sectors, int fatbits)
+{
+    uint64_t mb = sectors / 2048;
+
+    if (fatbits == 16)
+        return mb <= 16 ? 2 : mb <= 128 ? 4 : mb <= 256 ? 8 :
+               mb <= 512 ? 16 : mb <= 1024 ? 32 : 64;
+    else
+        return mb <= 256 ? 1 : mb <= 8192 ? 8 : mb <= 16384 ? 16 :
+               mb <= 32768 ? 32 : 64;
+}
+
+bool mkfs_fat(int fatbits, unsigned int secperclus, bool mbr)
+{
+    unsigned char *disk = image_data();
+    uint64_t start = mbr ? MBR_START : 0;
+    uint64_t total = image_sectors();
+
+    if (total <= start + 64)
+    {
+        fprintf(stderr, "image too small\n");
+        return false;
+    }
+
+    uint64_t sectors = total - start;
+    if (sectors > 0xffffffffu)
+        sectors = 0xffffffffu;
+
+    if (!secperclus)
+        secperclus = default_secperclus(sectors, fatbits);
+
+    if (secperclus > 128 || (secperclus & (secperclus - 1)))
+    {
+        fprintf(stderr, "bad cluster size: %u sectors\n", secperclus);
+        return false;
+    }
+
+    unsigned int reserved = fatbits == 16 ? RESERVED16 : RESERVED32;
+    unsigned int rootsectors = fatbits == 16 ?
+        ROOT_ENTRIES*DIR_ENTRY_SIZE / IMAGE_SECTOR_SIZE : 0;
+
+    /* solve for the FAT size; one more round catches the rounding */
+    uint64_t clusters = 0, fatsize = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        clusters = (sectors - reserved - rootsectors - 2*fatsize) / secperclus;
+        fatsize = ((clusters + 2)*(fatbits / 8) + IMAGE_SECTOR_SIZE - 1)
+                    / IMAGE_SECTOR_SIZE;
+    }
+
+    clusters = (sectors - reserved - rootsectors - 2*fatsize) / secperclus;
+
+    if (fatbits == 16 ? (clusters < 4085 || clusters > 65524) :
+                        (clusters < 2 || clusters > 0x0ffffff5))
+    {
+        fprintf(stderr, "%llu clusters of %u sectors can't be FAT%d\n",
+                (unsigned long long)clusters, secperclus, fatbits);
+        return false;
+    }
+
+    memset(disk, 0, (start + reserved + 2*fatsize + rootsectors)
+                        * IMAGE_SECTOR_SIZE);
+
+    if (mbr)
+    {
+        unsigned char *pte = disk + 0x1be;
+        pte[4] = fatbits == 16 ? 0x06 : 0x0c;
+        put32(pte + 8, start);
+        put32(pte + 12, sectors);
+        put16(disk + 0x1fe, 0xaa55);
+    }
+
+    unsigned char *bs = disk + start*IMAGE_SECTOR_SIZE;
+    memcpy(bs, "\xeb\x58\x90" "ROCKBOX ", 11);
+    put16(bs + 11, IMAGE_SECTOR_SIZE);
+    bs[13] = secperclus;
+    put16(bs + 14, reserved);
+    bs[16] = 2;                             /* number of FATs */
+    put16(bs + 17, fatbits == 16 ? ROOT_ENTRIES : 0);
+    if (sectors < 0x10000 && fatbits == 16)
+        put16(bs + 19, sectors);
+    else
+        put32(bs + 32, sectors);
+    bs[21] = 0xf8;                          /* media: fixed disk */
+    put16(bs + 24, 63);                     /* sectors per track */
+    put16(bs + 26, 255);                    /* heads */
+    put32(bs + 28, start);                  /* hidden sectors */
+
+    unsigned char *ext;
+    if (fatbits == 16)
+    {
+        put16(bs + 22, fatsize);
+        ext = bs + 36;
+    }
+    else
+    {
+        put32(bs + 36, fatsize);
+        put32(bs + 44, 2);                  /* root directory cluster */
+        put16(bs + 48, FSINFO_SECTOR);
+        put16(bs + 50, BACKUP_BOOT);
+        ext = bs + 64;
+    }
+
+    ext[0] = 0x80;                          /* drive number */
+    ext[2] = 0x29;                          /* extended boot signature */
+    put32(ext + 3, 0x20260101);             /* serial number */
+    memcpy(ext + 7, "NO NAME    ", 11);
+    memcpy(ext + 18, fatbits == 16 ? "FAT16   " : "FAT32   ", 8);
+    put16(bs + 510, 0xaa55);
+
+    if (fatbits == 32)
+    {
+        unsigned char *fsinfo = bs + FSINFO_SECTOR*IMAGE_SECTOR_SIZE;
+        put32(fsinfo, 0x41615252);
+        put32(fsinfo + 484, 0x61417272);
+        put32(fsinfo + 488, clusters - 1);  /* free: all but the root */
+        put32(fsinfo + 492, 3);             /* next free */
+        put16(fsinfo + 510, 0xaa55);
+
+        memcpy(bs + BACKUP_BOOT*IMAGE_SECTOR_SIZE, bs, 2*IMAGE_SECTOR_SIZE);
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        unsigned char *fat = bs + (reserved + i*fatsize)*IMAGE_SECTOR_SIZE;
+        if (fatbits == 16)
+        {
+            put16(fat, 0xfff8);
+            put16(fat + 2, 0xffff);
+        }
+        else
+        {
+            put32(fat, 0x0ffffff8);
+            put32(fat + 4, 0x0fffffff);
+            put32(fat + 8, 0x0fffffff);     /* the root directory */
+        }
+    }
+
+    uint64_t datastart = start + reserved + 2*fatsize + rootsectors;
+    if (fatbits == 32)
+    {
+        /* the root directory's cluster */
+        memset(disk + datastart*IMAGE_SECTOR_SIZE, 0,
+               secperclus*IMAGE_SECTOR_SIZE);
+    }
+
+    printf("FAT%d: %llu clusters of %u bytes, data at sector %llu\n",
+           fatbits, (unsigned long long)clusters,
+           secperclus*IMAGE_SECTOR_SIZE, (unsigned long long)datastart);
+    return true;
+}
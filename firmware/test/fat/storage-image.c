@@ -0,0 +1,119 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Copyright (C) 2026 by the Rockbox contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+
+/* Storage on the disk image, in the manner of the ramdisk driver. Drive 0 is
+ * the image; any other drive isn't there. */
+#include "config.h"
+#include "storage.h"
+#include "image.h"
+
+static long last_disk_activity = -1;
+
+static bool image_drive(IF_MD_NONVOID(int drive))
+{
+#ifdef HAVE_MULTIDRIVE
+    return drive == 0;
+#else
+    return true;
+#endif
+}
+
+int storage_read_sectors(IF_MD(int drive,) sector_t start, int count,
+                         void* buf)
+{
+    if (!image_drive(IF_MD(drive)))
+        return -1;
+
+    last_disk_activity = current_tick;
+    return image_read(start, count, buf);
+}
+
+int storage_write_sectors(IF_MD(int drive,) sector_t start, int count,
+                          const void* buf)
+{
+    if (!image_drive(IF_MD(drive)))
+        return -1;
+
+    last_disk_activity = current_tick;
+    return image_write(start, count, buf);
+}
+
+#ifdef HAVE_STORAGE_ASYNC
+/* requests are done as they come; this only checks the callers' side */
+void storage_request_submit(struct storage_request *req)
+{
+    int rc = (req->flags & STORAGE_REQ_WRITE) ?
+        storage_write_sectors(IF_MD(req->drive,) req->start, req->count,
+                              req->buf) :
+        storage_read_sectors(IF_MD(req->drive,) req->start, req->count,
+                             req->buf);
+
+    rc = rc < 0 ? rc : 0;
+    req->next = NULL;
+    req->merged = NULL;
+
+    if (req->callback)
+        req->callback(req, rc);
+
+    req->rc = rc;
+}
+
+bool storage_request_poll(struct storage_request *req)
+{
+    return req->rc != STORAGE_REQ_PENDING;
+}
+
+int storage_request_wait(struct storage_request *req)
+{
+    return req->rc;
+}
+#endif /* HAVE_STORAGE_ASYNC */
+
+#ifdef STORAGE_GET_INFO
+void ramdisk_get_info(IF_MD(int drive,) struct storage_info *info)
+{
+    info->revision = "0.00";
+    info->vendor = "Rockbox";
+    info->product = "Disk image";
+    info->num_sectors = image_drive(IF_MD(drive)) ? image_sectors() : 0;
+    info->sector_size = IMAGE_SECTOR_SIZE;
+}
+#endif /* STORAGE_GET_INFO */
+
+long ramdisk_last_disk_activity(void)
+{
+    return last_disk_activity;
+}
+
+#ifdef HAVE_HOTSWAP
+bool ramdisk_removable(IF_MD_NONVOID(int drive))
+{
+#ifdef HAVE_MULTIDRIVE
+    (void)drive;
+#endif
+    return false;
+}
+
+bool ramdisk_present(IF_MD_NONVOID(int drive))
+{
+    return image_drive(IF_MD(drive));
+}
+#endif /* HAVE_HOTSWAP */
@@ -80,7 +80,7 @@
  * when this happens please take the opportunity to sort in
  * any new functions "waiting" at the end of the list.
  */
-#define CODEC_API_VERSION 50
+#define CODEC_API_VERSION 52
 
 /* reasons for calling codec main entrypoint */
 enum codec_entry_call_reason {
@@ -106,6 +106,14 @@ enum codec_command_action {
     CODEC_ACTION_MAX = LONG_MAX,
 };
 
+/* One entry of a track's seek index: the frame starting at byte offset 'pos'
+   begins at 'time'. The unit of 'time' is up to the codec (milliseconds,
+   samples...) but must be used consistently for a given format. */
+struct seek_point {
+    uint32_t time;
+    uint32_t pos;
+};
+
 /* NOTE: To support backwards compatibility, only add new functions at
          the end of the structure.  Every time you add a new function,
          remember to increase CODEC_API_VERSION.  If you make changes to the
@@ -224,6 +232,30 @@ struct codec_api {
 
     /* new stuff at the end, sort into place next time
        the API gets incompatible */
+
+    /* Persistent seek index of the current track. Points are added during
+       decode at frame boundaries; find() narrows *lo and *hi, which the
+       codec presets with its own bounds, to the closest indexed points
+       around 'time' and returns true if either one was changed. */
+    void (*seek_index_add)(unsigned long time, off_t pos);
+    bool (*seek_index_find)(unsigned long time, struct seek_point *lo,
+                            struct seek_point *hi);
+};
+
+/* Reentrant decoding, optional. A codec that can keep the whole state of a
+   stream in memory provided by the caller exports this with CODEC_CTX_HEADER.
+   The core may then decode more streams with the loaded codec, next to the
+   one run through ci, without loading it again. Each stream has a codec_api
+   of its own: the stream callbacks (buffer access, pcmbuf_insert, configure,
+   get_command, seek index...) and id3, curpos and filesize refer to that
+   stream, the rest is the same as in ci. */
+struct codec_context_ops {
+    /* Size of the context memory needed for one stream */
+    size_t size;
+    /* Decode a stream like run_proc does. ctx must be 'size' bytes aligned
+       to pointer size, its contents on entry don't matter. May run in any
+       thread. */
+    enum codec_status (*run)(struct codec_api *api, void *ctx);
 };
 
 /* codec header */
@@ -233,6 +265,7 @@ struct codec_header {
     enum codec_status(*run_proc)(void);
     struct codec_api **api;
     size_t api_size;
+    const struct codec_context_ops *ctx_ops; /* NULL if not reentrant */
     void * rec_extension[]; /* extension for encoders */
 };
 
@@ -247,14 +280,23 @@ extern unsigned char plugin_end_addr[];
         __attribute__ ((section (".header")))= { \
         { CODEC_MAGIC, TARGET_ID, CODEC_API_VERSION, \
           plugin_start_addr, plugin_end_addr }, \
-        codec_start, codec_run, &ci, sizeof(struct codec_api) };
+        codec_start, codec_run, &ci, sizeof(struct codec_api), NULL };
+/* reentrant decoders */
+#define CODEC_CTX_HEADER \
+        extern const struct codec_context_ops codec_ctx_ops; \
+        const struct codec_header __header \
+        __attribute__ ((section (".header")))= { \
+        { CODEC_MAGIC, TARGET_ID, CODEC_API_VERSION, \
+          plugin_start_addr, plugin_end_addr }, \
+        codec_start, codec_run, &ci, sizeof(struct codec_api), \
+        &codec_ctx_ops };
 /* encoders */
 #define CODEC_ENC_HEADER \
         const struct codec_header __header \
         __attribute__ ((section (".header")))= { \
         { CODEC_ENC_MAGIC, TARGET_ID, CODEC_API_VERSION, \
           plugin_start_addr, plugin_end_addr }, \
-        codec_start, codec_run, &ci, sizeof(struct codec_api), \
+        codec_start, codec_run, &ci, sizeof(struct codec_api), NULL, \
         { enc_callback } };
 
 #else /* def SIMULATOR */
@@ -263,13 +305,21 @@ extern unsigned char plugin_end_addr[];
         const struct codec_header __header \
         __attribute__((visibility("default"))) = { \
         { CODEC_MAGIC, TARGET_ID, CODEC_API_VERSION, NULL, NULL }, \
-        codec_start, codec_run, &ci, sizeof(struct codec_api) };
+        codec_start, codec_run, &ci, sizeof(struct codec_api), NULL };
+/* reentrant decoders */
+#define CODEC_CTX_HEADER \
+        extern const struct codec_context_ops codec_ctx_ops; \
+        const struct codec_header __header \
+        __attribute__((visibility("default"))) = { \
+        { CODEC_MAGIC, TARGET_ID, CODEC_API_VERSION, NULL, NULL }, \
+        codec_start, codec_run, &ci, sizeof(struct codec_api), \
+        &codec_ctx_ops };
 /* encoders */
 #define CODEC_ENC_HEADER \
         const struct codec_header __header \
         __attribute__((visibility("default"))) = { \
         { CODEC_ENC_MAGIC, TARGET_ID, CODEC_API_VERSION, NULL, NULL }, \
-        codec_start, codec_run, &ci, sizeof(struct codec_api), \
+        codec_start, codec_run, &ci, sizeof(struct codec_api), NULL, \
         { enc_callback } };
 #endif /* SIMULATOR */
 #endif /* CODEC */
@@ -288,6 +338,11 @@ int codec_load_buf(int hid, struct codec_api *api);
 int codec_load_file(const char* codec, struct codec_api *api);
 int codec_run_proc(void);
 int codec_close(void);
+/* Reentrant decoding with the loaded codec. Contexts must be done running
+   before the codec is closed. */
+size_t codec_context_size(void);
+void codec_context_init_api(struct codec_api *api);
+int codec_run_context(struct codec_api *api, void *ctx);
 #if defined(HAVE_RECORDING)
 enc_callback_t codec_get_enc_callback(void);
 #endif
@@ -0,0 +1,238 @@
+/*
+
+libdemac - A Monkey's Audio decoder
+
+$Id$
+
+Copyright (C) Dave Chapman 2007
+
+SSE2 vector math based on the MMX version by Jens Arnold
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+
+*/
+
+#define FUSED_VECTOR_MATH
+
+/* Each block handles 8 coefficients. The history pointers advance by one
+ * sample per call and the filter buffers are only guaranteed pointer size
+ * alignment on hosted targets, so all accesses are unaligned. Orders above
+ * 256 loop over chunks of 256 coefficients. */
+
+#define REPEAT_XB3(x, n) x(n) x(n+16) x(n+32)
+#define REPEAT_XB7(x, n) x(n) x(n+16) x(n+32) x(n+48) x(n+64) x(n+80) x(n+96)
+#define REPEAT_XB8(x, n) REPEAT_XB7(x, n) x(n+112)
+
+#if ORDER == 16     /* 1 time */
+#define REPEAT_XB(x) x(16)
+#elif ORDER == 32   /* 3 times */
+#define REPEAT_XB(x) REPEAT_XB3(x, 16)
+#elif ORDER == 64   /* 7 times */
+#define REPEAT_XB(x) REPEAT_XB7(x, 16)
+#elif ORDER == 256  /* 7+8*3 == 31 times */
+#define REPEAT_XB(x) REPEAT_XB7(x,  16) REPEAT_XB8(x, 128) \
+                     REPEAT_XB8(x, 256) REPEAT_XB8(x, 384)
+#elif ORDER == 1280 /* 8*4 == 32 times */
+#define REPEAT_XB(x) REPEAT_XB8(x,   0) REPEAT_XB8(x, 128) \
+                     REPEAT_XB8(x, 256) REPEAT_XB8(x, 384)
+#else
+#error unsupported order
+#endif
+
+/* Add the four dwords of xmm2 and move the sum to res */
+#define SSE2_HADD                            \
+        "pshufd  $0x4e, %%xmm2, %%xmm0   \n" \
+        "paddd   %%xmm0, %%xmm2          \n" \
+        "pshufd  $0xb1, %%xmm2, %%xmm0   \n" \
+        "paddd   %%xmm0, %%xmm2          \n" \
+        "movd    %%xmm2, %[res]          \n"
+
+static inline int32_t vector_sp_add(int16_t* v1, int16_t* f2, int16_t *s2)
+{
+    int res;
+#if ORDER > 256
+    int cnt = ORDER>>8;
+#endif
+
+    asm volatile (
+#if ORDER > 256
+        "pxor    %%xmm2, %%xmm2      \n"
+    "1:                              \n"
+#else
+        "movdqu  (%[v1]), %%xmm2     \n"
+        "movdqu  (%[f2]), %%xmm3     \n"
+        "movdqu  (%[s2]), %%xmm4     \n"
+        "movdqa  %%xmm2, %%xmm0      \n"
+        "pmaddwd %%xmm3, %%xmm2      \n"
+        "paddw   %%xmm4, %%xmm0      \n"
+        "movdqu  %%xmm0, (%[v1])     \n"
+#endif
+
+#define SP_ADD_BLOCK(n)                      \
+        "movdqu  " #n "(%[v1]), %%xmm1   \n" \
+        "movdqu  " #n "(%[f2]), %%xmm3   \n" \
+        "movdqu  " #n "(%[s2]), %%xmm4   \n" \
+        "movdqa  %%xmm1, %%xmm0          \n" \
+        "pmaddwd %%xmm3, %%xmm1          \n" \
+        "paddw   %%xmm4, %%xmm0          \n" \
+        "movdqu  %%xmm0, " #n "(%[v1])   \n" \
+        "paddd   %%xmm1, %%xmm2          \n"
+
+REPEAT_XB(SP_ADD_BLOCK)
+
+#if ORDER > 256
+        "add     $512, %[v1]         \n"
+        "add     $512, %[s2]         \n"
+        "add     $512, %[f2]         \n"
+        "dec     %[cnt]              \n"
+        "jne     1b                  \n"
+#endif
+
+        SSE2_HADD
+        : /* outputs */
+#if ORDER > 256
+        [cnt]"+r"(cnt),
+        [v1] "+r"(v1),
+        [f2] "+r"(f2),
+        [s2] "+r"(s2),
+        [res]"=r"(res)
+        : /* inputs */
+#else
+        [res]"=r"(res)
+        : /* inputs */
+        [v1]"r"(v1),
+        [f2]"r"(f2),
+        [s2]"r"(s2)
+#endif
+        : /* clobbers */
+        "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "memory"
+    );
+    return res;
+}
+
+static inline int32_t vector_sp_sub(int16_t* v1, int16_t* f2, int16_t *s2)
+{
+    int res;
+#if ORDER > 256
+    int cnt = ORDER>>8;
+#endif
+
+    asm volatile (
+#if ORDER > 256
+        "pxor    %%xmm2, %%xmm2      \n"
+    "1:                              \n"
+#else
+        "movdqu  (%[v1]), %%xmm2     \n"
+        "movdqu  (%[f2]), %%xmm3     \n"
+        "movdqu  (%[s2]), %%xmm4     \n"
+        "movdqa  %%xmm2, %%xmm0      \n"
+        "pmaddwd %%xmm3, %%xmm2      \n"
+        "psubw   %%xmm4, %%xmm0      \n"
+        "movdqu  %%xmm0, (%[v1])     \n"
+#endif
+
+#define SP_SUB_BLOCK(n)                      \
+        "movdqu  " #n "(%[v1]), %%xmm1   \n" \
+        "movdqu  " #n "(%[f2]), %%xmm3   \n" \
+        "movdqu  " #n "(%[s2]), %%xmm4   \n" \
+        "movdqa  %%xmm1, %%xmm0          \n" \
+        "pmaddwd %%xmm3, %%xmm1          \n" \
+        "psubw   %%xmm4, %%xmm0          \n" \
+        "movdqu  %%xmm0, " #n "(%[v1])   \n" \
+        "paddd   %%xmm1, %%xmm2          \n"
+
+REPEAT_XB(SP_SUB_BLOCK)
+
+#if ORDER > 256
+        "add     $512, %[v1]         \n"
+        "add     $512, %[s2]         \n"
+        "add     $512, %[f2]         \n"
+        "dec     %[cnt]              \n"
+        "jne     1b                  \n"
+#endif
+
+        SSE2_HADD
+        : /* outputs */
+#if ORDER > 256
+        [cnt]"+r"(cnt),
+        [v1] "+r"(v1),
+        [f2] "+r"(f2),
+        [s2] "+r"(s2),
+        [res]"=r"(res)
+        : /* inputs */
+#else
+        [res]"=r"(res)
+        : /* inputs */
+        [v1]"r"(v1),
+        [f2]"r"(f2),
+        [s2]"r"(s2)
+#endif
+        : /* clobbers */
+        "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "memory"
+    );
+    return res;
+}
+
+static inline int32_t scalarproduct(int16_t* v1, int16_t* v2)
+{
+    int res;
+#if ORDER > 256
+    int cnt = ORDER>>8;
+#endif
+
+    asm volatile (
+#if ORDER > 256
+        "pxor    %%xmm2, %%xmm2      \n"
+    "1:                              \n"
+#else
+        "movdqu  (%[v1]), %%xmm2     \n"
+        "movdqu  (%[v2]), %%xmm3     \n"
+        "pmaddwd %%xmm3, %%xmm2      \n"
+#endif
+
+#define SP_BLOCK(n)                          \
+        "movdqu  " #n "(%[v1]), %%xmm1   \n" \
+        "movdqu  " #n "(%[v2]), %%xmm3   \n" \
+        "pmaddwd %%xmm3, %%xmm1          \n" \
+        "paddd   %%xmm1, %%xmm2          \n"
+
+REPEAT_XB(SP_BLOCK)
+
+#if ORDER > 256
+        "add     $512, %[v1]         \n"
+        "add     $512, %[v2]         \n"
+        "dec     %[cnt]              \n"
+        "jne     1b                  \n"
+#endif
+
+        SSE2_HADD
+        : /* outputs */
+#if ORDER > 256
+        [cnt]"+r"(cnt),
+        [v1] "+r"(v1),
+        [v2] "+r"(v2),
+        [res]"=r"(res)
+        : /* inputs */
+#else
+        [res]"=r"(res)
+        : /* inputs */
+        [v1]"r"(v1),
+        [v2]"r"(v2)
+#endif
+        : /* clobbers */
+        "xmm0", "xmm1", "xmm2", "xmm3", "memory"
+    );
+    return res;
+}
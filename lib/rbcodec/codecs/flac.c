@@ -22,18 +22,7 @@
 #include "codeclib.h"
 #include <codecs/libffmpegFLAC/decoder.h>
 
-CODEC_HEADER
-
-static FLACContext fc IBSS_ATTR_FLAC;
-
-/* The output buffers containing the decoded samples (channels 0 and 1) */
-static int32_t decoded0[MAX_BLOCKSIZE] IBSS_ATTR_FLAC;
-static int32_t decoded1[MAX_BLOCKSIZE] IBSS_ATTR_FLAC;
-static int32_t decoded2[MAX_BLOCKSIZE] IBSS_ATTR_FLAC_LARGE_IRAM;
-static int32_t decoded3[MAX_BLOCKSIZE] IBSS_ATTR_FLAC_LARGE_IRAM;
-static int32_t decoded4[MAX_BLOCKSIZE] IBSS_ATTR_FLAC_XLARGE_IRAM;
-static int32_t decoded5[MAX_BLOCKSIZE] IBSS_ATTR_FLAC_XLARGE_IRAM;
-static int32_t decoded6[MAX_BLOCKSIZE] IBSS_ATTR_FLAC_XXLARGE_IRAM;
+CODEC_CTX_HEADER
 
 #define MAX_SUPPORTED_SEEKTABLE_SIZE 5000
 
@@ -72,14 +61,57 @@ struct FLACseekpoints {
     uint16_t blocksize;
 };
 
+/* State of one stream. The stream played through ci uses the static
+   buffers below, streams decoded through the context interface keep
+   everything in struct flac_ctx. */
+struct flac_stream {
+    struct codec_api *api;
+    FLACContext *fc;
+    int32_t *decoded[MAX_CHANNELS];
+
+    struct FLACseekpoints *seekpoints;
+    int nseekpoints;
+
+    /* Without a complete seek table, a seek index with a point about every
+       second is built during playback. Its time unit is samples. */
+    bool use_seek_index;
+    uint32_t index_next;
+
+    int8_t *bit_buffer;
+    size_t buff_size;
+};
+
+struct flac_ctx {
+    struct flac_stream s;
+    FLACContext fc;
+    int32_t decoded[MAX_CHANNELS][MAX_BLOCKSIZE];
+    struct FLACseekpoints seekpoints[MAX_SUPPORTED_SEEKTABLE_SIZE];
+};
+
+static FLACContext fc IBSS_ATTR_FLAC;
+
+/* The output buffers containing the decoded samples (channels 0 and 1) */
+static int32_t decoded0[MAX_BLOCKSIZE] IBSS_ATTR_FLAC;
+static int32_t decoded1[MAX_BLOCKSIZE] IBSS_ATTR_FLAC;
+static int32_t decoded2[MAX_BLOCKSIZE] IBSS_ATTR_FLAC_LARGE_IRAM;
+static int32_t decoded3[MAX_BLOCKSIZE] IBSS_ATTR_FLAC_LARGE_IRAM;
+static int32_t decoded4[MAX_BLOCKSIZE] IBSS_ATTR_FLAC_XLARGE_IRAM;
+static int32_t decoded5[MAX_BLOCKSIZE] IBSS_ATTR_FLAC_XLARGE_IRAM;
+static int32_t decoded6[MAX_BLOCKSIZE] IBSS_ATTR_FLAC_XXLARGE_IRAM;
+
 static struct FLACseekpoints seekpoints[MAX_SUPPORTED_SEEKTABLE_SIZE];
-static int nseekpoints;
 
-static int8_t *bit_buffer;
-static size_t buff_size;
+static struct flac_stream stream = {
+    .fc = &fc,
+    .decoded = { decoded0, decoded1, decoded2, decoded3,
+                 decoded4, decoded5, decoded6 },
+    .seekpoints = seekpoints,
+};
 
-static bool flac_init(FLACContext* fc, int first_frame_offset)
+static bool flac_init(struct flac_stream *s, int first_frame_offset)
 {
+    struct codec_api *api = s->api;
+    FLACContext *fc = s->fc;
     unsigned char buf[255];
     bool found_streaminfo=false;
     uint32_t seekpoint_hi,seekpoint_lo;
@@ -87,48 +119,38 @@ static bool flac_init(FLACContext* fc, int first_frame_offset)
     uint16_t blocksize;
     int endofmetadata=0;
     uint32_t blocklength;
+    int i;
 
-    ci->memset(fc,0,sizeof(FLACContext));
-    nseekpoints=0;
+    api->memset(fc,0,sizeof(FLACContext));
+    s->nseekpoints=0;
+    s->use_seek_index=true;
 
     fc->sample_skip = 0;
 
-    /* Reset sample buffers */
-    ci->memset(decoded0, 0, sizeof(decoded0));
-    ci->memset(decoded1, 0, sizeof(decoded1));
-    ci->memset(decoded2, 0, sizeof(decoded2));
-    ci->memset(decoded3, 0, sizeof(decoded3));
-    ci->memset(decoded4, 0, sizeof(decoded4));
-    ci->memset(decoded5, 0, sizeof(decoded5));
-    ci->memset(decoded6, 0, sizeof(decoded5));
-
-    /* Set sample buffers in decoder structure */
-    fc->decoded[0] = decoded0;
-    fc->decoded[1] = decoded1;
-    fc->decoded[2] = decoded2;
-    fc->decoded[3] = decoded3;
-    fc->decoded[4] = decoded4;
-    fc->decoded[5] = decoded5;
-    fc->decoded[6] = decoded6;
+    /* Reset sample buffers and set them in decoder structure */
+    for (i = 0; i < MAX_CHANNELS; i++) {
+        api->memset(s->decoded[i], 0, MAX_BLOCKSIZE*sizeof(int32_t));
+        fc->decoded[i] = s->decoded[i];
+    }
 
     /* Skip any foreign tags at start of file */
-    ci->seek_buffer(first_frame_offset);
+    api->seek_buffer(first_frame_offset);
 
     fc->metadatalength = first_frame_offset;
 
-    if (ci->read_filebuf(buf, 4) < 4)
+    if (api->read_filebuf(buf, 4) < 4)
     {
         return false;
     }
 
-    if (ci->memcmp(buf,"fLaC",4) != 0)
+    if (api->memcmp(buf,"fLaC",4) != 0)
     {
         return false;
     }
     fc->metadatalength += 4;
 
     while (!endofmetadata) {
-        if (ci->read_filebuf(buf, 4) < 4)
+        if (api->read_filebuf(buf, 4) < 4)
         {
             return false;
         }
@@ -139,9 +161,9 @@ static bool flac_init(FLACContext* fc, int first_frame_offset)
 
         if ((buf[0] & 0x7f) == 0)       /* 0 is the STREAMINFO block */
         {
-            if (ci->read_filebuf(buf, blocklength) < blocklength) return false;
+            if (api->read_filebuf(buf, blocklength) < blocklength) return false;
 
-            fc->filesize = ci->filesize;
+            fc->filesize = api->filesize;
             fc->min_blocksize = (buf[0] << 8) | buf[1];
             int max_blocksize = (buf[2] << 8) | buf[3];
             if (max_blocksize > MAX_BLOCKSIZE)
@@ -175,9 +197,9 @@ static bool flac_init(FLACContext* fc, int first_frame_offset)
 
             found_streaminfo=true;
         } else if ((buf[0] & 0x7f) == 3) { /* 3 is the SEEKTABLE block */
-            while ((nseekpoints < MAX_SUPPORTED_SEEKTABLE_SIZE) &&
+            while ((s->nseekpoints < MAX_SUPPORTED_SEEKTABLE_SIZE) &&
                    (blocklength >= 18)) {
-                if (ci->read_filebuf(buf,18) < 18) return false;
+                if (api->read_filebuf(buf,18) < 18) return false;
                 blocklength-=18;
 
                 seekpoint_hi=(buf[0] << 24) | (buf[1] << 16) |
@@ -194,18 +216,21 @@ static bool flac_init(FLACContext* fc, int first_frame_offset)
                 /* Only store seekpoints where the high 32 bits are zero */
                 if ((seekpoint_hi == 0) && (seekpoint_lo != 0xffffffff) &&
                     (offset_hi == 0)) {
-                        seekpoints[nseekpoints].sample=seekpoint_lo;
-                        seekpoints[nseekpoints].offset=offset_lo;
-                        seekpoints[nseekpoints].blocksize=blocksize;
-                        nseekpoints++;
+                        s->seekpoints[s->nseekpoints].sample=seekpoint_lo;
+                        s->seekpoints[s->nseekpoints].offset=offset_lo;
+                        s->seekpoints[s->nseekpoints].blocksize=blocksize;
+                        s->nseekpoints++;
                 }
             }
+            /* Only index the files whose seek table doesn't fit */
+            s->use_seek_index = (s->nseekpoints == 0 || blocklength >= 18);
+
             /* Skip any unread seekpoints */
             if (blocklength > 0)
-                ci->advance_buffer(blocklength);
+                api->advance_buffer(blocklength);
         } else {
           /* Skip to next metadata block */
-          ci->advance_buffer(blocklength);
+          api->advance_buffer(blocklength);
         }
     }
 
@@ -219,7 +244,9 @@ static bool flac_init(FLACContext* fc, int first_frame_offset)
 }
 
 /* Synchronize to next frame in stream - adapted from libFLAC 1.1.3b2 */
-static bool frame_sync(FLACContext* fc) {
+static bool frame_sync(struct flac_stream *s) {
+    struct codec_api *api = s->api;
+    FLACContext *fc = s->fc;
     unsigned int x = 0;
     bool cached = false;
 
@@ -255,15 +282,15 @@ static bool frame_sync(FLACContext* fc) {
     }
 
     /* Advance and init bit buffer to the new frame. */
-    ci->advance_buffer((get_bits_count(&fc->gb)-16)>>3); /* consumed bytes */
-    bit_buffer = ci->request_buffer(&buff_size, MAX_FRAMESIZE+16);
-    init_get_bits(&fc->gb, bit_buffer, buff_size*8);
+    api->advance_buffer((get_bits_count(&fc->gb)-16)>>3); /* consumed bytes */
+    s->bit_buffer = api->request_buffer(&s->buff_size, MAX_FRAMESIZE+16);
+    init_get_bits(&fc->gb, s->bit_buffer, s->buff_size*8);
 
     /* Decode the frame to verify the frame crc and
      * fill fc with its metadata.
      */
     if(flac_decode_frame(fc,
-       bit_buffer, buff_size, ci->yield) < 0) {
+       s->bit_buffer, s->buff_size, api->yield) < 0) {
         return false;
     }
 
@@ -271,8 +298,10 @@ static bool frame_sync(FLACContext* fc) {
 }
 
 /* Seek to sample - adapted from libFLAC 1.1.3b2+ */
-static bool flac_seek(FLACContext* fc, uint32_t target_sample) {
-    off_t orig_pos = ci->curpos;
+static bool flac_seek(struct flac_stream *s, uint32_t target_sample) {
+    struct codec_api *api = s->api;
+    FLACContext *fc = s->fc;
+    off_t orig_pos = api->curpos;
     off_t pos = -1;
     unsigned long lower_bound, upper_bound;
     unsigned long lower_bound_sample, upper_bound_sample;
@@ -298,25 +327,38 @@ static bool flac_seek(FLACContext* fc, uint32_t target_sample) {
     upper_bound_sample = fc->totalsamples>0 ? fc->totalsamples : target_sample;
 
     /* Refine the bounds if we have a seektable with suitable points. */
-    if(nseekpoints > 0) {
+    if(s->nseekpoints > 0) {
         /* Find the closest seek point <= target_sample, if it exists. */
-        for(i = nseekpoints-1; i >= 0; i--) {
-            if(seekpoints[i].sample <= target_sample)
+        for(i = s->nseekpoints-1; i >= 0; i--) {
+            if(s->seekpoints[i].sample <= target_sample)
                 break;
         }
         if(i >= 0) { /* i.e. we found a suitable seek point... */
-            lower_bound = fc->metadatalength + seekpoints[i].offset;
-            lower_bound_sample = seekpoints[i].sample;
+            lower_bound = fc->metadatalength + s->seekpoints[i].offset;
+            lower_bound_sample = s->seekpoints[i].sample;
         }
 
         /* Find the closest seek point > target_sample, if it exists. */
-        for(i = 0; i < nseekpoints; i++) {
-            if(seekpoints[i].sample > target_sample)
+        for(i = 0; i < s->nseekpoints; i++) {
+            if(s->seekpoints[i].sample > target_sample)
                 break;
         }
-        if(i < nseekpoints) { /* i.e. we found a suitable seek point... */
-            upper_bound = fc->metadatalength + seekpoints[i].offset;
-            upper_bound_sample = seekpoints[i].sample;
+        if(i < s->nseekpoints) { /* i.e. we found a suitable seek point... */
+            upper_bound = fc->metadatalength + s->seekpoints[i].offset;
+            upper_bound_sample = s->seekpoints[i].sample;
+        }
+    }
+
+    /* Refine them further with the seek index. */
+    if(s->use_seek_index) {
+        struct seek_point lo = { lower_bound_sample, lower_bound };
+        struct seek_point hi = { upper_bound_sample, upper_bound };
+
+        if(api->seek_index_find(target_sample, &lo, &hi)) {
+            lower_bound = lo.pos;
+            lower_bound_sample = lo.time;
+            upper_bound = hi.pos;
+            upper_bound_sample = hi.time;
         }
     }
 
@@ -341,11 +383,11 @@ static bool flac_seek(FLACContext* fc, uint32_t target_sample) {
                 pos = (off_t)lower_bound;
         }
 
-        if(!ci->seek_buffer(pos))
+        if(!api->seek_buffer(pos))
             return false;
 
-        bit_buffer = ci->request_buffer(&buff_size, MAX_FRAMESIZE+16);
-        init_get_bits(&fc->gb, bit_buffer, buff_size*8);
+        s->bit_buffer = api->request_buffer(&s->buff_size, MAX_FRAMESIZE+16);
+        init_get_bits(&fc->gb, s->bit_buffer, s->buff_size*8);
 
         /* Now we need to get a frame.  It is possible for our seek
          * to land in the middle of audio data that looks exactly like
@@ -361,11 +403,11 @@ static bool flac_seek(FLACContext* fc, uint32_t target_sample) {
             bool got_a_frame = false;
             for(unparseable_count = 0; !got_a_frame
                 && unparseable_count < 30; unparseable_count++) {
-                if(frame_sync(fc))
+                if(frame_sync(s))
                     got_a_frame = true;
             }
             if(!got_a_frame) {
-                ci->seek_buffer(orig_pos);
+                api->seek_buffer(orig_pos);
                 return false;
             }
         }
@@ -383,7 +425,7 @@ static bool flac_seek(FLACContext* fc, uint32_t target_sample) {
         if(this_frame_sample + this_block_size >= upper_bound_sample &&
            !first_seek) {
             if(pos == (off_t)lower_bound || !needs_seek) {
-                ci->seek_buffer(orig_pos);
+                api->seek_buffer(orig_pos);
                 return false;
             }
             /* Our last move backwards wasn't big enough, try again. */
@@ -397,7 +439,7 @@ static bool flac_seek(FLACContext* fc, uint32_t target_sample) {
 
         /* Make sure we are not seeking in a corrupted stream */
         if(this_frame_sample < lower_bound_sample) {
-            ci->seek_buffer(orig_pos);
+            api->seek_buffer(orig_pos);
             return false;
         }
 
@@ -406,17 +448,17 @@ static bool flac_seek(FLACContext* fc, uint32_t target_sample) {
         /* We need to narrow the search. */
         if(target_sample < this_frame_sample) {
             upper_bound_sample = this_frame_sample;
-            upper_bound = ci->curpos;
+            upper_bound = api->curpos;
         }
         else { /* Target is beyond this frame. */
             /* We are close, continue in decoding next frames. */
             if(target_sample < this_frame_sample + 4*this_block_size) {
-                pos = ci->curpos + fc->framesize;
+                pos = api->curpos + fc->framesize;
                 needs_seek = false;
             }
 
             lower_bound_sample = this_frame_sample + this_block_size;
-            lower_bound = ci->curpos + fc->framesize;
+            lower_bound = api->curpos + fc->framesize;
         }
     }
 
@@ -424,44 +466,37 @@ static bool flac_seek(FLACContext* fc, uint32_t target_sample) {
 }
 
 /* Seek to file offset */
-static bool flac_seek_offset(FLACContext* fc, uint32_t offset) {
+static bool flac_seek_offset(struct flac_stream *s, uint32_t offset) {
+    struct codec_api *api = s->api;
+    FLACContext *fc = s->fc;
     unsigned unparseable_count;
     bool got_a_frame = false;
 
-    if(!ci->seek_buffer(offset))
+    if(!api->seek_buffer(offset))
         return false;
 
-    bit_buffer = ci->request_buffer(&buff_size, MAX_FRAMESIZE);
-    init_get_bits(&fc->gb, bit_buffer, buff_size*8);
+    s->bit_buffer = api->request_buffer(&s->buff_size, MAX_FRAMESIZE);
+    init_get_bits(&fc->gb, s->bit_buffer, s->buff_size*8);
 
     for(unparseable_count = 0; !got_a_frame
         && unparseable_count < 10; unparseable_count++) {
-        if(frame_sync(fc))
+        if(frame_sync(s))
             got_a_frame = true;
     }
 
     if(!got_a_frame) {
-        ci->seek_buffer(fc->metadatalength);
+        api->seek_buffer(fc->metadatalength);
         return false;
     }
 
     return true;
 }
 
-/* this is the codec entry point */
-enum codec_status codec_main(enum codec_entry_call_reason reason)
-{
-    if (reason == CODEC_LOAD) {
-        /* Generic codec initialisation */
-        ci->configure(DSP_SET_SAMPLE_DEPTH, FLAC_OUTPUT_DEPTH-1);
-    }
-
-    return CODEC_OK;
-}
-
-/* this is called for each file to process */
-enum codec_status codec_run(void)
+/* Decode the stream from the resume position to the end */
+static enum codec_status flac_decode(struct flac_stream *s)
 {
+    struct codec_api *api = s->api;
+    FLACContext *fc = s->fc;
     int8_t *buf;
     uint32_t samplesdone;
     uint32_t elapsedtime;
@@ -471,82 +506,130 @@ enum codec_status codec_run(void)
     int frame;
     intptr_t param;
 
-    if (codec_init()) {
-        LOGF("FLAC: Error initialising codec\n");
-        return CODEC_ERROR;
-    }
-
     /* Need to save resume for later use (cleared indirectly by flac_init) */
-    elapsedtime = ci->id3->elapsed;
-    samplesdone = ci->id3->offset;
+    elapsedtime = api->id3->elapsed;
+    samplesdone = api->id3->offset;
 
-    if (!flac_init(&fc,ci->id3->first_frame_offset)) {
+    if (!flac_init(s, api->id3->first_frame_offset)) {
         LOGF("FLAC: Error initialising codec\n");
         return CODEC_ERROR;
     }
 
-    ci->configure(DSP_SET_FREQUENCY, ci->id3->frequency);
-    ci->configure(DSP_SET_STEREO_MODE, fc.channels == 1 ?
-                  STEREO_MONO : STEREO_NONINTERLEAVED);
-    codec_set_replaygain(ci->id3);
+    api->configure(DSP_SET_FREQUENCY, api->id3->frequency);
+    api->configure(DSP_SET_STEREO_MODE, fc->channels == 1 ?
+                   STEREO_MONO : STEREO_NONINTERLEAVED);
+    codec_api_set_replaygain(api, api->id3);
 
     if (samplesdone || !elapsedtime) {
-        flac_seek_offset(&fc, samplesdone);
-        samplesdone=fc.samplenumber+fc.blocksize;
-        elapsedtime=((uint64_t)samplesdone*1000)/(ci->id3->frequency);
+        flac_seek_offset(s, samplesdone);
+        samplesdone=fc->samplenumber+fc->blocksize;
+        elapsedtime=((uint64_t)samplesdone*1000)/(api->id3->frequency);
     }
-    else if (!flac_seek(&fc,(uint32_t)((uint64_t)elapsedtime
-                            *ci->id3->frequency/1000))) {
+    else if (!flac_seek(s,(uint32_t)((uint64_t)elapsedtime
+                            *api->id3->frequency/1000))) {
         elapsedtime = 0;
     }
 
-    ci->set_elapsed(elapsedtime);
+    api->set_elapsed(elapsedtime);
+    s->index_next = 0;
 
     /* The main decoding loop */
     frame=0;
-    buf = ci->request_buffer(&bytesleft, MAX_FRAMESIZE);
+    buf = api->request_buffer(&bytesleft, MAX_FRAMESIZE);
     while (bytesleft) {
-        long action = ci->get_command(&param);
+        long action = api->get_command(&param);
 
         if (action == CODEC_ACTION_HALT)
             break;
 
         /* Deal with any pending seek requests */
         if (action == CODEC_ACTION_SEEK_TIME) {
-            if (flac_seek(&fc,(uint32_t)(((uint64_t)param
-                *ci->id3->frequency)/1000))) {
+            if (flac_seek(s,(uint32_t)(((uint64_t)param
+                *api->id3->frequency)/1000))) {
                 /* Refill the input buffer */
-                buf = ci->request_buffer(&bytesleft, MAX_FRAMESIZE);
+                buf = api->request_buffer(&bytesleft, MAX_FRAMESIZE);
             }
 
-            ci->set_elapsed(param);
-            ci->seek_complete();
+            api->set_elapsed(param);
+            api->seek_complete();
+            s->index_next = 0;
         }
 
-        if((res=flac_decode_frame(&fc,buf,
-                             bytesleft,ci->yield)) < 0) {
+        if((res=flac_decode_frame(fc,buf,
+                             bytesleft,api->yield)) < 0) {
              LOGF("FLAC: Frame %d, error %d\n",frame,res);
              return CODEC_ERROR;
         }
-        consumed=fc.gb.index/8;
+        consumed=fc->gb.index/8;
         frame++;
 
-        ci->yield();
-        ci->pcmbuf_insert(&fc.decoded[0][fc.sample_skip], &fc.decoded[1][fc.sample_skip],
-                          fc.blocksize - fc.sample_skip);
+        if (s->use_seek_index && fc->samplenumber >= s->index_next) {
+            api->seek_index_add(fc->samplenumber, api->curpos);
+            s->index_next = fc->samplenumber + api->id3->frequency;
+        }
+
+        api->yield();
+        api->pcmbuf_insert(&fc->decoded[0][fc->sample_skip],
+                           &fc->decoded[1][fc->sample_skip],
+                           fc->blocksize - fc->sample_skip);
 
-        fc.sample_skip = 0;
+        fc->sample_skip = 0;
 
         /* Update the elapsed-time indicator */
-        samplesdone=fc.samplenumber+fc.blocksize;
-        elapsedtime=((uint64_t)samplesdone*1000)/(ci->id3->frequency);
-        ci->set_elapsed(elapsedtime);
+        samplesdone=fc->samplenumber+fc->blocksize;
+        elapsedtime=((uint64_t)samplesdone*1000)/(api->id3->frequency);
+        api->set_elapsed(elapsedtime);
 
-        ci->advance_buffer(consumed);
+        api->advance_buffer(consumed);
 
-        buf = ci->request_buffer(&bytesleft, MAX_FRAMESIZE);
+        buf = api->request_buffer(&bytesleft, MAX_FRAMESIZE);
     }
 
     LOGF("FLAC: Decoded %lu samples\n",(unsigned long)samplesdone);
     return CODEC_OK;
 }
+
+/* this is the codec entry point */
+enum codec_status codec_main(enum codec_entry_call_reason reason)
+{
+    if (reason == CODEC_LOAD) {
+        /* Generic codec initialisation */
+        ci->configure(DSP_SET_SAMPLE_DEPTH, FLAC_OUTPUT_DEPTH-1);
+    }
+
+    return CODEC_OK;
+}
+
+/* this is called for each file to process */
+enum codec_status codec_run(void)
+{
+    if (codec_init()) {
+        LOGF("FLAC: Error initialising codec\n");
+        return CODEC_ERROR;
+    }
+
+    stream.api = ci;
+    return flac_decode(&stream);
+}
+
+/* this is called for each stream decoded in a context of its own */
+static enum codec_status flac_ctx_run(struct codec_api *api, void *ctx)
+{
+    struct flac_ctx *c = ctx;
+    int i;
+
+    c->s.api = api;
+    c->s.fc = &c->fc;
+    for (i = 0; i < MAX_CHANNELS; i++)
+        c->s.decoded[i] = c->decoded[i];
+    c->s.seekpoints = c->seekpoints;
+
+    api->configure(DSP_SET_SAMPLE_DEPTH, FLAC_OUTPUT_DEPTH-1);
+
+    return flac_decode(&c->s);
+}
+
+const struct codec_context_ops codec_ctx_ops = {
+    sizeof(struct flac_ctx),
+    flac_ctx_run,
+};
@@ -43,6 +43,13 @@ int codec_init(void)
 }
 
 void codec_set_replaygain(const struct mp3entry *id3)
+{
+    codec_api_set_replaygain(ci, id3);
+}
+
+/* Same for a stream decoded through the context interface */
+void codec_api_set_replaygain(struct codec_api *api,
+                              const struct mp3entry *id3)
 {
     struct dsp_replay_gains gains =
     {
@@ -52,7 +59,7 @@ void codec_set_replaygain(const struct mp3entry *id3)
         .album_peak = id3->album_peak,
     };
 
-    ci->configure(REPLAYGAIN_SET_GAINS, (intptr_t)&gains);
+    api->configure(REPLAYGAIN_SET_GAINS, (intptr_t)&gains);
 }
 
 /* Various "helper functions" common to all the xxx2wav decoder plugins  */
@@ -158,6 +158,8 @@ static inline unsigned int bs_generic(unsigned int v, int mode)
 
 int codec_init(void);
 void codec_set_replaygain(const struct mp3entry *id3);
+void codec_api_set_replaygain(struct codec_api *api,
+                              const struct mp3entry *id3);
 
 #ifdef RB_PROFILE
 void __cyg_profile_func_enter(void *this_fn, void *call_site)
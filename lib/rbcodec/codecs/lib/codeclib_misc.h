@@ -128,6 +128,51 @@ static inline int32_t MULT31_SHIFT15(int32_t x, int32_t y) {
     (_y)=MULT32(_b,_t)-MULT32(_a,_v); }
 #endif
 
+/* On 64-bit hosts the full products are summed and shifted only once, which
+   is both cheaper and one bit more accurate than adding two MULT31s. The sum
+   cannot overflow since t and v are the sine and cosine of an angle. */
+#if defined(__LP64__) && !defined(_LOW_ACCURACY_)
+#ifndef INCL_OPTIMIZED_XPROD31
+#define INCL_OPTIMIZED_XPROD31
+static inline void XPROD31(int32_t a, int32_t b,
+                      int32_t t, int32_t v,
+                      int32_t *x, int32_t *y)
+{
+  *x = ((int64_t)a * t + (int64_t)b * v) >> 31;
+  *y = ((int64_t)b * t - (int64_t)a * v) >> 31;
+}
+#endif
+
+#ifndef INCL_OPTIMIZED_XNPROD31
+#define INCL_OPTIMIZED_XNPROD31
+static inline void XNPROD31(int32_t a, int32_t b,
+                       int32_t  t, int32_t  v,
+                       int32_t *x, int32_t *y)
+{
+  *x = ((int64_t)a * t - (int64_t)b * v) >> 31;
+  *y = ((int64_t)b * t + (int64_t)a * v) >> 31;
+}
+#endif
+
+#ifndef INCL_OPTIMIZED_XPROD31_R
+#define INCL_OPTIMIZED_XPROD31_R
+#define XPROD31_R(_a, _b, _t, _v, _x, _y)\
+{\
+  _x = ((int64_t)(_a) * (_t) + (int64_t)(_b) * (_v)) >> 31;\
+  _y = ((int64_t)(_b) * (_t) - (int64_t)(_a) * (_v)) >> 31;\
+}
+#endif
+
+#ifndef INCL_OPTIMIZED_XNPROD31_R
+#define INCL_OPTIMIZED_XNPROD31_R
+#define XNPROD31_R(_a, _b, _t, _v, _x, _y)\
+{\
+  _x = ((int64_t)(_a) * (_t) - (int64_t)(_b) * (_v)) >> 31;\
+  _y = ((int64_t)(_b) * (_t) + (int64_t)(_a) * (_v)) >> 31;\
+}
+#endif
+#endif /* __LP64__ */
+
 /* Rockbox: Unused */
 /*
 #ifdef __i386__
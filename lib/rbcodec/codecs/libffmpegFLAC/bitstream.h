@@ -41,6 +41,13 @@
 #define MAX_BLOCKSIZE 8192
 #endif
 
+/* 64-bit hosts (simulator, application and warble builds) decode most of
+   the residual through a 64-bit bit cache that is refilled with a single
+   load. None of the native targets is 64-bit. */
+#ifdef __LP64__
+#define FLAC_HOST_64BIT
+#endif
+
 /* Endian conversion routines for standalone compilation */
 #ifdef BUILD_STANDALONE
     #ifdef BUILD_BIGENDIAN
@@ -134,6 +134,63 @@ static int get_crc8(const uint8_t *buf, int count)
     return crc;
 }
 
+#ifdef FLAC_HOST_64BIT
+/* Decode up to n Rice codes with parameter k through a 64-bit bit cache that
+ * stays in a register and is only reloaded when the next code doesn't fit.
+ * Stops early at a code longer than the cache, a value that is out of range
+ * or near the end of the buffer, and returns the number of codes decoded;
+ * the generic reader deals with the rest. */
+static int decode_rice_64(GetBitContext *gb, int32_t *decoded, int n, int k)
+{
+    const uint8_t *buf = gb->buffer;
+    /* Last byte at which a whole 64-bit load is still inside the buffer */
+    const int last = (gb->size_in_bits >> 3) - 8;
+    unsigned int index = gb->index;
+    uint64_t cache = 0;
+    unsigned int bits = 0; /* Valid bits at the top of the cache */
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        unsigned int q, len;
+        uint64_t v;
+
+        /* The bits below the valid ones are zero, so a code that isn't
+           complete in the cache shows up as too long */
+        q = __builtin_clzll(cache | 1);
+        len = q + 1 + k;
+
+        if (len > bits)
+        {
+            if ((int)(index >> 3) > last)
+                break;
+
+            /* At least 57 valid bits */
+            cache = AV_RB64(buf + (index >> 3)) << (index & 7);
+            bits = 64 - (index & 7);
+            q = __builtin_clzll(cache | 1);
+            len = q + 1 + k;
+
+            if (len > bits)
+                break;
+        }
+
+        /* Shift in two steps so that k == 0 needs no special case */
+        v = ((uint64_t)q << k) | ((cache << q << 1) >> 1 >> (63 - k));
+        if (v > INT32_MAX)
+            break;
+
+        cache <<= len;
+        bits -= len;
+        index += len;
+        *decoded++ = (v >> 1) ^ -(v & 1);
+    }
+
+    gb->index = index;
+    return i;
+}
+#endif /* FLAC_HOST_64BIT */
+
 static int decode_residuals(FLACContext *s, int32_t* decoded, int pred_order) ICODE_ATTR_FLAC;
 static int decode_residuals(FLACContext *s, int32_t *decoded, int pred_order)
 {
@@ -161,10 +218,23 @@ static int decode_residuals(FLACContext *s, int32_t *decoded, int pred_order)
         tmp = get_bits(&gb, rice_bits);
         if (tmp == rice_esc) {
             tmp = get_bits(&gb, 5);
-            for (; i < samples; i++)
-                *decoded++ = get_sbits(&gb, tmp);
+            if (tmp == 0) {
+                for (; i < samples; i++)
+                    *decoded++ = 0;
+            } else if (tmp > MIN_CACHE_BITS) {
+                for (; i < samples; i++)
+                    *decoded++ = get_sbits_long(&gb, tmp);
+            } else {
+                for (; i < samples; i++)
+                    *decoded++ = get_sbits(&gb, tmp);
+            }
         } else {
             int real_limit = tmp ? (INT_MAX >> tmp) + 2 : INT_MAX;
+#ifdef FLAC_HOST_64BIT
+            int n = decode_rice_64(&gb, decoded, samples - i, tmp);
+            decoded += n;
+            i += n;
+#endif
             for (; i < samples; i++) {
                 int v = get_sr_golomb_flac(&gb, tmp, real_limit, 0);
                 if ((unsigned) v == 0x80000000){
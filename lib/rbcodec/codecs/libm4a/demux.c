@@ -367,11 +367,14 @@ static bool read_chunk_stsz(qtmovie_t *qtmovie, size_t chunk_len)
     size_remaining -= 4;
 
     /* Because this table can be really large and is only used to improve seek
-     * accuracy, it's optional. In that case the seek code will fall back to a
-     * less accurate seek method. */
+     * accuracy, it's optional. In that case the seek code will fall back to
+     * reading the sizes from the file. Samples are far smaller than 64kB in
+     * practice so only 16 bits of each size are kept, which lets tables twice
+     * as long fit. */
     qtmovie->res->num_sample_byte_sizes = numsizes;
-    if (numsizes * sizeof(uint32_t) < CODEC_SIZE * 1 / 2)
-        qtmovie->res->sample_byte_sizes = malloc(numsizes * sizeof(uint32_t));
+    qtmovie->res->sample_byte_sizes_offset = stream_tell(qtmovie->stream);
+    if (numsizes * sizeof(uint16_t) < CODEC_SIZE * 1 / 2)
+        qtmovie->res->sample_byte_sizes = malloc(numsizes * sizeof(uint16_t));
     else
         qtmovie->res->sample_byte_sizes = NULL;
 
@@ -379,22 +382,34 @@ static bool read_chunk_stsz(qtmovie_t *qtmovie, size_t chunk_len)
     {
         for (i = 0; i < numsizes; ++i)
         {
-            qtmovie->res->sample_byte_sizes[i] =
-                stream_read_uint32(qtmovie->stream);
+            uint32_t size = stream_read_uint32(qtmovie->stream);
             size_remaining -= 4;
+
+            if (size > UINT16_MAX)
+            {
+                /* Keep the remaining sizes in the file */
+                DEBUGF("stsz sample %u too large: %u\n", i, size);
+                free(qtmovie->res->sample_byte_sizes);
+                qtmovie->res->sample_byte_sizes = NULL;
+                break;
+            }
+
+            qtmovie->res->sample_byte_sizes[i] = size;
         }
 
-        if (size_remaining)
+        if (size_remaining && qtmovie->res->sample_byte_sizes)
         {
             DEBUGF("extra bytes after stsz\n");
         }
     }
     else
     {
-        qtmovie->res->sample_byte_sizes_offset = stream_tell(qtmovie->stream);
         DEBUGF("stsz too large: %u, save sample_byte_sizes_offset\n", numsizes);
     }
 
+    if (qtmovie->res->sample_byte_sizes)
+        qtmovie->res->sample_byte_sizes_offset = 0;
+
     if (size_remaining)
     {
         stream_skip(qtmovie->stream, size_remaining);
@@ -432,6 +447,40 @@ static void stream_read_sample_to_chunk(stream_t *stream, uint32_t *first_chunk,
     stream_skip(stream, 4);
 }
 
+/* Append the first sample of the next chunk of the lookup table to the
+ * run-length coded list */
+static bool add_chunk_run(demux_res_t *res, uint32_t max_runs,
+                          uint32_t chunk, uint32_t sample)
+{
+    chunk_run_t *run;
+
+    if (res->num_chunk_runs > 0)
+    {
+        run = &res->chunk_run[res->num_chunk_runs - 1];
+
+        /* The second chunk of a run sets its spacing */
+        if (chunk == run->first_chunk + 1 && sample >= run->first_sample)
+        {
+            run->chunk_samples = sample - run->first_sample;
+            return true;
+        }
+
+        if (sample == run->first_sample +
+                      (chunk - run->first_chunk) * run->chunk_samples)
+            return true;
+    }
+
+    if (res->num_chunk_runs >= max_runs)
+        return false;
+
+    run = &res->chunk_run[res->num_chunk_runs];
+    run->first_chunk = chunk;
+    run->first_sample = sample;
+    run->chunk_samples = 0;
+    res->num_chunk_runs++;
+    return true;
+}
+
 static bool read_chunk_stco(qtmovie_t *qtmovie, size_t chunk_len)
 {
     uint32_t i, k, old_i;
@@ -439,7 +488,9 @@ static bool read_chunk_stco(qtmovie_t *qtmovie, size_t chunk_len)
     uint32_t frame;
     uint32_t old_first = 0, new_first;
     uint32_t old_frame = 0, new_frame;
+    uint32_t max_runs;
     size_t size_remaining = chunk_len - 8;
+    demux_res_t *res = qtmovie->res;
 
     /* version + flags */
     stream_read_uint32(qtmovie->stream);
@@ -448,36 +499,44 @@ static bool read_chunk_stco(qtmovie_t *qtmovie, size_t chunk_len)
     numentries = stream_read_uint32(qtmovie->stream);
     size_remaining -= 4;
 
+    /* The first samples of the chunks are stored run-length coded. Within
+     * one entry of stsc the chunks are evenly spaced, so there are at most
+     * two runs per entry, even when only every n-th chunk is kept. */
     uint8_t accuracy_divider = 1;
     uint32_t fit_numentries = numentries;
     while (true)
     {
-        qtmovie->res->lookup_table = malloc(fit_numentries * sizeof(*qtmovie->res->lookup_table));
+        max_runs = MIN(fit_numentries, 2*res->num_sample_to_chunks + 1);
+        res->chunk_offset = malloc(fit_numentries * sizeof(uint32_t) +
+                                   max_runs * sizeof(chunk_run_t));
 
-        if (qtmovie->res->lookup_table || (++accuracy_divider == 0))
+        if (res->chunk_offset || (++accuracy_divider == 0))
         {
             break;
         }
         else
         {
             // we failed to alloc memory for lookup table, so reduce seek accuracy and try again
-            fit_numentries = numentries / accuracy_divider;
+            fit_numentries = (numentries + accuracy_divider - 1) / accuracy_divider;
         }
     }
     DEBUGF("lookup_table numentries %d, fit_numentries %d\n", numentries, fit_numentries);
-    qtmovie->res->num_lookup_table = fit_numentries;
+    res->num_lookup_table = fit_numentries;
+    res->num_chunk_runs = 0;
 
-    if (!qtmovie->res->lookup_table)
+    if (!res->chunk_offset)
     {
         DEBUGF("stco too large to allocate lookup_table[]\n");
         return false;
     }
 
+    res->chunk_run = (chunk_run_t *)&res->chunk_offset[fit_numentries];
+
     // Reading sample_byte_sizes data on seek can lead to additional re-buffering.
     // So skip it if we have good enough seek accuracy via lookup_table (3000 ms)
-    if (qtmovie->res->sample_byte_sizes_offset && ci->id3->length / fit_numentries <= 3000)
+    if (res->sample_byte_sizes_offset && ci->id3->length / fit_numentries <= 3000)
     {
-        qtmovie->res->sample_byte_sizes_offset = 0;
+        res->sample_byte_sizes_offset = 0;
         DEBUGF("lookup_table seek accuracy %ld ms, ignoring sample_byte_sizes_offset \n", ci->id3->length / fit_numentries);
     }
 
@@ -493,11 +552,15 @@ static bool read_chunk_stco(qtmovie_t *qtmovie, size_t chunk_len)
      * table. This reduces the memory consumption by a factor of 2 or even 
      * more. */
     uint32_t idx = 0;
+    res->chunk_offset_sorted = true;
     for (i = 0; i < numentries; ++i)
     {
         if (i % accuracy_divider == 0)
         {
-            qtmovie->res->lookup_table[idx++].offset = stream_read_uint32(qtmovie->stream);
+            res->chunk_offset[idx] = stream_read_uint32(qtmovie->stream);
+            if (idx > 0 && res->chunk_offset[idx] < res->chunk_offset[idx-1])
+                res->chunk_offset_sorted = false;
+            idx++;
         }
         else
         {
@@ -512,18 +575,18 @@ static bool read_chunk_stco(qtmovie_t *qtmovie, size_t chunk_len)
     frame = 0;
 
     int32_t current_offset = stream_tell(qtmovie->stream);
-    stream_seek(qtmovie->stream, qtmovie->res->sample_to_chunk_offset);
+    stream_seek(qtmovie->stream, res->sample_to_chunk_offset);
     stream_read_sample_to_chunk(qtmovie->stream, &new_first, &new_frame);
     for (k = 1; k <= numentries; ++k)
     {
-        for (; i <= qtmovie->res->num_sample_to_chunks; ++i)
+        for (; i <= res->num_sample_to_chunks; ++i)
         {
             if (i > old_i)
             {
                 /* Only access sample_to_chunk[] if new data is required. */
                 old_first = new_first;
                 old_frame = new_frame;
-                if (i < qtmovie->res->num_sample_to_chunks)
+                if (i < res->num_sample_to_chunks)
                     stream_read_sample_to_chunk(qtmovie->stream, &new_first, &new_frame);
                 old_i = i;
             }
@@ -536,14 +599,14 @@ static bool read_chunk_stco(qtmovie_t *qtmovie, size_t chunk_len)
 
         if ((k-1) % accuracy_divider == 0)
         {
-            qtmovie->res->lookup_table[idx++].sample = frame + (k - old_first) * old_frame;
+            if (!add_chunk_run(res, max_runs, idx++,
+                               frame + (k - old_first) * old_frame))
+            {
+                DEBUGF("stsc doesn't match stco\n");
+                return false;
+            }
         }
     }
-    /* zero-terminate sample if it wasn't calculated */
-    if (idx < fit_numentries)
-    {
-        qtmovie->res->lookup_table[idx].sample = 0;
-    }
 
     stream_seek(qtmovie->stream, current_offset);
     if (size_remaining)
@@ -112,6 +112,90 @@ void stream_create(stream_t *stream,struct codec_api* ci)
     stream->eof=0;
 }
 
+/* Return the first sample of a chunk of the lookup table */
+static uint32_t get_chunk_sample(const demux_res_t *demux_res, uint32_t chunk)
+{
+    const chunk_run_t *run = demux_res->chunk_run;
+    uint32_t lo = 0, hi = demux_res->num_chunk_runs;
+
+    /* Find the last run starting at or before the chunk */
+    while (hi - lo > 1)
+    {
+        uint32_t mid = (lo + hi) / 2;
+
+        if (run[mid].first_chunk <= chunk)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    run += lo;
+    return run->first_sample + (chunk - run->first_chunk) * run->chunk_samples;
+}
+
+/* Return the last chunk of the lookup table that starts at or before the
+ * given sample */
+static uint32_t find_sample_chunk(const demux_res_t *demux_res, uint32_t sample)
+{
+    const chunk_run_t *run = demux_res->chunk_run;
+    uint32_t lo = 0, hi = demux_res->num_chunk_runs;
+    uint32_t end;
+
+    while (hi - lo > 1)
+    {
+        uint32_t mid = (lo + hi) / 2;
+
+        if (run[mid].first_sample <= sample)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    end = (hi < demux_res->num_chunk_runs) ?
+            run[hi].first_chunk : demux_res->num_lookup_table;
+    run += lo;
+
+    if (sample < run->first_sample)
+        return run->first_chunk;
+
+    if (run->chunk_samples == 0)
+        return end - 1;
+
+    return MIN(run->first_chunk + (sample - run->first_sample) / run->chunk_samples,
+               end - 1);
+}
+
+/* Return the last chunk of the lookup table that starts at or before the
+ * given file position */
+static uint32_t find_offset_chunk(const demux_res_t *demux_res, uint32_t file_loc)
+{
+    const uint32_t *offset = demux_res->chunk_offset;
+    uint32_t lo = 0, hi = demux_res->num_lookup_table;
+
+    if (!demux_res->chunk_offset_sorted)
+    {
+        /* Chunks out of order - take the first that fits */
+        for (hi = 1; hi < demux_res->num_lookup_table; ++hi)
+        {
+            if (offset[hi] > file_loc)
+                break;
+        }
+        return hi - 1;
+    }
+
+    while (hi - lo > 1)
+    {
+        uint32_t mid = (lo + hi) / 2;
+
+        if (offset[mid] <= file_loc)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
 /* Check if there is a dedicated byte position contained for the given frame.
  * Return this byte position in case of success or return -1. This allows to
  * skip empty samples.
@@ -124,13 +208,15 @@ int m4a_check_sample_offset(demux_res_t *demux_res, uint32_t frame, uint32_t *st
     uint32_t i = *start;
     for (;i < demux_res->num_lookup_table; ++i)
     {
-        if (demux_res->lookup_table[i].sample > frame)
+        uint32_t sample = get_chunk_sample(demux_res, i);
+
+        if (sample > frame)
             break;
 
-        if (demux_res->lookup_table[i].sample == frame)
+        if (sample == frame)
         {
             *start = i;
-            return demux_res->lookup_table[i].offset;
+            return demux_res->chunk_offset[i];
         }
     }
     *start = i;
@@ -149,11 +235,11 @@ unsigned int m4a_seek(demux_res_t* demux_res, stream_t* stream,
     uint32_t offset;
     uint64_t sound_sample_i;
     time_to_sample_t *tts_tab = demux_res->time_to_sample;
-    sample_offset_t *tco_tab = demux_res->lookup_table;
-    uint32_t *tsz_tab = demux_res->sample_byte_sizes;
+    uint16_t *tsz_tab = demux_res->sample_byte_sizes;
 
     /* First check we have the required metadata - we should always have it. */
-    if (!demux_res->num_time_to_samples || !demux_res->num_sample_byte_sizes)
+    if (!demux_res->num_time_to_samples || !demux_res->num_sample_byte_sizes ||
+        !demux_res->num_lookup_table)
     {
         return 0;
     }
@@ -178,18 +264,11 @@ unsigned int m4a_seek(demux_res_t* demux_res, stream_t* stream,
         sound_sample_i += time_var;
     }
 
-    /* Find the chunk after 'sample_i'. */
-    for (chunk = 1; chunk < demux_res->num_lookup_table; ++chunk)
-    {
-        if (tco_tab[chunk].sample > sample_i)
-            break;
-    }
-
-    /* The preceding chunk is the one that contains 'sample_i'. */
-    chunk--;
+    /* Find the chunk that contains 'sample_i'. */
+    chunk = find_sample_chunk(demux_res, sample_i);
     *lookup_table_idx = chunk;
-    chunk_first_sample = tco_tab[chunk].sample;
-    offset = tco_tab[chunk].offset;
+    chunk_first_sample = get_chunk_sample(demux_res, chunk);
+    offset = demux_res->chunk_offset[chunk];
 
     /* Compute the PCM sample number of the chunk's first sample
      * to get an accurate base for sound_sample_i. */
@@ -283,17 +362,15 @@ unsigned int m4a_seek_raw(demux_res_t* demux_res, stream_t* stream,
     uint32_t tmp_cnt;
     uint32_t new_pos;
 
+    if (!demux_res->num_lookup_table)
+        return 0;
+
     /* We know the desired byte offset, search for the chunk right before.
      * Return the associated sample to this chunk as chunk_sample. */
-    for (i = 1; i < demux_res->num_lookup_table; ++i)
-    {
-        if (demux_res->lookup_table[i].offset > file_loc)
-            break;
-    }
-    --i; /* We want the last chunk _before_ file_loc. */
+    i = find_offset_chunk(demux_res, file_loc);
     *lookup_table_idx = i;
-    chunk_sample = demux_res->lookup_table[i].sample;
-    new_pos      = demux_res->lookup_table[i].offset;
+    chunk_sample = get_chunk_sample(demux_res, i);
+    new_pos      = demux_res->chunk_offset[i];
 
     /* Get sound sample offset. */
     i = 0;
@@ -57,11 +57,14 @@ typedef struct
     uint32_t sample_duration;
 } time_to_sample_t;
 
+/* Run of chunks whose first samples are evenly spaced. The run lasts up to
+   the first chunk of the next one. */
 typedef struct
 {
-    uint32_t sample;
-    uint32_t offset;
-} sample_offset_t;
+    uint32_t first_chunk;   /* Index into chunk_offset[] */
+    uint32_t first_sample;  /* First sample of that chunk */
+    uint32_t chunk_samples; /* Samples per chunk within the run */
+} chunk_run_t;
 
 typedef struct
 {
@@ -74,13 +77,18 @@ typedef struct
     int32_t sample_to_chunk_offset;
     uint32_t num_sample_to_chunks;
 
-    sample_offset_t *lookup_table;
+    /* Lookup table: file offset and first sample of every chunk (or of
+       every n-th chunk when memory is short) */
+    uint32_t *chunk_offset;
+    chunk_run_t *chunk_run;
     uint32_t num_lookup_table;
+    uint32_t num_chunk_runs;
+    bool chunk_offset_sorted;
 
     time_to_sample_t *time_to_sample;
     uint32_t num_time_to_samples;
 
-    uint32_t *sample_byte_sizes;
+    uint16_t *sample_byte_sizes;
     uint32_t num_sample_byte_sizes;
     int32_t sample_byte_sizes_offset;
 
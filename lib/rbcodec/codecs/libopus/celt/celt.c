@@ -95,7 +95,7 @@ int resampling_factor(opus_int32 rate)
 #ifndef NON_STATIC_COMB_FILTER_CONST_C
 static
 #endif
-void comb_filter_const_c(opus_val32 *y, opus_val32 *x, int T, int N,
+void ICODE_ATTR_OPUS_LARGE_IRAM comb_filter_const_c(opus_val32 *y, opus_val32 *x, int T, int N,
       opus_val16 g10, opus_val16 g11, opus_val16 g12)
 {
    opus_val32 x0, x1, x2, x3, x4;
@@ -159,7 +159,7 @@ void comb_filter_const_c(opus_val32 *y, opus_val32 *x, int T, int N,
 #ifndef NON_STATIC_COMB_FILTER_CONST_C
 static
 #endif
-void comb_filter_const_c(opus_val32 *y, opus_val32 *x, int T, int N,
+void ICODE_ATTR_OPUS_LARGE_IRAM comb_filter_const_c(opus_val32 *y, opus_val32 *x, int T, int N,
       opus_val16 g10, opus_val16 g11, opus_val16 g12)
 {
    opus_val32 x0, x1, x2, x3, x4;
@@ -460,7 +460,7 @@ void encode_pulses(const int *_y,int _n,int _k,ec_enc *_enc){
   ec_enc_uint(_enc,icwrs(_n,_y),CELT_PVQ_V(_n,_k));
 }
 
-static opus_val32 cwrsi(int _n,int _k,opus_uint32 _i,int *_y){
+static opus_val32 ICODE_ATTR_OPUS_LARGE_IRAM cwrsi(int _n,int _k,opus_uint32 _i,int *_y){
   opus_uint32 p;
   int         s;
   int         k0;
@@ -45,7 +45,7 @@
    complex numbers.  It also delares the kf_ internal functions.
 */
 
-static void kf_bfly2(
+static void ICODE_ATTR_OPUS_LARGE_IRAM kf_bfly2(
                      kiss_fft_cpx * Fout,
                      int m,
                      int N
@@ -101,7 +101,7 @@ static void kf_bfly2(
    }
 }
 
-static void kf_bfly4(
+static void ICODE_ATTR_OPUS_LARGE_IRAM kf_bfly4(
                      kiss_fft_cpx * Fout,
                      const size_t fstride,
                      const kiss_fft_state *st,
@@ -173,7 +173,7 @@ static void kf_bfly4(
 
 #ifndef RADIX_TWO_ONLY
 
-static void kf_bfly3(
+static void ICODE_ATTR_OPUS_LARGE_IRAM kf_bfly3(
                      kiss_fft_cpx * Fout,
                      const size_t fstride,
                      const kiss_fft_state *st,
@@ -232,7 +232,7 @@ static void kf_bfly3(
 
 
 #ifndef OVERRIDE_kf_bfly5
-static void kf_bfly5(
+static void ICODE_ATTR_OPUS_LARGE_IRAM kf_bfly5(
                      kiss_fft_cpx * Fout,
                      const size_t fstride,
                      const kiss_fft_state *st,
@@ -518,7 +518,7 @@ void opus_fft_free(const kiss_fft_state *cfg, int arch)
 
 #endif /* CUSTOM_MODES */
 
-void opus_fft_impl(const kiss_fft_state *st,kiss_fft_cpx *fout)
+void ICODE_ATTR_OPUS_LARGE_IRAM opus_fft_impl(const kiss_fft_state *st,kiss_fft_cpx *fout)
 {
     int m2, m;
     int p;
@@ -40,7 +40,7 @@
 #include "pitch.h"
 
 #ifndef OVERRIDE_vq_exp_rotation1
-static void exp_rotation1(celt_norm *X, int len, int stride, opus_val16 c, opus_val16 s)
+static void ICODE_ATTR_OPUS_LARGE_IRAM exp_rotation1(celt_norm *X, int len, int stride, opus_val16 c, opus_val16 s)
 {
    int i;
    opus_val16 ms;
@@ -47,11 +47,26 @@
 #elif ARM_ARCH > 4
 #define OPUS_ARM_INLINE_EDSP
 #endif
+#if ARM_ARCH >= 6
+#define OPUS_ARM_INLINE_MEDIA
+#endif
 #endif
 
 #if defined(CPU_COLDFIRE)
 #define OPUS_CF_INLINE_ASM
 #endif
 
+/* IRAM usage. The FFT, the pitch postfilter, the spreading rotation and the
+   PVQ codeword decoder take most of the time in CELT frames. */
+#if (CONFIG_CPU == PP5022) || (CONFIG_CPU == PP5024) || \
+    (CONFIG_CPU == S5L8700) || (CONFIG_CPU == S5L8701) || \
+    (CONFIG_CPU == S5L8702)
+/* Enough IRAM to move the hot CELT kernels to it. */
+#define ICODE_ATTR_OPUS_LARGE_IRAM ICODE_ATTR
+#else
+/* Not enough IRAM available next to the decoder state. */
+#define ICODE_ATTR_OPUS_LARGE_IRAM
+#endif
+
 #endif /* CONFIG_H */
 
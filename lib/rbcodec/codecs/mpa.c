@@ -57,6 +57,16 @@ static unsigned char mad_main_data[MAD_BUFFER_MDLEN] IBSS_ATTR;
 static int mpeg_latency[3] = { 0, 481, 529 };
 static int mpeg_framesize[3] = {384, 1152, 1152};
 
+/* VBR files without a TOC get a seek index built while they are decoded
+   from the start, with one point about every second */
+static bool index_exact;            /* samplesdone is exact, add points */
+static int64_t index_next;          /* samplesdone of the next point */
+
+static inline bool use_seek_index(void)
+{
+    return ci->id3->vbr && !ci->id3->has_toc && !ci->id3->is_asf_stream;
+}
+
 static unsigned char stream_buffer[INPUT_CHUNK_SIZE] IBSS_ATTR;
 static unsigned char *stream_data_start;
 static unsigned char *stream_data_end;
@@ -173,6 +183,7 @@ static void init_mad(void)
 static int get_file_pos(int newtime)
 {
     int pos = -1;
+    bool indexed = false;
     struct mp3entry *id3 = ci->id3;
 
     if (id3->vbr) {
@@ -197,14 +208,27 @@ static int get_file_pos(int newtime)
 
                 pos = cur_toc * toc_sizestep + (uint64_t) plength * skipms_from_toc / pct_timestep;
             }
-        } else if (newtime < abs(skipms_from_curpos)) {
-            /* No TOC exists, estimate the new position */
-            pos = (uint64_t)newtime * id3->filesize / id3->length;
+        } else {
+            /* No TOC exists, interpolate between the closest points of the
+               seek index if there are any */
+            struct seek_point lo = { 0, id3->first_frame_offset };
+            struct seek_point hi = { id3->length,
+                                     id3->first_frame_offset + id3->filesize };
+
+            if (ci->seek_index_find(newtime, &lo, &hi) && hi.time > lo.time) {
+                pos = lo.pos - id3->first_frame_offset +
+                      (uint64_t)(hi.pos - lo.pos) * (newtime - lo.time) /
+                      (hi.time - lo.time);
+                indexed = true;
+            } else if (newtime < abs(skipms_from_curpos)) {
+                /* Nothing indexed, estimate the new position */
+                pos = (uint64_t)newtime * id3->filesize / id3->length;
+            }
         }
         // VBR seek might be very inaccurate in long files 
         // So make sure that seeking actually happened in the intended direction 
         // Fix jumps in the wrong direction by seeking relative to the current position
-        if (pos == -1 || (skipms_from_curpos >= 0 && pos > curpos) || (skipms_from_curpos < 0 && pos < curpos))
+        if (pos == -1 || (!indexed && ((skipms_from_curpos >= 0 && pos > curpos) || (skipms_from_curpos < 0 && pos < curpos))))
         {
             pos = curpos - skipms_from_curpos * (id3->filesize / id3->length);
             //LOGF("curpos relative seek: %d, curpos: %d, newtime: %d", pos, curpos, newtime);
@@ -417,6 +441,10 @@ bool seek_by_time(int64_t* samplesdone, unsigned long current_frequency, unsigne
 
         *samplesdone = ((int64_t)elapsed_ms) * current_frequency / 1000;
 
+        /* The time of frames is only known when starting over */
+        index_exact = use_seek_index() && elapsed_ms == 0;
+        index_next = 0;
+
         if (!ci->seek_buffer(newpos))
             return false;
 
@@ -483,6 +511,9 @@ enum codec_status codec_run(void)
     else
         ci->seek_buffer(ci->id3->first_frame_offset);
 
+    index_exact = use_seek_index() && !ci->id3->offset && !ci->id3->elapsed;
+    index_next = 0;
+
     if (ci->id3->lead_trim >= 0 && ci->id3->tail_trim >= 0) {
         stop_skip = ci->id3->tail_trim - mpeg_latency[ci->id3->layer];
         if (stop_skip < 0) stop_skip = 0;
@@ -621,6 +652,12 @@ enum codec_status codec_run(void)
             }
         }
 
+        if (index_exact && samplesdone >= index_next) {
+            ci->seek_index_add(samplesdone * 1000 / current_frequency,
+                               ci->curpos + (stream.this_frame - stream.buffer));
+            index_next = samplesdone + current_frequency;
+        }
+
         if (stream.next_frame)
             advance_stream_buffer(stream.next_frame - stream.buffer);
         else
@@ -98,8 +98,13 @@ static void afr_reduce_process(struct dsp_proc_entry *this,
     struct dsp_buffer *buf = *buf_p;
 
     for (int i = 0; i < 4; i++)
+#ifdef HAVE_DSP_FLOAT
+        filter_process_float(&afr_filters[i], buf->pf32, buf->remcount,
+                             buf->format.num_channels);
+#else
         filter_process(&afr_filters[i], buf->p32, buf->remcount,
                        buf->format.num_channels);
+#endif
 
     (void)this;
 }
@@ -119,6 +124,9 @@ static intptr_t afr_configure(struct dsp_proc_entry *this,
         {
             /* Coming online; was disabled */
             this->process = afr_reduce_process;
+#ifdef HAVE_DSP_FLOAT
+            dsp_proc_set_float(dsp, DSP_PROC_AFR, true);
+#endif
             dsp_afr_flush();
             dsp_proc_activate(dsp, DSP_PROC_AFR, true);
         }
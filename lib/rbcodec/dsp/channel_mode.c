@@ -131,6 +131,68 @@ void channel_mode_proc_karaoke(struct dsp_proc_entry *this,
 }
 #endif /* CPU */
 
+#ifdef HAVE_DSP_FLOAT
+/* Float routines - mono_left and mono_right just copy and serve for both */
+static void channel_mode_proc_mono_float(struct dsp_proc_entry *this,
+                                         struct dsp_buffer **buf_p)
+{
+    struct dsp_buffer *buf = *buf_p;
+    float *sl = buf->pf32[0];
+    float *sr = buf->pf32[1];
+    int count = buf->remcount;
+
+    for (int i = 0; i < count; i++)
+    {
+        float lr = (sl[i] + sr[i]) * 0.5f;
+        sl[i] = lr;
+        sr[i] = lr;
+    }
+
+    (void)this;
+}
+
+static void channel_mode_proc_custom_float(struct dsp_proc_entry *this,
+                                           struct dsp_buffer **buf_p)
+{
+    struct channel_mode_data *data = (void *)this->data;
+    struct dsp_buffer *buf = *buf_p;
+
+    float *sl = buf->pf32[0];
+    float *sr = buf->pf32[1];
+    int count = buf->remcount;
+
+    /* s0.31 -> float */
+    const float gain  = data->sw_gain * (1.0f / 2147483648.0f);
+    const float cross = data->sw_cross * (1.0f / 2147483648.0f);
+
+    for (int i = 0; i < count; i++)
+    {
+        float l = sl[i];
+        float r = sr[i];
+        sl[i] = l * gain + r * cross;
+        sr[i] = r * gain + l * cross;
+    }
+}
+
+static void channel_mode_proc_karaoke_float(struct dsp_proc_entry *this,
+                                            struct dsp_buffer **buf_p)
+{
+    struct dsp_buffer *buf = *buf_p;
+    float *sl = buf->pf32[0];
+    float *sr = buf->pf32[1];
+    int count = buf->remcount;
+
+    for (int i = 0; i < count; i++)
+    {
+        float ch = (sl[i] - sr[i]) * 0.5f;
+        sl[i] = ch;
+        sr[i] = -ch;
+    }
+
+    (void)this;
+}
+#endif /* HAVE_DSP_FLOAT */
+
 void channel_mode_proc_mono_left(struct dsp_proc_entry *this,
                                  struct dsp_buffer **buf_p)
 {
@@ -189,11 +251,20 @@ static void update_process_fn(struct dsp_proc_entry *this)
     static const dsp_proc_fn_type fns[SOUND_CHAN_NUM_MODES] =
     {
         [SOUND_CHAN_STEREO]     = NULL,
+#ifdef HAVE_DSP_FLOAT
+        [SOUND_CHAN_MONO]       = channel_mode_proc_mono_float,
+        [SOUND_CHAN_CUSTOM]     = channel_mode_proc_custom_float,
+#else
         [SOUND_CHAN_MONO]       = channel_mode_proc_mono,
         [SOUND_CHAN_CUSTOM]     = channel_mode_proc_custom,
+#endif
         [SOUND_CHAN_MONO_LEFT]  = channel_mode_proc_mono_left,
         [SOUND_CHAN_MONO_RIGHT] = channel_mode_proc_mono_right,
+#ifdef HAVE_DSP_FLOAT
+        [SOUND_CHAN_KARAOKE]    = channel_mode_proc_karaoke_float,
+#else
         [SOUND_CHAN_KARAOKE]    = channel_mode_proc_karaoke,
+#endif
     };
 
     this->process = fns[((struct channel_mode_data *)this->data)->mode];
@@ -231,7 +302,12 @@ static intptr_t channel_mode_configure(struct dsp_proc_entry *this,
     {
     case DSP_PROC_INIT:
         if (value == 0)
+        {
             this->data = (intptr_t)&channel_mode_data;
+#ifdef HAVE_DSP_FLOAT
+            dsp_proc_set_float(dsp, DSP_PROC_CHANNEL_MODE, true);
+#endif
+        }
 
         update_process_fn(this);
         break;
@@ -66,6 +66,12 @@ static int32_t hpfx1 IBSS_ATTR;             /* hpf1 and hpf2 x[n-1] */
 static int32_t hp1y1 IBSS_ATTR;             /* hpf2 y[n-1]  */
 static int32_t hp2y1 IBSS_ATTR;             /* hpf2 y[n-1]  */
 
+#ifdef HAVE_DSP_FLOAT
+/* Float state - coefficients and the curve are shared with the above */
+static float release_gain_f;                /* Linear gain */
+static float hpfx1_f, hp1y1_f, hp2y1_f;     /* Pre-emphasis filter state */
+#endif
+
 /* Delay Line for look-ahead compression */
 static int labuf_handle = -1;
 //static int32_t labuf[MAX_CH][MAX_DLY];      /* look-ahead buffer */
@@ -398,21 +404,8 @@ static bool compressor_update(struct dsp_config *dsp,
  *  Returns the required gain factor in S7.24 format in order to compress the
  *  sample in accordance with the compression curve.  Always 1 or less.
  */
-static inline int32_t get_compression_gain(struct sample_format *format,
-                                           int32_t sample)
+static inline int32_t get_compression_gain15(int32_t sample)
 {
-    const int frac_bits_offset = format->frac_bits - 15;
-
-    /* sample must be positive */
-    if (sample < 0)
-        sample = -(sample + 1);
-
-    /* shift sample into 15 frac bit range */
-    if (frac_bits_offset > 0)
-        sample >>= frac_bits_offset;
-    if (frac_bits_offset < 0)
-        sample <<= -frac_bits_offset;
-
     /* normal case: sample isn't clipped */
     if (sample < (1 << 15))
     {
@@ -441,6 +434,24 @@ static inline int32_t get_compression_gain(struct sample_format *format,
     return -1;
 }
 
+static inline int32_t get_compression_gain(struct sample_format *format,
+                                           int32_t sample)
+{
+    const int frac_bits_offset = format->frac_bits - 15;
+
+    /* sample must be positive */
+    if (sample < 0)
+        sample = -(sample + 1);
+
+    /* shift sample into 15 frac bit range */
+    if (frac_bits_offset > 0)
+        sample >>= frac_bits_offset;
+    if (frac_bits_offset < 0)
+        sample <<= -frac_bits_offset;
+
+    return get_compression_gain15(sample);
+}
+
 /** DSP interface **/
 
 /** SET COMPRESSOR
@@ -458,6 +469,115 @@ void dsp_set_compressor(const struct compressor_settings *settings)
 /** COMPRESSOR PROCESS
  *  Changes the gain of the samples according to the compressor curve
  */
+#ifdef HAVE_DSP_FLOAT
+static void compressor_process(struct dsp_proc_entry *this,
+                               struct dsp_buffer **buf_p)
+{
+    struct dsp_buffer *buf = *buf_p;
+    int count = buf->remcount;
+    float *in_buf[2] = { buf->pf32[0], buf->pf32[1] };
+    const int num_chan = MIN(buf->format.num_channels, MAX_CH);
+    float (*labufp)[MAX_CH][MAX_DLY] = core_get_data(labuf_handle);
+
+    /* S7.24 -> float */
+    const float unity = 1.0f / UNITY;
+    const float att_a = attca * unity, att_b = attcb * unity;
+    const float rls_a = rlsca * unity, rls_b = rlscb * unity;
+    const float hp1_a = hp1ca * unity, hp2_a = hp2ca * unity;
+    const float limit_a = limitca * unity;
+    const float makeup_gain = comp_makeup_gain * unity;
+    /* Match the fixed-point limiter trigger level for this format */
+    const float limit_level = (float)(1ull << 28) / (1ull << buf->format.frac_bits);
+    const float chan_scale = 1.0f / (1 << (num_chan >> 1));
+
+    while (count-- > 0)
+    {
+        /* Use the average of the channels */
+        float x = 0.0f;
+        float in_buf_max_level = 0.0f;
+        for (int ch = 0; ch < num_chan; ch++)
+        {
+            float tmpx = *in_buf[ch];
+            x += tmpx;
+            (*labufp)[ch][delay_write] = tmpx;
+            /* Limiter detection */
+            if (tmpx < 0.0f) tmpx = -tmpx;
+            if (tmpx > in_buf_max_level) in_buf_max_level = tmpx;
+        }
+
+        x *= chan_scale;
+
+        /* 1p HP Filters: y[n] = a*(y[n-1] + x - x[n-1]) */
+        hp1y1_f = hp1_a * (x - hpfx1_f + hp1y1_f);
+        hp2y1_f = hp2_a * (x - hpfx1_f + hp2y1_f);
+        hpfx1_f = x;
+
+        /* Apply weighted sum to the pre-emphasis network */
+        float level = (0.5f*x + hp1y1_f + 2.0f*hp2y1_f) * 0.75f;
+        if (level < 0.0f)
+            level = -level;
+
+        /* Look up the gain with the sidechain level at 15 fractional bits */
+        level *= 32768.0f;
+        int32_t sample_gain15 = get_compression_gain15(
+                level < (float)(1 << 17) ? (int32_t)level : (1 << 17));
+        float sample_gain = sample_gain15 * unity;
+
+        /* Exponential Attack and Release */
+        if ((sample_gain <= release_gain_f) && (sample_gain15 > 0))
+        {
+            /* Attack */
+            if (attca != UNITY)
+                release_gain_f = release_gain_f * att_b + sample_gain * att_a;
+            else
+                release_gain_f = sample_gain;
+
+            /** reset it to delay time so it cannot release before the
+             *  delayed signal releases
+             */
+            release_holdoff = delay_time;
+        }
+        /* Reverse exponential decay to current gain value */
+        else if (release_holdoff > 0)
+        {
+            /* Don't start release while output is still above thresh */
+            release_holdoff--;
+        }
+        else
+        {
+            /* Release */
+            release_gain_f = release_gain_f * rls_b + sample_gain * rls_a;
+        }
+
+        /** total gain factor is the product of release gain and makeup gain */
+        float total_gain = release_gain_f * makeup_gain;
+
+        /* Look-ahead limiter */
+        if (total_gain * in_buf_max_level > limit_level)
+            release_gain_f -= limit_a;
+
+        /** Implement the compressor: apply total gain factor (if any) to the
+         *  output buffer sample pair/mono sample
+         */
+        if (total_gain != 1.0f)
+        {
+            for (int ch = 0; ch < num_chan; ch++)
+                *in_buf[ch] = total_gain * (*labufp)[ch][delay_read];
+        }
+        in_buf[0]++;
+        in_buf[1]++;
+        delay_write++;
+        delay_read++;
+        if(delay_write >= MAX_DLY) delay_write = 0;
+        if(delay_read >= MAX_DLY) delay_read = 0;
+    }
+
+    hp1y1_f = dsp_float_flush_tiny(hp1y1_f);
+    hp2y1_f = dsp_float_flush_tiny(hp2y1_f);
+
+    (void)this;
+}
+#else /* !HAVE_DSP_FLOAT */
 static void compressor_process(struct dsp_proc_entry *this,
                                struct dsp_buffer **buf_p)
 {
@@ -582,6 +702,7 @@ static void compressor_process(struct dsp_proc_entry *this,
 
     (void)this;
 }
+#endif /* HAVE_DSP_FLOAT */
 
 /* DSP message hook */
 static intptr_t compressor_configure(struct dsp_proc_entry *this,
@@ -598,6 +719,9 @@ static intptr_t compressor_configure(struct dsp_proc_entry *this,
             break; /* Already enabled */
 
         this->process = compressor_process;
+#ifdef HAVE_DSP_FLOAT
+        dsp_proc_set_float(dsp, DSP_PROC_COMPRESSOR, true);
+#endif
         /* Won't have been getting frequency updates */
         compressor_update(dsp, &curr_set);
         /* Fall-through */
@@ -606,6 +730,9 @@ static intptr_t compressor_configure(struct dsp_proc_entry *this,
     {
         int32_t (*labufp)[MAX_CH][MAX_DLY] = core_get_data(labuf_handle);
         release_gain = UNITY;
+#ifdef HAVE_DSP_FLOAT
+        release_gain_f = 1.0f;
+#endif
         for(i=0; i<MAX_CH; i++)
         {
             for(j=0; j<MAX_DLY; j++)
@@ -35,7 +35,12 @@ void crossfeed_process(struct dsp_proc_entry *this,
                        struct dsp_buffer **buf_p);
 void crossfeed_meier_process(struct dsp_proc_entry *this,
                              struct dsp_buffer **buf_p);
-
+#ifdef HAVE_DSP_FLOAT
+static void crossfeed_process_float(struct dsp_proc_entry *this,
+                                    struct dsp_buffer **buf_p);
+static void crossfeed_meier_process_float(struct dsp_proc_entry *this,
+                                          struct dsp_buffer **buf_p);
+#endif
 
 /**
  * Applies crossfeed to the stereo signal.
@@ -74,6 +79,21 @@ static struct crossfeed_state
     };
 } crossfeed_state IBSS_ATTR;
 
+#ifdef HAVE_DSP_FLOAT
+/* Sample state for the float versions - coefficients and gain are taken
+   from crossfeed_state */
+static struct crossfeed_float_state
+{
+    float vcl;          /* Meier: Left filter output */
+    float vcr;          /* Meier: Right filter output */
+    float vdiff;        /* Meier: L-R difference signal */
+    float history[4];   /* Custom: x[n - 1], y[n - 1] (L + R) */
+    float *index;       /* Custom: Current pointer into the delay line */
+    float *index_max;   /* Custom: Current max pointer of delay line */
+    float delay[DELAY_LEN(DSP_OUT_MAX_HZ)]; /* Custom: Delay line buffer */
+} crossfeed_float_state IBSS_ATTR;
+#endif
+
 static int crossfeed_type = CROSSFEED_TYPE_NONE;
 /* Cached custom settings */
 static long crossfeed_lf_gain;
@@ -95,6 +115,14 @@ static void crossfeed_flush(struct dsp_proc_entry *this)
         memset(state->delay, 0, sizeof (state->delay));
         state->index = state->delay;
     }
+
+#ifdef HAVE_DSP_FLOAT
+    struct crossfeed_float_state *fstate = &crossfeed_float_state;
+    fstate->vcl = fstate->vcr = fstate->vdiff = 0.0f;
+    memset(fstate->history, 0, sizeof (fstate->history));
+    memset(fstate->delay, 0, sizeof (fstate->delay));
+    fstate->index = fstate->delay;
+#endif
 }
 
 static void crossfeed_meier_update_filter(struct crossfeed_state *state,
@@ -268,6 +296,106 @@ void crossfeed_meier_process(struct dsp_proc_entry *this,
 }
 #endif /* CPU */
 
+#ifdef HAVE_DSP_FLOAT
+/* Float version of crossfeed_process() */
+static void crossfeed_process_float(struct dsp_proc_entry *this,
+                                    struct dsp_buffer **buf_p)
+{
+    struct crossfeed_state *state = (void *)this->data;
+    struct crossfeed_float_state *fstate = &crossfeed_float_state;
+    struct dsp_buffer *buf = *buf_p;
+
+    /* s0.31 -> float */
+    const float b0 = state->coefs[0] * (1.0f / 2147483648.0f);
+    const float b1 = state->coefs[1] * (1.0f / 2147483648.0f);
+    const float a1 = state->coefs[2] * (1.0f / 2147483648.0f);
+    const float gain = state->gain * (1.0f / 2147483648.0f);
+
+    float *hist_l = &fstate->history[0];
+    float *hist_r = &fstate->history[2];
+    float *delay = fstate->delay;
+    float *di = fstate->index;
+    float *di_max = fstate->index_max;
+    float *sl = buf->pf32[0];
+    float *sr = buf->pf32[1];
+
+    int count = buf->remcount;
+
+    for (int i = 0; i < count; i++)
+    {
+        float left = sl[i];
+        float right = sr[i];
+
+        /* Filter delayed sample from left speaker */
+        float acc = *di * b0 + hist_l[0] * b1 + hist_l[1] * a1;
+        /* Save filter history for left speaker */
+        hist_l[1] = acc;
+        hist_l[0] = *di;
+        *di++ = left;
+        /* Filter delayed sample from right speaker */
+        acc = *di * b0 + hist_r[0] * b1 + hist_r[1] * a1;
+        /* Save filter history for right speaker */
+        hist_r[1] = acc;
+        hist_r[0] = *di;
+        *di++ = right;
+        /* Now add the attenuated direct sound and write to outputs */
+        sl[i] = left * gain + hist_r[1];
+        sr[i] = right * gain + hist_l[1];
+
+        /* Wrap delay line index if bigger than delay line size */
+        if (di >= di_max)
+            di = delay;
+    }
+
+    hist_l[1] = dsp_float_flush_tiny(hist_l[1]);
+    hist_r[1] = dsp_float_flush_tiny(hist_r[1]);
+
+    /* Write back local copies of data we've modified */
+    fstate->index = di;
+}
+
+/* Float version of crossfeed_meier_process() */
+static void crossfeed_meier_process_float(struct dsp_proc_entry *this,
+                                          struct dsp_buffer **buf_p)
+{
+    struct crossfeed_state *state = (struct crossfeed_state *)this->data;
+    struct crossfeed_float_state *fstate = &crossfeed_float_state;
+    struct dsp_buffer *buf = *buf_p;
+
+    /* Get filter state */
+    float vcl = fstate->vcl;
+    float vcr = fstate->vcr;
+    float vdiff = fstate->vdiff;
+    const float coef1 = state->coef1 * (1.0f / 2147483648.0f);
+    const float coef2 = state->coef2 * (1.0f / 2147483648.0f);
+    float *sl = buf->pf32[0];
+    float *sr = buf->pf32[1];
+
+    int count = buf->remcount;
+
+    for (int i = 0; i < count; i++)
+    {
+        /* Calculate new output */
+        float lout = sl[i] + vcl;
+        float rout = sr[i] + vcr;
+        sl[i] = lout;
+        sr[i] = rout;
+
+        /* Update filter state */
+        float common = vdiff * coef2;
+        vcl -= vcl * coef1 + common;
+        vcr -= vcr * coef1 - common;
+
+        vdiff = lout - rout;
+    }
+
+    /* Store filter state */
+    fstate->vcl = dsp_float_flush_tiny(vcl);
+    fstate->vcr = dsp_float_flush_tiny(vcr);
+    fstate->vdiff = vdiff;
+}
+#endif /* HAVE_DSP_FLOAT */
+
 /* Update the processing function according to crossfeed type */
 static void update_process_fn(struct dsp_proc_entry *this,
                               struct dsp_config *dsp)
@@ -280,13 +408,23 @@ static void update_process_fn(struct dsp_proc_entry *this,
     if (crossfeed_type != CROSSFEED_TYPE_CUSTOM)
     {
         crossfeed_meier_update_filter(state, fout);
+#ifdef HAVE_DSP_FLOAT
+        fn = crossfeed_meier_process_float;
+#else
         fn = crossfeed_meier_process;
+#endif
     }
     else
     {
         state->index_max = state->delay + DELAY_LEN(fout);
         crossfeed_custom_update_filter(state, fout);
+#ifdef HAVE_DSP_FLOAT
+        crossfeed_float_state.index_max =
+            crossfeed_float_state.delay + DELAY_LEN(fout);
+        fn = crossfeed_process_float;
+#else
         fn = crossfeed_process;
+#endif
     }
 
     if (this->process != fn)
@@ -333,7 +471,12 @@ static intptr_t crossfeed_configure(struct dsp_proc_entry *this,
     {
     case DSP_PROC_INIT:
         if (value == 0)
+        {
             this->data = (intptr_t)&crossfeed_state;
+#ifdef HAVE_DSP_FLOAT
+            dsp_proc_set_float(dsp, DSP_PROC_CROSSFEED, true);
+#endif
+        }
         /* Fallthrough */
 
     case DSP_SET_OUT_FREQUENCY:
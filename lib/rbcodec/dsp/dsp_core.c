@@ -26,6 +26,7 @@
 
 #include "tdspeed.h"
 #include "resample.h"
+#include <string.h>
 
 /* Define LOGF_ENABLE to enable logf output in this file */
 /*#define LOGF_ENABLE*/
@@ -35,6 +36,45 @@
 #define DSP_PROC_DB_CREATE
 #include "dsp_proc_entry.h"
 
+#ifdef DSP_PROFILE
+#ifndef DSP_PROFILE_CLOCK
+#error DSP_PROFILE requires DSP_PROFILE_CLOCK() to be defined
+#endif
+
+/* Stage names by id */
+#define DSP_PROC_DB_START \
+    static const char * const dsp_proc_names[] = { [0] = "INPUT",
+#define DSP_PROC_DB_ITEM(name) \
+    #name,
+#define DSP_PROC_DB_STOP "OUTPUT" };
+
+#include "dsp_proc_database.h"
+
+/* Index of the output stage stats, after the last stage id */
+#define DSP_PROFILE_OUTPUT  (ARRAYLEN(dsp_proc_names) - 1)
+
+struct dsp_profile
+{
+    uint64_t samples;               /* Samples output */
+    struct
+    {
+        uint64_t ticks;
+        unsigned long calls;
+    } proc[ARRAYLEN(dsp_proc_names)]; /* Indexed by stage id */
+};
+
+static struct dsp_profile dsp_prof[DSP_COUNT];
+
+static FORCE_INLINE void dsp_profile_add(struct dsp_config *dsp,
+                                         unsigned int id, uint64_t start)
+{
+    uint64_t ticks = DSP_PROFILE_CLOCK() - start;
+    struct dsp_profile *prof = &dsp_prof[dsp_get_id(dsp)];
+    prof->proc[id].ticks += ticks;
+    prof->proc[id].calls++;
+}
+#endif /* DSP_PROFILE */
+
 #ifndef DSP_PROCESS_START
 /* These do nothing if not previously defined */
 #define DSP_PROCESS_START(yield)
@@ -60,12 +100,22 @@ struct dsp_config
         uint32_t mask;              /* In place operation mask/flag */
         uint8_t version;            /* Sample format version */
         uint8_t db_index;           /* Index in database array */
+#ifdef HAVE_DSP_FLOAT
+        uint8_t use_float;          /* Stage processes float samples */
+#endif
     } *proc_slots;                  /* Pointer to first in list of enabled
                                        stages */
 };
 
 #define NACT_BIT    BIT_N(___DSP_PROC_ID_RESERVED)
 
+#ifdef HAVE_DSP_FLOAT
+/* Buffer proc_mask flag: samples in the buffer are float, not fixed point.
+ * Kept with the in-place mask since it must follow the buffer's data across
+ * calls in exactly the same way. Stage ids never reach this bit. */
+#define FLOAT_BIT   BIT_N(31)
+#endif
+
 /* Pool of slots for stages - supports 32 or fewer combined as-is atm. */
 static struct dsp_proc_slot
 dsp_proc_slot_arr[DSP_NUM_PROC_STAGES+DSP_VOICE_NUM_PROC_STAGES] IBSS_ATTR;
@@ -190,6 +240,9 @@ dsp_proc_enable_enlink(struct dsp_config *dsp, uint32_t mask)
     s->mask = mask | NACT_BIT;
     s->version = 0;
     s->db_index = db_index;
+#ifdef HAVE_DSP_FLOAT
+    s->use_float = 0;
+#endif
     dsp->proc_mask_enabled |= mask;
     dsp->slot_free_mask &= ~BIT_N(slot);
 
@@ -338,6 +391,61 @@ void dsp_proc_set_in_place(struct dsp_config *dsp, enum dsp_proc_ids id,
         s->mask &= ~mask;
 }
 
+#ifdef HAVE_DSP_FLOAT
+/* Select float or fixed-point samples for the stage */
+void dsp_proc_set_float(struct dsp_config *dsp, enum dsp_proc_ids id,
+                        bool use_float)
+{
+    struct dsp_proc_slot *s = find_proc_slot(dsp, id);
+
+    if (s)
+        s->use_float = use_float;
+}
+
+/* Convert the remaining samples of the buffer from fixed point to float,
+ * in place. 1.0 is full scale; headroom above that is preserved. */
+static NO_INLINE void dsp_buffer_to_float(struct dsp_buffer *buf)
+{
+    const float scale = 1.0f / (1ul << buf->format.frac_bits);
+    const int count = buf->remcount;
+
+    for (unsigned int ch = 0; ch < buf->format.num_channels; ch++)
+    {
+        const int32_t *s = buf->p32[ch];
+        float *d = buf->pf32[ch];
+
+        for (int i = 0; i < count; i++)
+            d[i] = s[i] * scale;
+    }
+
+    buf->proc_mask |= FLOAT_BIT;
+}
+
+/* Convert the remaining samples of the buffer from float back to fixed
+ * point, in place, saturating anything beyond the format's headroom */
+static NO_INLINE void dsp_buffer_to_fixed(struct dsp_buffer *buf)
+{
+    const float scale = 1ul << buf->format.frac_bits;
+    const float smax = 2147483520.0f; /* Largest float below 2^31 */
+    const int count = buf->remcount;
+
+    for (unsigned int ch = 0; ch < buf->format.num_channels; ch++)
+    {
+        const float *s = buf->pf32[ch];
+        int32_t *d = buf->p32[ch];
+
+        for (int i = 0; i < count; i++)
+        {
+            float f = s[i] * scale;
+            f = f < -smax ? -smax : (f > smax ? smax : f);
+            d[i] = f;
+        }
+    }
+
+    buf->proc_mask &= ~FLOAT_BIT;
+}
+#endif /* HAVE_DSP_FLOAT */
+
 /* Determine by the rules if the processing function should be called */
 static NO_INLINE bool dsp_proc_new_format(struct dsp_proc_slot *s,
                                           struct dsp_config *dsp,
@@ -385,7 +493,27 @@ static FORCE_INLINE void dsp_proc_call(struct dsp_proc_slot *s,
         buf->proc_mask |= s->mask;
     }
 
+#ifdef DSP_PROFILE
+    /* Any sample conversion is charged to the stage needing it */
+    uint64_t prof_start = DSP_PROFILE_CLOCK();
+#endif
+
+#ifdef HAVE_DSP_FLOAT
+    /* Hand the stage the sample type it asked for */
+    if (s->use_float == !(buf->proc_mask & FLOAT_BIT))
+    {
+        if (s->use_float)
+            dsp_buffer_to_float(buf);
+        else
+            dsp_buffer_to_fixed(buf);
+    }
+#endif
+
     s->proc_entry.process(&s->proc_entry, buf_p);
+
+#ifdef DSP_PROFILE
+    dsp_profile_add(dsp, proc_db_entry(s)->id, prof_start);
+#endif
 }
 
 /**
@@ -455,8 +583,14 @@ void dsp_process(struct dsp_config *dsp, struct dsp_buffer *src,
          * and switch the buffer to their own output buffer */
         struct dsp_buffer *buf = src;
 
+#ifdef DSP_PROFILE
+        uint64_t prof_start = DSP_PROFILE_CLOCK();
+#endif
         /* Convert input samples to internal format */
         dsp->io_data.input_samples(&dsp->io_data, &buf);
+#ifdef DSP_PROFILE
+        dsp_profile_add(dsp, 0, prof_start);
+#endif
 
         /* Call all active/enabled stages depending if format is
            same/changed on the last output buffer */
@@ -473,7 +607,19 @@ void dsp_process(struct dsp_config *dsp, struct dsp_buffer *src,
             dsp_sample_output_format_change(&dsp->io_data, &buf->format);
 
         dsp->io_data.outcount = outcount;
+#ifdef DSP_PROFILE
+        prof_start = DSP_PROFILE_CLOCK();
+#endif
+#ifdef HAVE_DSP_FLOAT
+        if (buf->proc_mask & FLOAT_BIT)
+            dsp->io_data.output_samples_float(&dsp->io_data, buf, dst);
+        else
+#endif
         dsp->io_data.output_samples(&dsp->io_data, buf, dst);
+#ifdef DSP_PROFILE
+        dsp_profile_add(dsp, DSP_PROFILE_OUTPUT, prof_start);
+        dsp_prof[dsp_get_id(dsp)].samples += outcount;
+#endif
 
         /* Advance buffers by what output consumed and produced */
         dsp_advance_buffer32(buf, outcount);
@@ -485,6 +631,36 @@ void dsp_process(struct dsp_config *dsp, struct dsp_buffer *src,
     DSP_PROCESS_END();
 }
 
+#ifdef DSP_PROFILE
+int dsp_get_proc_stats(struct dsp_config *dsp, struct dsp_proc_stats *stats,
+                       int max, uint64_t *samples)
+{
+    const struct dsp_profile *prof = &dsp_prof[dsp_get_id(dsp)];
+    int count = 0;
+
+    /* Ids follow database order, which is the processing order */
+    for (unsigned int id = 0; id < ARRAYLEN(dsp_proc_names) && count < max;
+         id++)
+    {
+        if (prof->proc[id].calls == 0)
+            continue;
+
+        stats[count].name = dsp_proc_names[id];
+        stats[count].ticks = prof->proc[id].ticks;
+        stats[count].calls = prof->proc[id].calls;
+        count++;
+    }
+
+    *samples = prof->samples;
+    return count;
+}
+
+void dsp_reset_proc_stats(struct dsp_config *dsp)
+{
+    memset(&dsp_prof[dsp_get_id(dsp)], 0, sizeof (struct dsp_profile));
+}
+#endif /* DSP_PROFILE */
+
 intptr_t dsp_configure(struct dsp_config *dsp, unsigned int setting,
                        intptr_t value)
 {
@@ -77,6 +77,9 @@ struct dsp_buffer
     {
         const void *pin[2]; /* 04h: Channel pointers (In) */
         int32_t *p32[2];    /* 04h: Channel pointers (Int) */
+#ifdef HAVE_DSP_FLOAT
+        float *pf32[2];     /* 04h: Channel pointers (Int, float samples) */
+#endif
         int16_t *p16out;    /* 04h: DSP output buffer (Out) */
     };
     union
@@ -145,4 +148,27 @@ intptr_t dsp_configure(struct dsp_config *dsp, unsigned int setting,
 /* One-time startup init that must come before settings reset/apply */
 void dsp_init(void) INIT_ATTR;
 
+#ifdef DSP_PROFILE
+/** Per-stage profiling **/
+
+/* Processing time accumulated by one stage. The input conversion and the
+ * output stage are reported as "INPUT" and "OUTPUT". Ticks are in units of
+ * DSP_PROFILE_CLOCK(), which the platform config must provide. */
+struct dsp_proc_stats
+{
+    const char *name;     /* Stage name */
+    uint64_t ticks;       /* Clock ticks spent in the stage */
+    unsigned long calls;  /* Number of times the stage was run */
+};
+
+/* Fill in stats for each stage that has run since the last reset, in
+ * processing order. Returns the number of entries; *samples receives the
+ * number of samples output over the same period. */
+int dsp_get_proc_stats(struct dsp_config *dsp, struct dsp_proc_stats *stats,
+                       int max, uint64_t *samples);
+
+/* Zero all the counters of the DSP */
+void dsp_reset_proc_stats(struct dsp_config *dsp);
+#endif /* DSP_PROFILE */
+
 #endif /* _DSP_H */
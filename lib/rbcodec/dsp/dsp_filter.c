@@ -22,6 +22,7 @@
 #include "fixedpoint.h"
 #include "fracmul.h"
 #include "dsp_filter.h"
+#include "dsp_proc_entry.h"
 #include "replaygain.h"
 #include <string.h>
 
@@ -32,6 +33,94 @@ enum filter_shift
     FILTER_SHELF_SHIFT = 6,   /* Each high/low shelving filter */
 };
 
+/**
+ * Set the final shift for a freshly calculated set of coefficients and
+ * derive anything else that depends upon them.
+ */
+static void filter_set_shift(struct dsp_filter *f, unsigned int shift)
+{
+    f->shift = shift;
+#ifdef HAVE_DSP_FLOAT
+    /* y = (sum << shift) >> 32, so each coef is really c * 2^(shift - 32) */
+    const float scale = 1.0f / (1ull << (32 - shift));
+    for (int i = 0; i < 5; i++)
+        f->fcoefs[i] = f->coefs[i] * scale;
+#endif
+}
+
+/**
+ * Coefficient cache
+ *
+ * The same filters are recalculated whenever the output sample rate changes,
+ * which happens at every track boundary of a mixed-rate playlist when the
+ * output follows the track rate. The generators remember recent results
+ * keyed on their arguments, which already include the sample rate since
+ * cutoffs are relative to it, so going back to a rate seen before costs a
+ * table lookup instead of the trig and divisions.
+ */
+#define FILTER_CACHE_BITS   5
+#define FILTER_CACHE_SIZE   (1 << FILTER_CACHE_BITS)
+
+enum filter_cache_type
+{
+    FILTER_CACHE_EMPTY = 0,
+    FILTER_CACHE_SHELF_LOW,
+    FILTER_CACHE_SHELF_HIGH,
+    FILTER_CACHE_BISHELF,
+    FILTER_CACHE_PEAK,
+    FILTER_CACHE_LOW_SHELF,
+    FILTER_CACHE_HIGH_SHELF,
+};
+
+struct filter_cache_entry
+{
+    uint32_t type;      /* FILTER_CACHE_* */
+    uint32_t args[5];   /* Generator arguments, unused ones zero */
+    int32_t coefs[5];   /* Resulting coefficients */
+};
+
+/* There is no lock: this is only correct as long as all DSP configuration
+ * and processing happen on one core, where the settings setters and the
+ * codec thread can't be in here at the same time. A DSP running on another
+ * core would need the entries serialized and kept coherent between the
+ * cores. */
+static struct filter_cache_entry filter_cache[FILTER_CACHE_SIZE];
+
+static struct filter_cache_entry *
+filter_cache_entry(unsigned int type, const uint32_t *args)
+{
+    uint32_t hash = type;
+
+    for (int i = 0; i < 5; i++)
+        hash = (hash ^ args[i]) * 0x9e3779b1;
+
+    return &filter_cache[hash >> (32 - FILTER_CACHE_BITS)];
+}
+
+/* Copy cached coefficients for the arguments to c, if there are any */
+static bool filter_cache_get(unsigned int type, const uint32_t *args,
+                             int32_t *c, int count)
+{
+    const struct filter_cache_entry *e = filter_cache_entry(type, args);
+
+    if (e->type != type || memcmp(e->args, args, sizeof (e->args)))
+        return false;
+
+    memcpy(c, e->coefs, count * sizeof (int32_t));
+    return true;
+}
+
+/* Remember coefficients calculated for the arguments */
+static void filter_cache_put(unsigned int type, const uint32_t *args,
+                             const int32_t *c, int count)
+{
+    struct filter_cache_entry *e = filter_cache_entry(type, args);
+
+    e->type = type;
+    memcpy(e->args, args, sizeof (e->args));
+    memcpy(e->coefs, c, count * sizeof (int32_t));
+}
+
 /** 
  * Calculate first order shelving filter. Filter is not directly usable by the
  * filter_process() function.
@@ -43,6 +132,13 @@ enum filter_shift
  */
 void filter_shelf_coefs(unsigned long cutoff, long A, bool low, int32_t *c)
 {
+    const unsigned int type = low ? FILTER_CACHE_SHELF_LOW :
+                                    FILTER_CACHE_SHELF_HIGH;
+    const uint32_t args[5] = { cutoff, A };
+
+    if (filter_cache_get(type, args, c, 3))
+        return;
+
     long sin, cos;
     int32_t b0, b1, a0, a1; /* s3.28 */
     const long g = get_replaygain_int(A*5) << 4; /* 10^(db/40), s3.28 */
@@ -67,9 +163,11 @@ void filter_shelf_coefs(unsigned long cutoff, long A, bool low, int32_t *c)
     }
 
     const int32_t rcp_a0 = fp_div(1, a0, 57); /* 0.24 .. 3.98, s2.29 */
-    *c++ = FRACMUL_SHL(b0, rcp_a0, 1);       /* 0.063 .. 15.85 */
-    *c++ = FRACMUL_SHL(b1, rcp_a0, 1);       /* -15.85 .. 15.85 */
-    *c++ = -FRACMUL_SHL(a1, rcp_a0, 1);      /* -1 .. 1 */
+    c[0] = FRACMUL_SHL(b0, rcp_a0, 1);       /* 0.063 .. 15.85 */
+    c[1] = FRACMUL_SHL(b1, rcp_a0, 1);       /* -15.85 .. 15.85 */
+    c[2] = -FRACMUL_SHL(a1, rcp_a0, 1);      /* -1 .. 1 */
+
+    filter_cache_put(type, args, c, 3);
 }
 
 
@@ -89,6 +187,14 @@ void filter_bishelf_coefs(unsigned long cutoff_low, unsigned long cutoff_high,
                           long A_low, long A_high, long A,
                           struct dsp_filter *f)
 {
+    const uint32_t args[5] = { cutoff_low, cutoff_high, A_low, A_high, A };
+
+    if (filter_cache_get(FILTER_CACHE_BISHELF, args, f->coefs, 5))
+    {
+        filter_set_shift(f, FILTER_BISHELF_SHIFT);
+        return;
+    }
+
     const long g = get_replaygain_int(A*10) << 7; /* 10^(db/20), s0.31 */
     int32_t c_ls[3], c_hs[3];
 
@@ -112,7 +218,8 @@ void filter_bishelf_coefs(unsigned long cutoff_low, unsigned long cutoff_high,
     *c++ = a0 + a1;
     *c   = -FRACMUL_SHL(a0, a1, 4);
 
-    f->shift = FILTER_BISHELF_SHIFT;
+    filter_cache_put(FILTER_CACHE_BISHELF, args, f->coefs, 5);
+    filter_set_shift(f, FILTER_BISHELF_SHIFT);
 }
 
 
@@ -137,6 +244,14 @@ void filter_bishelf_coefs(unsigned long cutoff_low, unsigned long cutoff_high,
 void filter_pk_coefs(unsigned long cutoff, unsigned long Q, long db,
                      struct dsp_filter *f)
 {
+    const uint32_t args[5] = { cutoff, Q, db };
+
+    if (filter_cache_get(FILTER_CACHE_PEAK, args, f->coefs, 5))
+    {
+        filter_set_shift(f, FILTER_PEAK_SHIFT);
+        return;
+    }
+
     long cs;
     const long one = 1 << 28; /* s3.28 */
     const long A = get_replaygain_int(db*5) << 5; /* 10^(db/40), s2.29 */
@@ -162,7 +277,8 @@ void filter_pk_coefs(unsigned long cutoff, unsigned long Q, long db,
     *c++ = FRACMUL(-a1, rcp_a0);        /* [-2 .. 2] */
     *c   = FRACMUL(-a2, rcp_a0);        /* [-0.6 .. 1] */
 
-    f->shift = FILTER_PEAK_SHIFT;
+    filter_cache_put(FILTER_CACHE_PEAK, args, f->coefs, 5);
+    filter_set_shift(f, FILTER_PEAK_SHIFT);
 }
 
 /**
@@ -172,6 +288,14 @@ void filter_pk_coefs(unsigned long cutoff, unsigned long Q, long db,
 void filter_ls_coefs(unsigned long cutoff, unsigned long Q, long db,
                      struct dsp_filter *f)
 {
+    const uint32_t args[5] = { cutoff, Q, db };
+
+    if (filter_cache_get(FILTER_CACHE_LOW_SHELF, args, f->coefs, 5))
+    {
+        filter_set_shift(f, FILTER_SHELF_SHIFT);
+        return;
+    }
+
     long cs;
     const long one = 1 << 25; /* s6.25 */
     const long sqrtA = get_replaygain_int(db*5/2) << 2; /* 10^(db/80), s5.26 */
@@ -207,7 +331,8 @@ void filter_ls_coefs(unsigned long cutoff, unsigned long Q, long db,
     *c++ = FRACMUL_SHL(-a1, rcp_a0, 2);      /* [-2 .. 2] */
     *c++ = FRACMUL_SHL(-a2, rcp_a0, 2);      /* [0 .. 1] */
 
-    f->shift = FILTER_SHELF_SHIFT;
+    filter_cache_put(FILTER_CACHE_LOW_SHELF, args, f->coefs, 5);
+    filter_set_shift(f, FILTER_SHELF_SHIFT);
 }
 
 /**
@@ -217,6 +342,14 @@ void filter_ls_coefs(unsigned long cutoff, unsigned long Q, long db,
 void filter_hs_coefs(unsigned long cutoff, unsigned long Q, long db,
                      struct dsp_filter *f)
 {
+    const uint32_t args[5] = { cutoff, Q, db };
+
+    if (filter_cache_get(FILTER_CACHE_HIGH_SHELF, args, f->coefs, 5))
+    {
+        filter_set_shift(f, FILTER_SHELF_SHIFT);
+        return;
+    }
+
     long cs;
     const long one = 1 << 25; /* s6.25 */
     const long sqrtA = get_replaygain_int(db*5/2) << 2; /* 10^(db/80), s5.26 */
@@ -252,7 +385,8 @@ void filter_hs_coefs(unsigned long cutoff, unsigned long Q, long db,
     *c++ = FRACMUL_SHL(-a1, rcp_a0, 2);      /* [-2 .. 2] */
     *c   = FRACMUL_SHL(-a2, rcp_a0, 2);      /* [0 .. 1] */
 
-    f->shift = FILTER_SHELF_SHIFT;
+    filter_cache_put(FILTER_CACHE_HIGH_SHELF, args, f->coefs, 5);
+    filter_set_shift(f, FILTER_SHELF_SHIFT);
 }
 
 /**
@@ -262,6 +396,9 @@ void filter_copy(struct dsp_filter *dst, const struct dsp_filter *src)
 {
     memcpy(dst->coefs, src->coefs, sizeof (src->coefs));
     dst->shift = src->shift;
+#ifdef HAVE_DSP_FLOAT
+    memcpy(dst->fcoefs, src->fcoefs, sizeof (src->fcoefs));
+#endif
 }
 
 /**
@@ -270,6 +407,9 @@ void filter_copy(struct dsp_filter *dst, const struct dsp_filter *src)
 void filter_flush(struct dsp_filter *f)
 {
     memset(f->history, 0, sizeof (f->history));
+#ifdef HAVE_DSP_FLOAT
+    memset(f->fhistory, 0, sizeof (f->fhistory));
+#endif
 }
 
 /**
@@ -304,6 +444,41 @@ void filter_process(struct dsp_filter *f, int32_t * const buf[], int count,
 }
 #endif /* CPU */
 
+#ifdef HAVE_DSP_FLOAT
+/**
+ * Float version of filter_process(). Same direct form 1 structure; the
+ * history is flushed of values too small to matter after each block so a
+ * decaying tail can't leave the filter running on denormals.
+ */
+void filter_process_float(struct dsp_filter *f, float * const buf[], int count,
+                          unsigned int channels)
+{
+    const float b0 = f->fcoefs[0], b1 = f->fcoefs[1], b2 = f->fcoefs[2];
+    const float a1 = f->fcoefs[3], a2 = f->fcoefs[4];
+
+    for (unsigned int c = 0; c < channels; c++) {
+        float *h = f->fhistory[c];
+        float x1 = h[0], x2 = h[1], y1 = h[2], y2 = h[3];
+        float *s = buf[c];
+
+        for (int i = 0; i < count; i++) {
+            float x = s[i];
+            float y = b0*x + b1*x1 + b2*x2 + a1*y1 + a2*y2;
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+            s[i] = y;
+        }
+
+        h[0] = x1;
+        h[1] = x2;
+        h[2] = dsp_float_flush_tiny(y1);
+        h[3] = dsp_float_flush_tiny(y2);
+    }
+}
+#endif /* HAVE_DSP_FLOAT */
+
 /* ring buffer */
 int32_t dequeue(int32_t* buffer, int *head, int boundary)
 {
@@ -323,3 +498,24 @@ void enqueue(int32_t var, int32_t* buffer, int *head, int boundary)
     else
         *head += 1;
 }
+
+#ifdef HAVE_DSP_FLOAT
+float dequeue_float(float *buffer, int *head, int boundary)
+{
+    float var = buffer[*head];
+    if (*head +1 >= boundary)
+        *head = 0;
+    else
+        *head += 1;
+    return var;
+}
+
+void enqueue_float(float var, float *buffer, int *head, int boundary)
+{
+    buffer[*head] = var;
+    if (*head +1 >= boundary)
+        *head = 0;
+    else
+        *head += 1;
+}
+#endif /* HAVE_DSP_FLOAT */
@@ -34,6 +34,10 @@ struct dsp_filter
     int32_t history[2][4]; /* 14h: Order is x-1, x-2, y-1, y-2, per channel */
     uint8_t shift;         /* 34h: Final shift after computation */
                            /* 38h */
+#ifdef HAVE_DSP_FLOAT
+    float fcoefs[5];       /* Float equivalents of coefs with shift applied */
+    float fhistory[2][4];  /* Float sample history, same order as history */
+#endif
 };
 
 void filter_shelf_coefs(unsigned long cutoff, long A, bool low, int32_t *c);
@@ -51,7 +55,15 @@ void filter_copy(struct dsp_filter *dst, const struct dsp_filter *src);
 void filter_flush(struct dsp_filter *f);
 void filter_process(struct dsp_filter *f, int32_t * const buf[], int count,
                     unsigned int channels);
+#ifdef HAVE_DSP_FLOAT
+void filter_process_float(struct dsp_filter *f, float * const buf[], int count,
+                          unsigned int channels);
+#endif
 /* ring buffer */
 void enqueue(int32_t var, int32_t* buffer, int *head, int boundary);
 int32_t dequeue(int32_t* buffer, int *head, int boundary);
+#ifdef HAVE_DSP_FLOAT
+void enqueue_float(float var, float *buffer, int *head, int boundary);
+float dequeue_float(float *buffer, int *head, int boundary);
+#endif
 #endif /* DSP_FILTER_H */
@@ -51,6 +51,7 @@ DSP_PROC_DB_START
     DSP_PROC_DB_ITEM(SURROUND)      /* haas surround */
     DSP_PROC_DB_ITEM(CHANNEL_MODE)  /* channel modes */
     DSP_PROC_DB_ITEM(COMPRESSOR)    /* dynamic-range compressor */
+    DSP_PROC_DB_ITEM(LIMITER)       /* look-ahead true-peak limiter */
 DSP_PROC_DB_STOP
 
 /* This file is included multiple times with different macro definitions so
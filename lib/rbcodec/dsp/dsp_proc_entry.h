@@ -157,6 +157,20 @@ void dsp_proc_want_format_update(struct dsp_config *dsp,
 void dsp_proc_set_in_place(struct dsp_config *dsp, enum dsp_proc_ids id,
                            bool in_place);
 
+#ifdef HAVE_DSP_FLOAT
+/* Select float or fixed-point samples for the stage - buffers are converted
+ * in place to the stage's choice before process() is called */
+void dsp_proc_set_float(struct dsp_config *dsp, enum dsp_proc_ids id,
+                        bool use_float);
+
+/* Zero recursive filter state that has decayed far below audibility so that
+ * it can't go denormal and slow everything to a crawl on silence */
+static inline float dsp_float_flush_tiny(float x)
+{
+    return (x > -1e-20f && x < 1e-20f) ? 0.0f : x;
+}
+#endif
+
 #define DSP_PRINT_FORMAT(id, format) \
     DEBUGF("DSP format- " #id "\n"                      \
            "  ver:%u ch:%u fb:%u os:%u hz:%u chz:%u\n", \
@@ -27,6 +27,7 @@
 #include "crossfeed.h"
 #include "dsp_misc.h"
 #include "eq.h"
+#include "limiter.h"
 #include "pga.h"
 #include "surround.h"
 #include "afr.h"
@@ -54,6 +54,10 @@ struct sample_io_data
     uint8_t format_dirty;         /* Format change set, avoids superfluous
                                      increments before carrying it out */
     uint8_t output_version;       /* Format version of src buffer at output */
+#ifdef HAVE_DSP_FLOAT
+    sample_output_fn_type output_samples_float; /* Final output function for
+                                                   float buffers */
+#endif
 };
 
 void dsp_sample_input_init(struct sample_io_data *this, unsigned int dsp_id) INIT_ATTR;
@@ -26,6 +26,9 @@
 #include "dsp_proc_entry.h"
 #include "dsp-util.h"
 #include <string.h>
+#ifdef HAVE_DSP_FLOAT
+#include <math.h>
+#endif
 
 #if 0
 #include <debug.h>
@@ -161,6 +164,120 @@ void sample_output_dithered(struct sample_io_data *this,
     while (--count > 0);
 }
 
+#ifdef HAVE_DSP_FLOAT
+/** Float sample output **/
+
+/* Quantize a float sample (1.0 = full scale) to 16 bits, rounding to
+ * nearest like the DC-biased fixed-point output. The value is offset to be
+ * positive so truncation floors and the clip can be done in float. */
+static FORCE_INLINE int32_t float_sample_16(float f)
+{
+    f = f * 32768.0f + 32768.5f;
+    f = f < 0.0f ? 0.0f : (f > 65535.0f ? 65535.0f : f);
+    return (int32_t)f - 32768;
+}
+
+/* write mono float format to output format */
+static void sample_output_float_mono(struct sample_io_data *this,
+                                     struct dsp_buffer *src,
+                                     struct dsp_buffer *dst)
+{
+    int count = this->outcount;
+    const float *s0 = src->pf32[0];
+    int16_t *d = dst->p16out;
+
+    for (int i = 0; i < count; i++)
+    {
+        int16_t lr = float_sample_16(s0[i]);
+        d[2*i + 0] = lr;
+        d[2*i + 1] = lr;
+    }
+}
+
+/* write stereo float format to output format */
+static void sample_output_float_stereo(struct sample_io_data *this,
+                                       struct dsp_buffer *src,
+                                       struct dsp_buffer *dst)
+{
+    int count = this->outcount;
+    const float *s0 = src->pf32[0];
+    const float *s1 = src->pf32[1];
+    int16_t *d = dst->p16out;
+
+    for (int i = 0; i < count; i++)
+    {
+        d[2*i + 0] = float_sample_16(s0[i]);
+        d[2*i + 1] = float_sample_16(s1[i]);
+    }
+}
+
+/* Same noise shaping and tri-PDF dither as sample_output_dithered() but
+ * working in units of the output LSB */
+static struct dither_float_state
+{
+    float error[3];     /* error term history */
+    int32_t random;     /* last random value */
+} dither_float_state[2] IBSS_ATTR;
+
+static void sample_output_float_dithered(struct sample_io_data *this,
+                                         struct dsp_buffer *src,
+                                         struct dsp_buffer *dst)
+{
+    int count = this->outcount;
+    int channels = src->format.num_channels;
+    const float rscale = 1.0f / 4294967296.0f; /* 32 random bits -> [0, 1) */
+
+    for (int ch = 0; ch < channels; ch++)
+    {
+        struct dither_float_state *dither = &dither_float_state[ch];
+
+        const float *s = src->pf32[ch];
+        int16_t *d = &dst->p16out[ch];
+
+        for (int i = 0; i < count; i++, s++, d += 2)
+        {
+            /* Noise shape */
+            float sample = *s * 32768.0f;
+
+            sample += dither->error[0] - dither->error[1] + dither->error[2];
+            dither->error[2] = dither->error[1];
+            dither->error[1] = dither->error[0] * 0.5f;
+
+            /* Dither, highpass triangle PDF */
+            int32_t random = dither->random*0x0019660dL + 0x3c6ef35fL;
+            float output = sample +
+                ((float)(uint32_t)random - (float)(uint32_t)dither->random)
+                    * rscale;
+            dither->random = random;
+
+            /* Quantize sample to output range */
+            output = floorf(output + 0.5f);
+
+            /* Error feedback of quantization */
+            dither->error[0] = sample - output;
+
+            /* Clip and store */
+            *d = output < -32768.0f ? -32768 :
+                    (output > 32767.0f ? 32767 : (int32_t)output);
+        }
+    }
+
+    if (channels > 1)
+        return;
+
+    /* Have to duplicate left samples into the right channel since
+       output is interleaved stereo */
+    int16_t *d = dst->p16out;
+
+    do
+    {
+        int16_t s = *d++;
+        *d++ = s;
+    }
+    while (--count > 0);
+}
+#endif /* HAVE_DSP_FLOAT */
+
 /* Initialize the output function for settings and format */
 void dsp_sample_output_format_change(struct sample_io_data *this,
                                      struct sample_format *format)
@@ -180,6 +297,17 @@ void dsp_sample_output_format_change(struct sample_io_data *this,
     DSP_PRINT_FORMAT(DSP Output, *format);
 
     this->output_samples = fns[dither ? 1 : 0][channels - 1];
+#ifdef HAVE_DSP_FLOAT
+    static const sample_output_fn_type float_fns[2][2] =
+    {
+        { sample_output_float_mono,
+          sample_output_float_stereo },
+        { sample_output_float_dithered,
+          sample_output_float_dithered },
+    };
+
+    this->output_samples_float = float_fns[dither ? 1 : 0][channels - 1];
+#endif
     this->output_version = format->version;
 }
 
@@ -187,13 +315,21 @@ void dsp_sample_output_init(struct sample_io_data *this)
 {
     this->output_version = 0;
     this->output_samples = sample_output_stereo;
+#ifdef HAVE_DSP_FLOAT
+    this->output_samples_float = sample_output_float_stereo;
+#endif
 }
 
 /* Flush the dither history */
 void dsp_sample_output_flush(struct sample_io_data *this)
 {
     if (dsp_get_id((void *)this) == CODEC_IDX_AUDIO)
+    {
         memset(dither_data.state, 0, sizeof (dither_data.state));
+#ifdef HAVE_DSP_FLOAT
+        memset(dither_float_state, 0, sizeof (dither_float_state));
+#endif
+    }
 }
 
 
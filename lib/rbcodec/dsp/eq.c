@@ -170,7 +170,11 @@ static void eq_process(struct dsp_proc_entry *this,
     unsigned int channels = buf->format.num_channels;
 
     FOR_EACH_ENB_BAND(b)
+#ifdef HAVE_DSP_FLOAT
+        filter_process_float(&eq_data.filters[*b], buf->pf32, count, channels);
+#else
         filter_process(&eq_data.filters[*b], buf->p32, count, channels);
+#endif
 
     (void)this;
 }
@@ -185,6 +189,9 @@ static intptr_t eq_configure(struct dsp_proc_entry *this,
     {
     case DSP_PROC_INIT:
         this->process = eq_process;
+#ifdef HAVE_DSP_FLOAT
+        dsp_proc_set_float(dsp, DSP_PROC_EQUALIZER, true);
+#endif
         /* Wouldn't have been getting frequency updates */
         update_samplerate(dsp_get_output_frequency(dsp));
         /* Fall-through */
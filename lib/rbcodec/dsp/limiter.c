@@ -0,0 +1,403 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Copyright (C) 2026 by the Rockbox contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#include "rbcodecconfig.h"
+#include "platform.h"
+#include "fixedpoint.h"
+#include "fracmul.h"
+#include "replaygain.h"
+#include <string.h>
+#include "core_alloc.h"
+
+/* Define LOGF_ENABLE to enable logf output in this file
+ * #define LOGF_ENABLE
+ */
+#include "logf.h"
+#include "dsp_proc_entry.h"
+#include "dsp_sample_io.h"
+#include "dsp_misc.h"
+#include "limiter.h"
+#include "true_peak.h"
+
+/**
+ * Look-ahead true-peak limiter
+ *
+ * Keeps the reconstructed (inter-sample) peaks of the output at or below the
+ * ceiling. Peaks are found by 4x oversampling through a polyphase
+ * interpolator. The gain needed by the loudest peak in the look-ahead window
+ * is held for the length of the window, released exponentially and smoothed
+ * by a moving average as long as the window. The audio is delayed by the
+ * window length so the gain has settled by the time a peak reaches the
+ * output; nothing is clipped and the gain never steps.
+ *
+ * It runs last, after the compressor, so it catches whatever ReplayGain,
+ * EQ boosts and the other stages leave above full scale.
+ */
+
+#define RELEASE_MS  100             /* Time constant of gain recovery */
+
+/* Gain format; a full window of gains must sum to less than 2^32 */
+#define UNITY_BITS  20
+#define UNITY       (1ul << UNITY_BITS)
+
+/* Window length limit in samples */
+#define WINDOW_MAX  (DSP_OUT_MAX_HZ * LIMITER_LOOKAHEAD_MAX / 1000)
+
+#if WINDOW_MAX >= (1 << (32 - UNITY_BITS))
+#error Limiter window too long for gain format
+#endif
+
+/* True peak interpolator coefficients, see true_peak.h */
+const int32_t tp_coefs[3][TP_TAPS] =
+{
+    {  -20685267,   42710842,  -77661762,  135741798,
+      -250513577,  637005009, 1943640409, -369383169,
+       181589545, -102688185,   58153311,  -30425306 },
+    {  -35838295,   70902781, -126746738,  222138723,
+      -426385404, 1369670757, 1369670757, -426385404,
+       222138723, -126746738,   70902781,  -35838295 },
+    {  -30425306,   58153311, -102688185,  181589545,
+      -369383169, 1943640409,  637005009, -250513577,
+       135741798,  -77661762,   42710842,  -20685267 },
+};
+
+struct limiter_buffers
+{
+    int32_t delay[2][WINDOW_MAX + TP_DELAY]; /* Audio delay lines */
+    uint32_t gain[WINDOW_MAX];      /* Moving average history */
+    int32_t peak[WINDOW_MAX];       /* Sliding maximum queue: peak levels */
+    uint32_t peak_pos[WINDOW_MAX];  /*  ...and the positions they expire */
+};
+
+static struct limiter_state
+{
+    /* Derived from the settings and format */
+    int window;                     /* Look-ahead window in samples */
+    int32_t ceiling;                /* Ceiling in the sample format */
+    int32_t fast_level;             /* See TP_FAST_FRAC */
+    int32_t release;                /* Release coefficient (s0.31) */
+    uint32_t avg_recip;             /* 2^32 / window, rounded up */
+    /* Running state */
+    uint32_t pos;                   /* Sample count */
+    int delay_pos;                  /* Write position in delay lines */
+    int hist_pos;                   /* Write position in hist */
+    int32_t hist[2][2*TP_TAPS];     /* Interpolator history (mirrored) */
+    int32_t last_interval;          /* Peak of the previous interval */
+    bool quiet;                     /* Last block was below fast_level */
+    int peak_head;                  /* First queue entry */
+    int peak_count;                 /* Number of queue entries */
+    int32_t target_peak;            /* Level target_gain was computed for */
+    uint32_t target_gain;           /* Gain for target_peak */
+    int32_t env;                    /* Held and released gain (s1.30) */
+    uint32_t gain_sum;              /* Sum of the moving average history */
+    int gain_pos;                   /* Position in moving average history */
+} limiter;
+
+static struct limiter_settings curr_set;
+static int frac_bits = WORD_FRACBITS;
+static int handle = -1;
+
+static void limiter_update(unsigned int fout)
+{
+    /* Ceiling in the current sample format; replaygain factors are s7.24 */
+    long factor = get_replaygain_int(curr_set.ceiling * 10);
+    int64_t ceiling = frac_bits >= 24 ?
+        (int64_t)factor << (frac_bits - 24) : factor >> (24 - frac_bits);
+
+    limiter.ceiling = MIN(ceiling, INT32_MAX);
+    limiter.fast_level = FRACMUL(limiter.ceiling, TP_FAST_FRAC);
+
+    int window = curr_set.lookahead * fout / 1000;
+    limiter.window = MIN(MAX(window, TP_TAPS), WINDOW_MAX);
+    limiter.avg_recip =
+        ((1ull << 32) + limiter.window - 1) / limiter.window;
+    limiter.release = 0x7fffffff / (RELEASE_MS * fout / 1000);
+}
+
+static void limiter_flush(void)
+{
+    if (handle < 0)
+        return;
+
+    struct limiter_buffers *lb = core_get_data(handle);
+
+    memset(lb->delay, 0, sizeof (lb->delay));
+    for (int i = 0; i < limiter.window; i++)
+        lb->gain[i] = UNITY;
+
+    memset(limiter.hist, 0, sizeof (limiter.hist));
+    limiter.pos = 0;
+    limiter.delay_pos = 0;
+    limiter.hist_pos = 0;
+    limiter.last_interval = 0;
+    limiter.quiet = true;
+    limiter.peak_head = 0;
+    limiter.peak_count = 0;
+    limiter.target_peak = 0;
+    limiter.target_gain = UNITY;
+    limiter.env = UNITY << (30 - UNITY_BITS);
+    limiter.gain_sum = limiter.window * UNITY;
+    limiter.gain_pos = 0;
+}
+
+/** SET LIMITER
+ *  Called by the menu system to configure the limiter
+ */
+void dsp_set_limiter(const struct limiter_settings *settings)
+{
+    struct dsp_config *dsp = dsp_get_config(CODEC_IDX_AUDIO);
+
+    curr_set = *settings;
+    curr_set.lookahead = MIN(MAX(curr_set.lookahead, LIMITER_LOOKAHEAD_MIN),
+                             LIMITER_LOOKAHEAD_MAX);
+    curr_set.ceiling = MIN(curr_set.ceiling, 0);
+
+    if (dsp_proc_enabled(dsp, DSP_PROC_LIMITER))
+    {
+        limiter_update(dsp_get_output_frequency(dsp));
+        limiter_flush();
+    }
+
+    dsp_proc_enable(dsp, DSP_PROC_LIMITER, settings->enabled);
+}
+
+/** LIMITER PROCESS
+ *  Applies the look-ahead gain to the delayed samples
+ */
+static void limiter_process(struct dsp_proc_entry *this,
+                            struct dsp_buffer **buf_p)
+{
+    struct dsp_buffer *buf = *buf_p;
+    struct limiter_buffers *lb = core_get_data(handle);
+    const int count = buf->remcount;
+    const int num_chan = MIN(buf->format.num_channels, 2);
+    const int window = limiter.window;
+    const int delay_len = window + TP_DELAY - 1; /* Detector lag + window */
+    int32_t level = 0;
+
+    /* Skip peak detection for quiet blocks */
+    for (int ch = 0; ch < num_chan; ch++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            int32_t x = abs(buf->p32[ch][i]);
+            if (x > level)
+                level = x;
+        }
+    }
+
+    bool quiet = level <= limiter.fast_level;
+    bool detect = !(quiet && limiter.quiet);
+    limiter.quiet = quiet;
+
+    for (int i = 0; i < count; i++)
+    {
+        int32_t interval = 0;
+        int rd = limiter.delay_pos - delay_len;
+        if (rd < 0)
+            rd += WINDOW_MAX + TP_DELAY;
+
+        for (int ch = 0; ch < num_chan; ch++)
+        {
+            int32_t x = buf->p32[ch][i];
+            int32_t *h = limiter.hist[ch];
+
+            h[limiter.hist_pos] = h[limiter.hist_pos + TP_TAPS] = x;
+            lb->delay[ch][limiter.delay_pos] = x;
+
+            if (detect)
+            {
+                int32_t peak = tp_interval_peak(&h[limiter.hist_pos + 1]);
+                if (peak > interval)
+                    interval = peak;
+            }
+
+            /* Output the delayed sample now, in place */
+            buf->p32[ch][i] = lb->delay[ch][rd];
+        }
+
+        if (++limiter.hist_pos >= TP_TAPS)
+            limiter.hist_pos = 0;
+        if (++limiter.delay_pos >= WINDOW_MAX + TP_DELAY)
+            limiter.delay_pos = 0;
+
+        /* Each sample's peak includes both intervals around it */
+        int32_t peak = MAX(interval, limiter.last_interval);
+        limiter.last_interval = interval;
+
+        uint32_t pos = limiter.pos++;
+
+        /* Sliding maximum over the window of everything above the ceiling */
+        if (limiter.peak_count > 0 &&
+            lb->peak_pos[limiter.peak_head] == pos)
+        {
+            if (++limiter.peak_head >= window)
+                limiter.peak_head = 0;
+            limiter.peak_count--;
+        }
+
+        if (peak > limiter.ceiling)
+        {
+            int tail = limiter.peak_head + limiter.peak_count;
+
+            /* Drop the smaller peaks this one outlives */
+            while (limiter.peak_count > 0)
+            {
+                int last = tail - 1;
+                if (last >= window)
+                    last -= window;
+                if (lb->peak[last] > peak)
+                    break;
+                tail = last;
+                limiter.peak_count--;
+            }
+
+            if (tail >= window)
+                tail -= window;
+
+            lb->peak[tail] = peak;
+            lb->peak_pos[tail] = pos + window;
+            limiter.peak_count++;
+        }
+
+        /* Gain needed by the loudest peak in the window */
+        uint32_t target = UNITY;
+
+        if (limiter.peak_count > 0)
+        {
+            int32_t max = lb->peak[limiter.peak_head];
+
+            if (max != limiter.target_peak)
+            {
+                limiter.target_peak = max;
+                limiter.target_gain = fp_div(limiter.ceiling, max, UNITY_BITS);
+            }
+
+            target = limiter.target_gain;
+        }
+
+        /* Instant attack, exponential release */
+        int32_t env = limiter.env;
+        int32_t target30 = target << (30 - UNITY_BITS);
+
+        if (target30 < env)
+        {
+            env = target30;
+        }
+        else if (env < target30)
+        {
+            int32_t delta = FRACMUL(target30 - env, limiter.release);
+            env = delta > 0 ? env + delta : target30;
+        }
+
+        limiter.env = env;
+
+        /* Moving average over the window settles on the held gain exactly
+         * when the peak comes out of the delay line */
+        uint32_t gain = env >> (30 - UNITY_BITS);
+        limiter.gain_sum += gain - lb->gain[limiter.gain_pos];
+        lb->gain[limiter.gain_pos] = gain;
+        if (++limiter.gain_pos >= window)
+            limiter.gain_pos = 0;
+
+        if (limiter.gain_sum == window * UNITY)
+            continue;
+
+        gain = ((uint64_t)limiter.gain_sum * limiter.avg_recip) >> 32;
+        if (gain >= UNITY)
+            continue;
+
+        for (int ch = 0; ch < num_chan; ch++)
+        {
+            buf->p32[ch][i] =
+                FRACMUL_SHL(buf->p32[ch][i], gain, 31 - UNITY_BITS);
+        }
+    }
+
+    (void)this;
+}
+
+/* DSP message hook */
+static intptr_t limiter_configure(struct dsp_proc_entry *this,
+                                  struct dsp_config *dsp,
+                                  unsigned int setting,
+                                  intptr_t value)
+{
+    /* This only attaches to the audio (codec) DSP */
+    intptr_t retval = 0;
+
+    switch (setting)
+    {
+    case DSP_PROC_INIT:
+        if (value != 0)
+            break; /* Already enabled */
+
+        retval = handle = core_alloc(sizeof (struct limiter_buffers));
+        if (retval < 0)
+        {
+            logf("Limiter: core_alloc failed (%d bytes)",
+                 (int)sizeof (struct limiter_buffers));
+            break;
+        }
+
+        this->process = limiter_process;
+        limiter_update(dsp_get_output_frequency(dsp));
+        limiter_flush();
+        dsp_proc_activate(dsp, DSP_PROC_LIMITER, true);
+        break;
+
+    case DSP_PROC_CLOSE:
+        /* Being disabled (called also if init fails) */
+        if (handle >= 0)
+            handle = core_free(handle);
+        break;
+
+    case DSP_RESET:
+    case DSP_FLUSH:
+        /* Discontinuity; drop what is held in the delay line */
+        limiter_flush();
+        break;
+
+    case DSP_SET_OUT_FREQUENCY:
+        limiter_update(value);
+        limiter_flush();
+        break;
+
+    case DSP_PROC_NEW_FORMAT:
+    {
+        struct sample_format *format = (struct sample_format *)value;
+
+        if (format->frac_bits != frac_bits)
+        {
+            frac_bits = format->frac_bits;
+            limiter_update(dsp_get_output_frequency(dsp));
+            limiter_flush();
+        }
+        break;
+    }
+    }
+
+    return retval;
+}
+
+/* Database entry */
+DSP_PROC_DB_ENTRY(
+    LIMITER,
+    limiter_configure);
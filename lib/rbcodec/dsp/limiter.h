@@ -0,0 +1,38 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Copyright (C) 2026 by the Rockbox contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#ifndef LIMITER_H
+#define LIMITER_H
+
+#include <stdbool.h>
+
+#define LIMITER_LOOKAHEAD_MIN 1  /* ms */
+#define LIMITER_LOOKAHEAD_MAX 10 /* ms */
+
+struct limiter_settings
+{
+    bool enabled;
+    int ceiling;    /* Highest allowed true peak level, in tenths of a dB */
+    int lookahead;  /* Look-ahead time in ms */
+};
+
+void dsp_set_limiter(const struct limiter_settings *settings);
+
+#endif /* LIMITER_H */
@@ -0,0 +1,391 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Copyright (C) 2026 by the Rockbox contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#include "rbcodecconfig.h"
+#include "platform.h"
+#include "fixedpoint.h"
+#include "fracmul.h"
+#include <string.h>
+#include "dsp_core.h"
+#include "dsp_sample_io.h"
+#include "loudness.h"
+
+/**
+ * Loudness meter (EBU R128 / ITU-R BS.1770-4)
+ *
+ * The signal is K-weighted by the two pre-filters of BS.1770 and its energy
+ * summed in steps of 100ms. Every step completes a 400ms block overlapping
+ * the previous one by 75%. Blocks are not kept; their mean square goes into
+ * a histogram of 0.1 LU bins between LOUDNESS_MIN, which is the absolute
+ * gate, and LOUDNESS_MAX, where both the number of blocks and their summed
+ * energy is counted. The relative gate, 10 LU below the loudness of
+ * everything above the absolute gate, then only has to pick bins and the
+ * integrated loudness is exact but for the gate being rounded to a bin.
+ *
+ * True peak is found by the limiter's 4x interpolator.
+ */
+
+#define ONE_Q30     (1 << 30)
+
+/* Sample energy is summed from s4.27 samples shifted down by this, so full
+ * scale is 2^38 and a 192kHz stereo block can't overflow */
+#define ENERGY_SHIFT    8
+#define FULL_SCALE_LOG2 (2*(WORD_FRACBITS - ENERGY_SHIFT))
+
+/* BS.1770 pre-filter parameters, as derived for any sample rate by
+ * libebur128 (frequencies in s15.16, the rest s1.30) */
+#define SHELF_F0        110229837   /* 1681.97 Hz */
+#define SHELF_VH        1701735515  /* 10^(4/20), the gain of the shelf */
+#define SHELF_VB        1351541308  /* VH^0.4997 */
+#define SHELF_RCP_Q     1518353257  /* 1/0.7072 */
+#define HIGHPASS_F0     2499248     /* 38.14 Hz */
+#define HIGHPASS_RCP_Q  2146079952  /* 1/0.5003 */
+
+/* 10*log10(2) and the 0.691 dB K-weighting gain at 1 kHz, s15.16 */
+#define DB_PER_OCTAVE   197284
+#define K_OFFSET        45285
+
+/* Compute one stage of the K-weighting filter for the sample rate. The
+ * coefficients are s5.26 as made by the shelving filters in dsp_filter.c. */
+static void kweight_coefs(struct dsp_filter *f, unsigned int fs,
+                          uint32_t f0, int64_t rcp_q, bool highpass)
+{
+    long s, c;
+    s = fp_sincos(((uint64_t)f0 << 15) / fs, &c); /* pi*f0/fs */
+
+    const int64_t K = ((int64_t)s << 30) / c;     /* tan(pi*f0/fs) */
+    const int64_t KK = K*K >> 30;
+    const int64_t KQ = K*rcp_q >> 30;
+    const int64_t a0 = ONE_Q30 + KQ + KK;
+    int32_t *coefs = f->coefs;
+
+#define NORM(x) ((int32_t)(((int64_t)(x) << 26) / a0))
+    if (highpass)
+    {
+        /* The highpass stage isn't normalized */
+        coefs[0] = 1 << 26;
+        coefs[1] = -(2 << 26);
+        coefs[2] = 1 << 26;
+    }
+    else
+    {
+        const int64_t VbKQ = SHELF_VB*KQ >> 30;
+        coefs[0] = NORM(SHELF_VH + VbKQ + KK);
+        coefs[1] = NORM(2*(KK - SHELF_VH));
+        coefs[2] = NORM(SHELF_VH - VbKQ + KK);
+    }
+
+    coefs[3] = -NORM(2*(KK - ONE_Q30));
+    coefs[4] = -NORM(ONE_Q30 - KQ + KK);
+#undef NORM
+
+    f->shift = 6;
+    filter_flush(f);
+}
+
+/* log2(v) for v > 0, s15.16 */
+static long log2_fix(uint64_t v)
+{
+    int e = 63 - __builtin_clzll(v);
+    uint32_t x = e > 30 ? v >> (e - 30) : v << (30 - e); /* [1 .. 2), s1.30 */
+    long log2 = (long)e << 16;
+
+    for (long frac = 1 << 15; frac > 0; frac >>= 1)
+    {
+        x = (uint64_t)x*x >> 30;
+        if (x >= 2u << 30)
+        {
+            x >>= 1;
+            log2 += frac;
+        }
+    }
+
+    return log2;
+}
+
+/* Loudness of the mean square energy/count in LUFS, s15.16 */
+static long energy_loudness(uint64_t energy, uint32_t count)
+{
+    long log2 = log2_fix(energy) - log2_fix(count) -
+                    (FULL_SCALE_LOG2 << 16);
+    return (long)((int64_t)log2 * DB_PER_OCTAVE >> 16) - K_OFFSET;
+}
+
+/* Histogram bin of a loudness, or a negative number if it is gated */
+static int loudness_bin(long lufs)
+{
+    int bin = (int64_t)(lufs - (LOUDNESS_MIN << 16)) * 10 >> 16;
+    return MIN(bin, LOUDNESS_BINS - 1);
+}
+
+/* A block of four steps is complete */
+static void add_block(struct loudness_meter *m, uint64_t energy)
+{
+    uint64_t ms = (energy >> 16) * m->block_recip >> 16;
+
+    if (ms == 0)
+        return;
+
+    int bin = loudness_bin(energy_loudness(ms, 1));
+    if (bin < 0)
+        return; /* Below the absolute gate */
+
+    m->count[bin]++;
+    m->energy[bin] += ms;
+}
+
+static void end_step(struct loudness_meter *m)
+{
+    uint64_t e = m->step_energy;
+
+    if (m->num_steps < 3)
+    {
+        m->steps[m->num_steps++] = e;
+    }
+    else
+    {
+        add_block(m, m->steps[0] + m->steps[1] + m->steps[2] + e);
+        m->steps[0] = m->steps[1];
+        m->steps[1] = m->steps[2];
+        m->steps[2] = e;
+    }
+
+    m->step_energy = 0;
+    m->step_pos = 0;
+}
+
+/* Find the true peak of the unfiltered samples */
+static void detect_peak(struct loudness_meter *m, int32_t * const buf[],
+                        int count)
+{
+    const int num_chan = m->num_channels;
+    int32_t level = 0;
+
+    /* Skip the interpolation while nothing can beat the current peak */
+    for (int ch = 0; ch < num_chan; ch++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            int32_t x = abs(buf[ch][i]);
+            if (x > level)
+                level = x;
+        }
+    }
+
+    bool quiet = level <= FRACMUL(m->peak, TP_FAST_FRAC);
+    bool detect = !(quiet && m->quiet);
+    m->quiet = quiet;
+
+    for (int i = 0; i < count; i++)
+    {
+        for (int ch = 0; ch < num_chan; ch++)
+        {
+            int32_t *h = m->hist[ch];
+
+            h[m->hist_pos] = h[m->hist_pos + TP_TAPS] = buf[ch][i];
+
+            if (detect)
+            {
+                int32_t peak = tp_interval_peak(&h[m->hist_pos + 1]);
+                if (peak > m->peak)
+                    m->peak = peak;
+            }
+        }
+
+        if (++m->hist_pos >= TP_TAPS)
+            m->hist_pos = 0;
+    }
+}
+
+/* Measure s4.27 samples; buf is filtered in place */
+static void loudness_process(struct loudness_meter *m, int32_t * const buf[],
+                             int count)
+{
+    const int num_chan = m->num_channels;
+
+    detect_peak(m, buf, count);
+
+    filter_process(&m->shelf, buf, count, num_chan);
+    filter_process(&m->highpass, buf, count, num_chan);
+
+    for (int pos = 0; pos < count; )
+    {
+        int n = MIN(count - pos, m->step_len - m->step_pos);
+        uint64_t e = 0;
+
+        for (int ch = 0; ch < num_chan; ch++)
+        {
+            const int32_t *p = &buf[ch][pos];
+
+            for (int i = 0; i < n; i++)
+            {
+                int32_t y = p[i] >> ENERGY_SHIFT;
+                e += (int64_t)y*y;
+            }
+        }
+
+        /* Mono is heard from both speakers */
+        if (num_chan == 1)
+            e *= 2;
+
+        m->step_energy += e;
+        m->step_pos += n;
+        pos += n;
+
+        if (m->step_pos >= m->step_len)
+            end_step(m);
+    }
+}
+
+/* Restart the filters and blocks for a new sample rate or channel count */
+static void loudness_set_format(struct loudness_meter *m)
+{
+    unsigned int fs = MAX(m->frequency, 8000);
+
+    kweight_coefs(&m->shelf, fs, SHELF_F0, SHELF_RCP_Q, false);
+    kweight_coefs(&m->highpass, fs, HIGHPASS_F0, HIGHPASS_RCP_Q, true);
+
+    m->num_channels = m->stereo_mode == STEREO_MONO ? 1 : 2;
+    m->step_len = fs / 10;
+    m->step_pos = 0;
+    m->step_energy = 0;
+    m->num_steps = 0;
+    m->block_recip = 0xffffffffu / (4*m->step_len);
+
+    memset(m->hist, 0, sizeof (m->hist));
+    m->hist_pos = 0;
+    m->quiet = false;
+}
+
+/* Takes the codec's configure calls that describe its output */
+void loudness_configure(struct loudness_meter *m, unsigned int setting,
+                        intptr_t value)
+{
+    switch (setting)
+    {
+    case DSP_RESET:
+        m->frequency = DSP_OUT_DEFAULT_HZ;
+        m->sample_depth = NATIVE_DEPTH;
+        m->stereo_mode = STEREO_NONINTERLEAVED;
+        break;
+    case DSP_SET_FREQUENCY:
+        m->frequency = value;
+        break;
+    case DSP_SET_SAMPLE_DEPTH:
+        m->sample_depth = value;
+        return; /* Doesn't affect the filters */
+    case DSP_SET_STEREO_MODE:
+        m->stereo_mode = value;
+        break;
+    default:
+        return;
+    }
+
+    loudness_set_format(m);
+}
+
+/* Takes the samples the codec would insert into pcmbuf */
+void loudness_insert(struct loudness_meter *m, const void *ch1,
+                     const void *ch2, int count)
+{
+    int32_t * const buf[2] = { m->work[0], m->work[1] };
+    const int num_chan = m->num_channels;
+    /* Sample stride and the offset of the second channel from the first */
+    const int step = m->stereo_mode == STEREO_INTERLEAVED ? 2 : 1;
+    const ptrdiff_t ch2_offs = m->stereo_mode == STEREO_NONINTERLEAVED ?
+                                   (const char *)ch2 - (const char *)ch1 : 0;
+
+    while (count > 0)
+    {
+        int n = MIN(count, LOUDNESS_WORK);
+
+        for (int ch = 0; ch < num_chan; ch++)
+        {
+            const char *src = (const char *)ch1 + (ch ? ch2_offs : 0);
+            int32_t *d = buf[ch];
+
+            if (m->sample_depth > NATIVE_DEPTH)
+            {
+                /* s(31-depth).depth to s4.27 */
+                const int32_t *s = (const int32_t *)src + (step - 1)*ch;
+                const int shift = WORD_FRACBITS - m->sample_depth;
+
+                for (int i = 0; i < n; i++)
+                    d[i] = shift >= 0 ? s[i*step] << shift :
+                                        s[i*step] >> -shift;
+            }
+            else
+            {
+                const int16_t *s = (const int16_t *)src + (step - 1)*ch;
+
+                for (int i = 0; i < n; i++)
+                    d[i] = s[i*step] << WORD_SHIFT;
+            }
+        }
+
+        loudness_process(m, buf, n);
+
+        ch1 = (const char *)ch1 + n*step*(m->sample_depth > NATIVE_DEPTH ?
+                                          sizeof (int32_t) : sizeof (int16_t));
+        count -= n;
+    }
+}
+
+void loudness_init(struct loudness_meter *m)
+{
+    memset(m, 0, sizeof (*m));
+    loudness_configure(m, DSP_RESET, 0);
+}
+
+bool loudness_result(const struct loudness_meter *m, long *lufs, long *peak)
+{
+    uint64_t energy = 0;
+    uint32_t count = 0;
+    int bin;
+
+    for (bin = 0; bin < LOUDNESS_BINS; bin++)
+    {
+        count += m->count[bin];
+        energy += m->energy[bin];
+    }
+
+    if (count == 0)
+        return false;
+
+    /* Relative gate, rounded up to the next bin */
+    long gate = energy_loudness(energy, count) - (10 << 16);
+    bin = MAX(loudness_bin(gate + 65535 / 10), 0);
+
+    energy = 0;
+    count = 0;
+
+    for (; bin < LOUDNESS_BINS; bin++)
+    {
+        count += m->count[bin];
+        energy += m->energy[bin];
+    }
+
+    if (count == 0)
+        return false;
+
+    *lufs = (energy_loudness(energy, count) + (1 << 3)) >> 4;
+    *peak = m->peak >> (WORD_FRACBITS - 12);
+    return true;
+}
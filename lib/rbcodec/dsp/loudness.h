@@ -0,0 +1,75 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Copyright (C) 2026 by the Rockbox contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#ifndef LOUDNESS_H
+#define LOUDNESS_H
+
+#include <stdbool.h>
+#include "dsp_filter.h"
+#include "true_peak.h"
+
+/** EBU R128 integrated loudness and true peak meter **/
+
+/* Used by: background loudness scan, warble */
+
+/* Range of block loudness that is measured, in LUFS */
+#define LOUDNESS_MIN        (-70)
+#define LOUDNESS_MAX        5
+#define LOUDNESS_BINS       ((LOUDNESS_MAX - LOUDNESS_MIN) * 10)
+
+/* Samples converted at a time */
+#define LOUDNESS_WORK       256
+
+struct loudness_meter
+{
+    /* Format of the codec output */
+    unsigned int frequency;
+    int sample_depth;
+    int stereo_mode;
+    struct dsp_filter shelf;        /* K-weighting: head effects */
+    struct dsp_filter highpass;     /* K-weighting: RLB curve */
+    int num_channels;
+    int step_len;                   /* Samples in 100ms */
+    int step_pos;                   /* Samples in the current step */
+    uint64_t step_energy;           /* Energy of the current step */
+    uint64_t steps[3];              /* Energy of the three steps before it */
+    int num_steps;                  /* Valid entries in steps */
+    uint32_t block_recip;           /* 2^32 / samples per 400ms block */
+    int32_t hist[2][2*TP_TAPS];     /* Interpolator history (mirrored) */
+    int hist_pos;                   /* Write position in hist */
+    bool quiet;                     /* Last buffer couldn't raise the peak */
+    int32_t peak;                   /* True peak so far, s4.27 */
+    uint32_t count[LOUDNESS_BINS];  /* Blocks per 0.1 LU of loudness */
+    uint64_t energy[LOUDNESS_BINS]; /*  ...and their summed mean square */
+    int32_t work[2][LOUDNESS_WORK]; /* Samples converted to s4.27 */
+};
+
+void loudness_init(struct loudness_meter *m);
+/* Feed these with what the codec passes to ci->configure and
+   ci->pcmbuf_insert */
+void loudness_configure(struct loudness_meter *m, unsigned int setting,
+                        intptr_t value);
+void loudness_insert(struct loudness_meter *m, const void *ch1,
+                     const void *ch2, int count);
+/* Integrated loudness in LUFS and true peak as a factor, both s19.12.
+   Returns false if nothing was loud enough to measure. */
+bool loudness_result(const struct loudness_meter *m, long *lufs, long *peak);
+
+#endif /* LOUDNESS_H */
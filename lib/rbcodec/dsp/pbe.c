@@ -133,6 +133,72 @@ void dsp_pbe_enable(int var)
     dsp_proc_enable(dsp, DSP_PROC_PBE, now_enabled);
 }
 
+#ifdef HAVE_DSP_FLOAT
+static void pbe_process(struct dsp_proc_entry *this,
+                        struct dsp_buffer **buf_p)
+{
+    struct dsp_buffer *buf = *buf_p;
+    int count = buf->remcount;
+    int num_channels = buf->format.num_channels;
+    int b2_level = (B2_DLY * pbe_strength) / 100;
+    int b0_level = (B0_DLY * pbe_strength) / 100;
+    const float c1 = tcoef1 * (1.0f / 2147483648.0f); /* s0.31 -> float */
+    const float c2 = tcoef2 * (1.0f / 2147483648.0f);
+    const float c3 = tcoef3 * (1.0f / 2147483648.0f);
+    float x;
+
+    float *b0[2], *b2[2], *b3[2];
+
+    if (handle < 0)
+        return;
+
+    /* Same layout as the fixed-point delay lines */
+    b0[0] = core_get_data(handle);
+    b0[1] = b0[0] + B0_SIZE;
+    b2[0] = b0[1] + B0_SIZE;
+    b2[1] = b2[0] + B2_SIZE;
+    b3[0] = b2[1] + B2_SIZE;
+    b3[1] = b3[0] + B3_SIZE;
+
+    for(int ch = 0; ch < num_channels; ch++)
+    {
+        float *s = buf->pf32[ch];
+
+        for (int i = 0; i < count; i++)
+        {
+            float mul1 = s[i] * c1;
+            float mul2 = s[i] * c2;
+            float mul3 = s[i] * c3;
+            /* 160hz - 500hz no delay */
+            float out = mul1 - mul2;
+
+            /* delay below 160hz*/
+            x = s[i] - mul1;
+            out += dequeue_float(b0[ch], &b0_r[ch], b0_level);
+            enqueue_float(x, b0[ch], &b0_w[ch], b0_level);
+
+            /* delay 500-1150hz */
+            x = mul2 - mul3;
+            out += dequeue_float(b2[ch], &b2_r[ch], b2_level);
+            enqueue_float(x, b2[ch], &b2_w[ch], b2_level);
+
+            /* delay anything beyond 1150hz */
+            x = mul3;
+            out += dequeue_float(b3[ch], &b3_r[ch], B3_DLY);
+            enqueue_float(x, b3[ch], &b3_w[ch], B3_DLY);
+
+            s[i] = out;
+        }
+    }
+
+    /* apply Biophonic EQ   */
+    for (int i = 0; i < 5; i++)
+        filter_process_float(&pbe_filter[i], buf->pf32, buf->remcount,
+                             buf->format.num_channels);
+
+    (void)this;
+}
+#else /* !HAVE_DSP_FLOAT */
 static void pbe_process(struct dsp_proc_entry *this,
                         struct dsp_buffer **buf_p)
 {
@@ -194,6 +260,7 @@ static void pbe_process(struct dsp_proc_entry *this,
 
     (void)this;
 }
+#endif /* HAVE_DSP_FLOAT */
 
 /* DSP message hook */
 static intptr_t pbe_configure(struct dsp_proc_entry *this,
@@ -213,6 +280,9 @@ static intptr_t pbe_configure(struct dsp_proc_entry *this,
             break;
 
         this->process = pbe_process;
+#ifdef HAVE_DSP_FLOAT
+        dsp_proc_set_float(dsp, DSP_PROC_PBE, true);
+#endif
 
         dsp_pbe_flush();
 
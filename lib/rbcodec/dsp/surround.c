@@ -159,6 +159,126 @@ void dsp_surround_enable(int delay_ms)
     dsp_proc_enable(dsp, DSP_PROC_SURROUND, now_enabled);
 }
 
+#ifdef HAVE_DSP_FLOAT
+static void surround_process(struct dsp_proc_entry *this,
+                               struct dsp_buffer **buf_p)
+{
+
+    struct dsp_buffer *buf = *buf_p;
+    int count = buf->remcount;
+
+    int dly_shift3 = dly_size/8;
+    int dly_shift2 = dly_size/4;
+    int dly_shift1 = dly_size/2;
+    int dly = dly_size;
+    int i;
+    float x;
+
+    /* s0.31 -> float */
+    const float c1 = tcoef1 * (1.0f / 2147483648.0f);
+    const float c2 = tcoef2 * (1.0f / 2147483648.0f);
+    const float bc = bcoef * (1.0f / 2147483648.0f);
+    const float hc = hcoef * (1.0f / 2147483648.0f);
+    const float balance = surround_balance * (1.0f / 200);
+    const float wet = surround_mix * (1.0f / 100);
+    const float dry = 1.0f - wet;
+
+    /*only need to buffer right channel */
+    float *b0, *b2, *bb, *hh, *cl;
+
+    b0 = core_get_data(handle);
+    b2 = b0 + B0_DLY;
+    bb = b2 + B2_DLY;
+    hh = bb + BB_DLY;
+    cl = hh + HH_DLY;
+
+    float *sl = buf->pf32[0];
+    float *sr = buf->pf32[1];
+
+    for (i = 0; i < count; i++)
+    {
+        float left = sl[i];
+        float right = sr[i];
+        float mid = (left + right) * 0.5f;
+        float side = left - right;
+        float temp0, temp1;
+
+        if (!surround_side_only)
+        {
+            /*clone the left channal*/
+            temp0 = left;
+            /*keep the middle band of right channel*/
+            temp1 = right * c1 - right * c2;
+        }
+        else /* apply haas to side only*/
+        {
+            temp0 = side * 0.5f;
+            temp1 = (side * c2 - side * c1) * 0.5f;
+        }
+
+        /* inverted crossfeed delay (left channel) to make sound wider*/
+        x = temp1 * 0.35f;
+        temp0 += dequeue_float(cl, &cl_r, dly);
+        enqueue_float(-x, cl, &cl_w, dly);
+
+        /* apply 1/8 delay to frequency below fx2 */
+        x = right - right * c1;
+        temp1 += dequeue_float(b0, &b0_r, dly_shift3);
+        enqueue_float(x, b0, &b0_w, dly_shift3);
+
+        /* cut frequency below half fx2*/
+        temp1 = temp1 * bc;
+
+        /* apply 1/4 delay to frequency below half fx2 */
+        /* use different delay to fake the sound direction*/
+        x = right - right * bc;
+        temp1 += dequeue_float(bb, &bb_r, dly_shift2);
+        enqueue_float(x, bb, &bb_w, dly_shift2);
+
+        /* apply full delay to higher band */
+        x = right * c2;
+        temp1 += dequeue_float(b2, &b2_r, dly);
+        enqueue_float(x, b2, &b2_w, dly);
+
+        /* do the same direction trick again */
+        temp1 -= temp1 * hc;
+
+        x = right * hc;
+        temp1 += dequeue_float(hh, &hh_r, dly_shift1);
+        enqueue_float(x, hh, &hh_w, dly_shift1);
+        /*balance*/
+        if (surround_balance > 0  && !surround_side_only)
+        {
+            temp0 -= temp0 * balance;
+            temp1 += temp1 * balance;
+        }
+        else if (surround_balance > 0)
+        {
+            temp0 += temp0 * balance;
+            temp1 -= temp1 * balance;
+        }
+
+        if  (surround_side_only)
+        {
+            temp0 += mid;
+            temp1 += mid;
+        }
+
+        if (surround_mix == 100)
+        {
+            sl[i] = temp0;
+            sr[i] = temp1;
+        }
+        else
+        {
+            /*dry wet mix*/
+            sl[i] = left * dry + temp0 * wet;
+            sr[i] = right * dry + temp1 * wet;
+        }
+    }
+    (void)this;
+}
+#else /* !HAVE_DSP_FLOAT */
 static void surround_process(struct dsp_proc_entry *this,
                                struct dsp_buffer **buf_p)
 {
@@ -267,6 +387,7 @@ static void surround_process(struct dsp_proc_entry *this,
     }
     (void)this;
 }
+#endif /* HAVE_DSP_FLOAT */
 
 /* Handle format changes and verify the format compatibility */
 static intptr_t surround_new_format(struct dsp_proc_entry *this,
@@ -312,6 +433,9 @@ static intptr_t surround_configure(struct dsp_proc_entry *this,
             break;
 
         this->process = surround_process;
+#ifdef HAVE_DSP_FLOAT
+        dsp_proc_set_float(dsp, DSP_PROC_SURROUND, true);
+#endif
 
         dsp_surround_flush();
 
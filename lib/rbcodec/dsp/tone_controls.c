@@ -96,8 +96,13 @@ static void tone_process(struct dsp_proc_entry *this,
                          struct dsp_buffer **buf_p)
 {
     struct dsp_buffer *buf = *buf_p;
+#ifdef HAVE_DSP_FLOAT
+    filter_process_float((struct dsp_filter *)this->data, buf->pf32,
+                         buf->remcount, buf->format.num_channels);
+#else
     filter_process((struct dsp_filter *)this->data, buf->p32, buf->remcount,
                    buf->format.num_channels);
+#endif
 }
 
 /* DSP message hook */
@@ -114,6 +119,9 @@ static intptr_t tone_configure(struct dsp_proc_entry *this,
 
         this->data = (intptr_t)&tone_filters[dsp_get_id(dsp)];
         this->process = tone_process;
+#ifdef HAVE_DSP_FLOAT
+        dsp_proc_set_float(dsp, DSP_PROC_TONE_CONTROLS, true);
+#endif
         /* Fall-through */
     case DSP_FLUSH:
         filter_flush((struct dsp_filter *)this->data);
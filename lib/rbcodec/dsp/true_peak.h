@@ -0,0 +1,66 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Copyright (C) 2026 by the Rockbox contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#ifndef TRUE_PEAK_H
+#define TRUE_PEAK_H
+
+#include <stdlib.h>
+#include "fracmul.h"
+
+/* Used by: limiter and loudness meter */
+
+/* True peak interpolator: 4x oversampling with 12 taps per phase (as in
+ * BS.1770), filling in between x[n-6] and x[n-5] */
+#define TP_TAPS     12
+#define TP_DELAY    6
+
+/* Kaiser-windowed sinc (beta 3) for phases 1/4, 2/4 and 3/4, in s0.31 and
+ * in history order (oldest sample first). Worst case gain of any phase is
+ * about 2.1. */
+extern const int32_t tp_coefs[3][TP_TAPS];
+
+/* Samples below this fraction (0.46875) of a level can't have true peaks
+ * above it, as 1/2.1 > 0.46875 */
+#define TP_FAST_FRAC 0x3c000000
+
+/* Interpolated peak of the interval between x[n-TP_DELAY] and the sample
+ * after it, including its ends, given the last TP_TAPS samples */
+static inline int32_t tp_interval_peak(const int32_t *h)
+{
+    int32_t peak = MAX(abs(h[TP_TAPS - 1 - TP_DELAY]),
+                       abs(h[TP_TAPS - TP_DELAY]));
+
+    for (int p = 0; p < 3; p++)
+    {
+        const int32_t *c = tp_coefs[p];
+        int32_t y = 0;
+
+        for (int k = 0; k < TP_TAPS; k++)
+            y += FRACMUL(h[k], c[k]);
+
+        y = abs(y);
+        if (y > peak)
+            peak = y;
+    }
+
+    return peak;
+}
+
+#endif /* TRUE_PEAK_H */
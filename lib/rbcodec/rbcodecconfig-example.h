@@ -9,6 +9,8 @@
 #define DSP_OUT_MIN_HZ     44100
 #define DSP_OUT_DEFAULT_HZ 44100
 #define DSP_OUT_MAX_HZ     44100
+/* Run the DSP filtering stages on float samples (hosted FPU builds) */
+/* #define HAVE_DSP_FLOAT */
 
 #ifndef __ASSEMBLER__
 
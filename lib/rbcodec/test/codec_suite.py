@@ -0,0 +1,534 @@
+#!/usr/bin/env python3
+#             __________               __   ___.
+#   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+#   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+#   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+#   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+#                     \/            \/     \/    \/            \/
+# $Id$
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+# KIND, either express or implied.
+#
+"""Codec conformance and speed suite for warble.
+
+Builds a corpus of test signals, encoded with the PCM container writers below
+and with whatever encoders are found in $PATH, and decodes every file with
+warble. Lossless files must decode to exactly the source samples. Every
+decode is also compared to a stored reference decode: identical output is
+"exact", otherwise it must be within --min-psnr of the reference. The decoding
+speed of each file is reported as a realtime factor, next to the one stored
+with the reference.
+
+Nothing is stored in the source tree. The first run (or --update) decodes the
+references with the warble at hand, so make them with a known good build
+before changing a codec:
+
+    make codec-suite SUITEOPTS=--update     # with the tree as it was
+    make codec-suite                        # after the change
+
+The float DSP stages of hosted FPU targets are checked against the fixed-point
+ones with a second warble, built with DSP=float in another build directory.
+Each stage in DSP_CASES runs on the same source through both, and the outputs
+must agree within the stage's tolerance:
+
+    make DSP=float                          # in the second build directory
+    make codec-suite SUITEOPTS="--float-warble <dir>/warble.<model>"
+
+The exit status is 1 if any file failed.
+"""
+
+import argparse
+import array
+import hashlib
+import json
+import math
+import os
+import random
+import re
+import shutil
+import struct
+import subprocess
+import sys
+
+BASELINE = "baseline.json"
+
+# Source signals: name -> (rate, channels, bits, seconds)
+SOURCES = {
+    "stereo16": (44100, 2, 16, 10),
+    "mono16":   (22050, 1, 16, 5),
+    "stereo24": (48000, 2, 24, 5),
+}
+
+# Encoders: name -> (extension, lossless, source, command). The command is
+# only run if its program is in $PATH; {src} and {out} are filled in.
+FFMPEG = ["ffmpeg", "-v", "error", "-y", "-i", "{src}"]
+ENCODERS = {
+    "flac":     ("flac", True, "stereo16",
+                 ["flac", "-s", "-f", "-o", "{out}", "{src}"]),
+    "flac24":   ("flac", True, "stereo24",
+                 ["flac", "-s", "-f", "-o", "{out}", "{src}"]),
+    "wavpack":  ("wv", True, "stereo16",
+                 ["wavpack", "-q", "-y", "{src}", "-o", "{out}"]),
+    "wavpack24": ("wv", True, "stereo24",
+                 ["wavpack", "-q", "-y", "{src}", "-o", "{out}"]),
+    "ape":      ("ape", True, "stereo16", ["mac", "{src}", "{out}", "-c2000"]),
+    "alac":     ("m4a", True, "stereo16", FFMPEG + ["-c:a", "alac", "{out}"]),
+    "tta":      ("tta", True, "stereo16", FFMPEG + ["{out}"]),
+    "mp3":      ("mp3", False, "stereo16",
+                 ["lame", "--quiet", "-b", "192", "{src}", "{out}"]),
+    "mp3-mono": ("mp3", False, "mono16",
+                 ["lame", "--quiet", "-V", "5", "{src}", "{out}"]),
+    "vorbis":   ("ogg", False, "stereo16",
+                 ["oggenc", "-Q", "-q", "5", "-o", "{out}", "{src}"]),
+    "opus":     ("opus", False, "stereo16",
+                 ["opusenc", "--quiet", "--bitrate", "128", "{src}", "{out}"]),
+    "aac":      ("m4a", False, "stereo16",
+                 FFMPEG + ["-c:a", "aac", "-b:a", "192k", "{out}"]),
+    "wma":      ("wma", False, "stereo16",
+                 FFMPEG + ["-c:a", "wmav2", "-b:a", "192k", "{out}"]),
+    "speex":    ("spx", False, "mono16",
+                 ["speexenc", "--quiet", "-w", "{src}", "{out}"]),
+}
+
+# DSP stages with a float version: name -> (configuration, max difference in
+# 16-bit LSBs, min PSNR in dB). Either tolerance may be None. The float stages
+# are the more exact; the fixed-point biquads lose precision at low corner
+# frequencies, and PBE and the compressor compute their gains differently.
+DSP_CASES = {
+    "eq":         ("eq=200,7,-30/3000,10,30:precut=30", 2, None),
+    "eq-low":     ("eq=60,7,60:precut=60", None, 80.0),
+    "crossfeed":  ("crossfeed=1", 2, None),
+    "crossfeed2": ("crossfeed=2", 2, None),
+    "afr":        ("afr=3", 2, None),
+    "surround":   ("surround=10", 2, None),
+    "mono":       ("channels=1", 1, None),
+    "custom":     ("channels=2", 1, None),
+    "karaoke":    ("channels=5", 1, None),
+    "pbe":        ("pbe=100", None, 70.0),
+    "compressor": ("compressor=-20", None, 70.0),
+}
+
+
+## Test signals
+
+def make_signal(rate, channels, bits, seconds):
+    """Interleaved integer samples: a sweep, tones, noise, a burst and a
+    stretch of silence, different in each channel"""
+    rnd = random.Random(1234)
+    full = (1 << (bits - 1)) - 1
+    n = rate * seconds
+    out = array.array("i", bytes(4 * n * channels))
+    phase = 0.0
+    for i in range(n):
+        t = i / rate
+        # Exponential sweep from 20 Hz to 0.45 fs over the whole signal
+        f = 20.0 * (0.45 * rate / 20.0) ** (i / n)
+        phase += 2 * math.pi * f / rate
+        noise = rnd.uniform(-1.0, 1.0)
+        silent = 0.4 < i / n < 0.45
+        burst = 1.0 if int(t * 8) % 5 == 0 else 0.3
+        left = 0.45 * math.sin(phase) + 0.05 * noise
+        right = (0.3 * math.sin(2 * math.pi * 997 * t) +
+                 0.2 * burst * math.sin(2 * math.pi * 3163 * t) +
+                 0.1 * noise)
+        for c, v in enumerate((left, right)[:channels]):
+            out[i*channels + c] = 0 if silent else int(round(v * full))
+    return out
+
+
+def pcm_bytes(samples, bits, big_endian=False):
+    width = bits // 8
+    order = "big" if big_endian else "little"
+    if width == 2:
+        a = array.array("h", samples)
+        if (sys.byteorder == "big") != big_endian:
+            a.byteswap()
+        return a.tobytes()
+    return b"".join(s.to_bytes(width, order, signed=True) for s in samples)
+
+
+def write_wav(path, samples, rate, channels, bits):
+    data = pcm_bytes(samples, bits)
+    align = channels * bits // 8
+    with open(path, "wb") as f:
+        f.write(b"RIFF" + struct.pack("<I", 36 + len(data)) + b"WAVE")
+        f.write(b"fmt " + struct.pack("<IHHIIHH", 16, 1, channels, rate,
+                                      rate * align, align, bits))
+        f.write(b"data" + struct.pack("<I", len(data)) + data)
+
+
+def write_w64(path, samples, rate, channels, bits):
+    riff = bytes.fromhex("72696666" "2e91cf11a5d628db04c10000")
+    wave = bytes.fromhex("77617665" "f3acd3118cd100c04f8edb8a")
+    fmt = bytes.fromhex("666d7420" "f3acd3118cd100c04f8edb8a")
+    dat = bytes.fromhex("64617461" "f3acd3118cd100c04f8edb8a")
+    data = pcm_bytes(samples, bits)
+    align = channels * bits // 8
+    fmt_body = struct.pack("<HHIIHH", 1, channels, rate, rate * align,
+                           align, bits)
+    fmt_chunk = fmt + struct.pack("<Q", 24 + len(fmt_body)) + fmt_body
+    data_chunk = dat + struct.pack("<Q", 24 + len(data)) + data
+    with open(path, "wb") as f:
+        f.write(riff + struct.pack("<Q", 40 + len(fmt_chunk) +
+                                   len(data_chunk)) + wave)
+        f.write(fmt_chunk + data_chunk)
+
+
+def ieee_extended(value):
+    """80-bit IEEE 754 extended float, as AIFF wants the sample rate"""
+    exponent = int(math.floor(math.log2(value)))
+    mantissa = int(value * 2 ** (63 - exponent))
+    return struct.pack(">HQ", 16383 + exponent, mantissa)
+
+
+def write_aiff(path, samples, rate, channels, bits):
+    data = pcm_bytes(samples, bits, big_endian=True)
+    frames = len(samples) // channels
+    comm = struct.pack(">hIh", channels, frames, bits) + ieee_extended(rate)
+    ssnd = struct.pack(">II", 0, 0) + data
+    with open(path, "wb") as f:
+        f.write(b"FORM" + struct.pack(">I", 4 + 8 + len(comm) +
+                                      8 + len(ssnd)) + b"AIFF")
+        f.write(b"COMM" + struct.pack(">I", len(comm)) + comm)
+        f.write(b"SSND" + struct.pack(">I", len(ssnd)) + ssnd)
+
+
+def write_au(path, samples, rate, channels, bits):
+    data = pcm_bytes(samples, bits, big_endian=True)
+    with open(path, "wb") as f:
+        f.write(b".snd" + struct.pack(">IIIII", 24, len(data), bits // 8 + 1,
+                                      rate, channels))
+        f.write(data)
+
+
+# Containers written here: name -> (extension, source, writer)
+PCM_WRITERS = {
+    "wav":      ("wav", "stereo16", write_wav),
+    "wav-mono": ("wav", "mono16", write_wav),
+    "wav24":    ("wav", "stereo24", write_wav),
+    "w64":      ("w64", "stereo16", write_w64),
+    "aiff":     ("aiff", "stereo16", write_aiff),
+    "au":       ("au", "stereo16", write_au),
+}
+
+
+## Corpus
+
+class Case:
+    def __init__(self, name, path, lossless, source):
+        self.name = name
+        self.path = path
+        self.lossless = lossless
+        self.source = source
+
+
+def build_corpus(corpus, regen):
+    """Returns the cases that could be made and the encoders that are
+    missing"""
+    srcdir = os.path.join(corpus, "src")
+    os.makedirs(srcdir, exist_ok=True)
+    signals = {}
+
+    def source(name):
+        if name not in signals:
+            signals[name] = make_signal(*SOURCES[name])
+        return signals[name]
+
+    def source_wav(name):
+        path = os.path.join(srcdir, name + ".wav")
+        if regen or not os.path.exists(path):
+            rate, channels, bits, _ = SOURCES[name]
+            write_wav(path, source(name), rate, channels, bits)
+        return path
+
+    cases = []
+    missing = []
+
+    for name, (ext, src, writer) in sorted(PCM_WRITERS.items()):
+        path = os.path.join(corpus, "%s.%s" % (name, ext))
+        if regen or not os.path.exists(path):
+            rate, channels, bits, _ = SOURCES[src]
+            writer(path, source(src), rate, channels, bits)
+        cases.append(Case(name, path, True, src))
+
+    for name, (ext, lossless, src, cmd) in sorted(ENCODERS.items()):
+        path = os.path.join(corpus, "%s.%s" % (name, ext))
+        if regen or not os.path.exists(path):
+            if shutil.which(cmd[0]) is None:
+                missing.append(name)
+                continue
+            args = [a.format(src=source_wav(src), out=path) for a in cmd]
+            if subprocess.run(args, stdin=subprocess.DEVNULL).returncode != 0:
+                print("%s: encoder failed" % name, file=sys.stderr)
+                missing.append(name)
+                continue
+        cases.append(Case(name, path, lossless, src))
+
+    return cases, missing, source
+
+
+## Decoding
+
+def read_wav(path, typecode):
+    """Samples as array(typecode) and channel count of a WAV or None"""
+    try:
+        with open(path, "rb") as f:
+            wav = f.read()
+    except OSError:
+        return None
+    if wav[:4] != b"RIFF" or wav[8:12] != b"WAVE":
+        return None
+
+    pos, channels, data = 12, 0, None
+    while pos + 8 <= len(wav):
+        tag, size = wav[pos:pos+4], struct.unpack("<I", wav[pos+4:pos+8])[0]
+        body = wav[pos+8:pos+8+size]
+        if tag == b"fmt ":
+            channels = struct.unpack("<H", body[2:4])[0]
+        elif tag == b"data":
+            data = body
+            break
+        pos += 8 + size + (size & 1)
+
+    if data is None:
+        return None
+    samples = array.array(typecode)
+    samples.frombytes(data[:len(data) // samples.itemsize * samples.itemsize])
+    if sys.byteorder == "big":
+        samples.byteswap()
+    return samples, channels
+
+
+def read_float_wav(path):
+    """Samples and channel count of a 64-bit float WAV or None"""
+    return read_wav(path, "d")
+
+
+def decode(warble, infile, outfile):
+    """Decode to 64-bit float with warble -f"""
+    res = subprocess.run([warble, "-f", infile, outfile],
+                         stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    if res.returncode != 0:
+        return None
+    return read_float_wav(outfile)
+
+
+def process(warble, config, infile, outfile):
+    """16-bit samples of the DSP output of warble -c config"""
+    res = subprocess.run([warble, "-c", config, infile, outfile],
+                         stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    if res.returncode != 0:
+        return None
+    dec = read_wav(outfile, "h")
+    return dec[0] if dec else None
+
+
+def md5(path):
+    with open(path, "rb") as f:
+        return hashlib.md5(f.read()).hexdigest()
+
+
+def bench(warble, infile, runs):
+    """Best realtime factor of a few runs of warble -b"""
+    best = None
+    for _ in range(runs):
+        res = subprocess.run([warble, "-b", infile], stdout=subprocess.DEVNULL,
+                             stderr=subprocess.PIPE, universal_newlines=True)
+        m = re.search(r"([0-9.]+)x realtime", res.stderr)
+        if res.returncode != 0 or m is None:
+            return None
+        rt = float(m.group(1))
+        best = rt if best is None else max(best, rt)
+    return best
+
+
+## Checks
+
+def lossless_error(samples, channels, src, srcinfo):
+    """None if the decode is exactly the source, what is wrong otherwise"""
+    rate, src_channels, bits, _ = srcinfo
+    if channels != src_channels:
+        return "%d channels, expected %d" % (channels, src_channels)
+    if len(samples) != len(src):
+        return "%d samples, expected %d" % (len(samples), len(src))
+    scale = float(1 << (bits - 1))
+    for i, (d, s) in enumerate(zip(samples, src)):
+        if d * scale != s:
+            return "sample %d is %.1f, expected %d" % (i, d * scale, s)
+    return None
+
+
+def psnr(samples, ref):
+    """Peak signal to noise ratio in dB relative to full scale"""
+    err = sum((a - b) * (a - b) for a, b in zip(samples, ref))
+    if err == 0:
+        return math.inf
+    return 10 * math.log10(len(ref) / err)
+
+
+def dsp_error(fixed, flt, max_lsb, min_psnr):
+    """Detail of how far the float output is from the fixed-point output and
+    whether that is out of tolerance"""
+    if len(fixed) != len(flt):
+        return "length differs", True
+    diff = max((abs(a - b) for a, b in zip(fixed, flt)), default=0)
+    p = psnr([a / 32768.0 for a in flt], [b / 32768.0 for b in fixed])
+    bad = ((max_lsb is not None and diff > max_lsb) or
+           (min_psnr is not None and p < min_psnr))
+    return "max %d LSB, PSNR %.1f dB" % (diff, p), bad
+
+
+def main():
+    ap = argparse.ArgumentParser(
+        description=__doc__.split("\n\n")[0],
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog="\n\n".join(__doc__.split("\n\n")[1:]))
+    ap.add_argument("--warble", required=True, help="warble binary to test")
+    ap.add_argument("--corpus", default="codec-suite",
+                    help="directory for the corpus and the references "
+                         "[%(default)s]")
+    ap.add_argument("--update", action="store_true",
+                    help="replace the references with this warble's output")
+    ap.add_argument("--regen", action="store_true",
+                    help="make the corpus again (implies --update)")
+    ap.add_argument("--min-psnr", type=float, default=90.0,
+                    help="lowest PSNR to the reference in dB that passes "
+                         "[%(default)s]")
+    ap.add_argument("--runs", type=int, default=3,
+                    help="benchmark runs per file, the best counts; 0 to "
+                         "skip [%(default)s]")
+    ap.add_argument("--max-slowdown", type=float, default=None,
+                    help="fail files that decode this many percent slower "
+                         "than with the references")
+    ap.add_argument("--float-warble",
+                    help="warble built with DSP=float to check the float "
+                         "DSP stages against the fixed-point ones with")
+    ap.add_argument("only", nargs="*", help="only test these cases")
+    args = ap.parse_args()
+
+    warble = os.path.abspath(args.warble)
+    if not os.access(warble, os.X_OK):
+        ap.error("%s is not executable" % args.warble)
+    float_warble = None
+    if args.float_warble:
+        float_warble = os.path.abspath(args.float_warble)
+        if not os.access(float_warble, os.X_OK):
+            ap.error("%s is not executable" % args.float_warble)
+
+    corpus = args.corpus
+    refdir = os.path.join(corpus, "ref")
+    outdir = os.path.join(corpus, "out")
+    os.makedirs(refdir, exist_ok=True)
+    os.makedirs(outdir, exist_ok=True)
+
+    update = args.update or args.regen
+    cases, missing, source = build_corpus(corpus, args.regen)
+    if args.only:
+        cases = [c for c in cases if c.name in args.only]
+
+    basefile = os.path.join(corpus, BASELINE)
+    baseline = {}
+    if os.path.exists(basefile) and not args.regen:
+        with open(basefile) as f:
+            baseline = json.load(f)
+
+    print("%-10s %-6s %-28s %9s %9s %7s" %
+          ("case", "result", "detail", "realtime", "ref", "change"))
+
+    failed = 0
+    for case in cases:
+        out = os.path.join(outdir if not update else refdir,
+                           case.name + ".wav")
+        ref = os.path.join(refdir, case.name + ".wav")
+        result, detail = "ok", ""
+
+        dec = decode(warble, case.path, out)
+        if dec is None:
+            result, detail = "FAIL", "decoding failed"
+        else:
+            samples, channels = dec
+            digest = md5(out)
+            if case.lossless:
+                err = lossless_error(samples, channels, source(case.source),
+                                     SOURCES[case.source])
+                if err:
+                    result, detail = "FAIL", err
+            if result == "ok" and not update and case.name in baseline:
+                if digest == baseline[case.name]["md5"]:
+                    detail = "exact"
+                else:
+                    refdec = read_float_wav(ref)
+                    if refdec is None or len(refdec[0]) != len(samples):
+                        result, detail = "FAIL", "length differs from reference"
+                    else:
+                        p = psnr(samples, refdec[0])
+                        detail = "PSNR %.1f dB" % p
+                        if p < args.min_psnr:
+                            result = "FAIL"
+            elif result == "ok":
+                detail = "reference" if update else "no reference"
+
+        rt = bench(warble, case.path, args.runs) if args.runs > 0 else None
+        entry = baseline.get(case.name, {})
+        ref_rt = entry.get("realtime")
+        change = ""
+        if rt is not None and ref_rt and not update:
+            pct = (rt / ref_rt - 1) * 100
+            change = "%+.1f%%" % pct
+            if args.max_slowdown is not None and -pct > args.max_slowdown:
+                result = "FAIL"
+                detail = detail or "too slow"
+
+        print("%-10s %-6s %-28s %9s %9s %7s" %
+              (case.name, result, detail[:28],
+               "%.1fx" % rt if rt is not None else "-",
+               "%.1fx" % ref_rt if ref_rt and not update else "-", change))
+
+        if result != "ok":
+            failed += 1
+        elif update:
+            baseline[case.name] = {"md5": digest}
+            if rt is not None:
+                baseline[case.name]["realtime"] = rt
+
+    if update:
+        with open(basefile, "w") as f:
+            json.dump(baseline, f, indent=1, sort_keys=True)
+
+    total = len(cases)
+    if float_warble:
+        src = os.path.join(corpus, "src", "dsp.wav")
+        rate, channels, bits, _ = SOURCES["stereo16"]
+        write_wav(src, source("stereo16"), rate, channels, bits)
+        print()
+        for name, (config, max_lsb, min_psnr) in sorted(DSP_CASES.items()):
+            if args.only and name not in args.only:
+                continue
+            total += 1
+            fixed = process(warble, config, src,
+                            os.path.join(outdir, "dsp-%s.wav" % name))
+            flt = process(float_warble, config, src,
+                          os.path.join(outdir, "dsp-%s-float.wav" % name))
+            if fixed is None or flt is None:
+                result, detail = "FAIL", "processing failed"
+            else:
+                detail, bad = dsp_error(fixed, flt, max_lsb, min_psnr)
+                result = "FAIL" if bad else "ok"
+            print("%-10s %-6s %-28s" % (name, result, detail[:28]))
+            if result != "ok":
+                failed += 1
+
+    if missing:
+        print("\nnot in $PATH, skipped: %s" % ", ".join(missing))
+    print("\n%d of %d failed" % (failed, total))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
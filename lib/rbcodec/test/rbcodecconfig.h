@@ -1,2 +1,19 @@
 #include "../rbcodecconfig-example.h"
 #include "system.h"
+
+/* Per-stage DSP profiling (-p) */
+#define DSP_PROFILE
+#if defined(__i386__) || defined(__x86_64__)
+#define DSP_PROFILE_CLOCK() __builtin_ia32_rdtsc()
+#define DSP_PROFILE_UNIT    "cycles"
+#elif !defined(__ASSEMBLER__)
+#include <time.h>
+static inline uint64_t dsp_profile_clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+#define DSP_PROFILE_CLOCK() dsp_profile_clock_ns()
+#define DSP_PROFILE_UNIT    "ns"
+#endif
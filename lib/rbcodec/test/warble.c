@@ -30,12 +30,22 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 #include "buffering.h" /* TYPE_PACKET_AUDIO */
 #include "kernel.h"
 #include "core_alloc.h"
 #include "codecs.h"
 #include "dsp_core.h"
+#include "eq.h"
+#include "crossfeed.h"
+#include "compressor.h"
+#include "limiter.h"
+#include "loudness.h"
+#include "afr.h"
+#include "channel_mode.h"
+#include "pbe.h"
+#include "surround.h"
 #include "metadata.h"
 #include "settings.h"
 #include "sound.h"
@@ -97,9 +107,13 @@ off_t filesize(int fd)
 
 /***************** INTERNAL *****************/
 
-static enum { MODE_PLAY, MODE_WRITE } mode;
+static enum { MODE_PLAY, MODE_WRITE, MODE_BENCH } mode;
 static bool use_dsp = true;
 static bool enable_loop = false;
+static bool show_profile = false;
+static bool use_context = false;
+static bool measure_loudness = false;
+static struct loudness_meter meter;
 static const char *config = "";
 
 /* Volume control */
@@ -242,6 +256,33 @@ static void write_pcm_raw(int32_t *pcm, int count)
     }
 }
 
+/***** MODE_BENCH *****/
+
+/* MODE_BENCH only measures how long the codec takes; the output is dropped */
+static double bench_seconds;
+
+static double bench_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void print_bench(void)
+{
+    double audio_seconds = (double)num_output_samples / format.freq;
+
+    if (bench_seconds <= 0 || format.freq == 0) {
+        fprintf(stderr, "no samples decoded\n");
+        return;
+    }
+
+    fprintf(stderr, "\ndecoded %lu samples (%.1f s) in %.3f s: "
+            "%.2f MB/s, %.1fx realtime\n",
+            num_output_samples, audio_seconds, bench_seconds,
+            ci.filesize / bench_seconds / 1e6, audio_seconds / bench_seconds);
+}
+
 /***** MODE_PLAY *****/
 
 /* MODE_PLAY uses a double buffer: one half is read by the playback thread and
@@ -381,9 +422,86 @@ static void playback_pcm(int16_t *pcm, int count)
 
 /***** ALL MODES *****/
 
+/* eq=<hz>,<q>,<gain>/<hz>,<q>,<gain>/... - q and gain are in tenths, as
+ * with the EQ settings */
+static void config_eq(const char *val, const char *end)
+{
+    int band = 0;
+
+    while (val < end && band < EQ_NUM_BANDS) {
+        struct eq_band_setting setting;
+        if (sscanf(val, "%d,%d,%d", &setting.cutoff, &setting.q,
+                   &setting.gain) != 3) {
+            fprintf(stderr, "error: bad eq band \"%.*s\"\n",
+                    (int)strcspn(val, "/: \t\n"), val);
+            exit(1);
+        }
+        dsp_set_eq_coefs(band++, &setting);
+        val += strcspn(val, "/: \t\n");
+        if (*val == '/')
+            val++;
+    }
+
+    /* Flatten the rest */
+    for (; band < EQ_NUM_BANDS; band++) {
+        struct eq_band_setting setting = { 1000, 10, 0 };
+        dsp_set_eq_coefs(band, &setting);
+    }
+
+    dsp_eq_enable(true);
+}
+
+/* compressor=<threshold> - other parameters at the default settings */
+static void config_compressor(const char *val)
+{
+    struct compressor_settings settings = {
+        .threshold = atoi(val),
+        .makeup_gain = 1,   /* auto */
+        .ratio = 1,         /* 4:1 */
+        .knee = 1,          /* soft */
+        .release_time = 500,
+        .attack_time = 5,
+    };
+    dsp_set_compressor(&settings);
+}
+
+/* crossfeed=<0|1|2> - off, meier or custom at the default settings */
+static void config_crossfeed(const char *val)
+{
+    dsp_set_crossfeed_type(atoi(val));
+    dsp_set_crossfeed_direct_gain(-15);
+    dsp_set_crossfeed_cross_params(-60, -160, 700);
+}
+
+/* limiter=<ceiling> - ceiling in tenths of a dB, 5 ms look-ahead */
+static void config_limiter(const char *val)
+{
+    struct limiter_settings settings = {
+        .enabled = true,
+        .ceiling = atoi(val),
+        .lookahead = 5,
+    };
+    dsp_set_limiter(&settings);
+}
+
+/* pbe=<n> - strength in percent at the default precut */
+static void config_pbe(const char *val)
+{
+    dsp_pbe_precut(-25);
+    dsp_pbe_enable(atoi(val));
+}
+
+/* surround=<ms> - delay at the default balance, cutoffs and mix */
+static void config_surround(const char *val)
+{
+    dsp_surround_set_balance(35);
+    dsp_surround_set_cutoff(3400, 320);
+    dsp_surround_mix(50);
+    dsp_surround_enable(atoi(val));
+}
+
 static void perform_config(void)
 {
-    /* TODO: equalizer, etc. */
     while (config) {
         const char *name = config;
         const char *eq = strchr(config, '=');
@@ -395,20 +513,38 @@ static void perform_config(void)
         if (!strncmp(name, "wait=", 5)) {
             if (atoi(val) > num_output_samples)
                 return;
+        } else if (!strncmp(name, "afr=", 4)) {
+            dsp_afr_enable(atoi(val));
+        } else if (!strncmp(name, "channels=", 9)) {
+            channel_mode_set_config(atoi(val));
+        } else if (!strncmp(name, "compressor=", 11)) {
+            config_compressor(val);
+        } else if (!strncmp(name, "crossfeed=", 10)) {
+            config_crossfeed(val);
         } else if (!strncmp(name, "dither=", 7)) {
             dsp_dither_enable(atoi(val) ? true : false);
+        } else if (!strncmp(name, "eq=", 3)) {
+            config_eq(val, end);
         } else if (!strncmp(name, "halt=", 5)) {
             if (atoi(val))
                 codec_action = CODEC_ACTION_HALT;
+        } else if (!strncmp(name, "limiter=", 8)) {
+            config_limiter(val);
         } else if (!strncmp(name, "loop=", 5)) {
             enable_loop = atoi(val) != 0;
         } else if (!strncmp(name, "offset=", 7)) {
             ci.id3->offset = atoi(val);
+        } else if (!strncmp(name, "pbe=", 4)) {
+            config_pbe(val);
+        } else if (!strncmp(name, "precut=", 7)) {
+            dsp_set_eq_precut(atoi(val));
         } else if (!strncmp(name, "rate=", 5)) {
             dsp_set_pitch(atof(val) * PITCH_SPEED_100);
         } else if (!strncmp(name, "seek=", 5)) {
             codec_action = CODEC_ACTION_SEEK_TIME;
             codec_action_param = atoi(val);
+        } else if (!strncmp(name, "surround=", 9)) {
+            config_surround(val);
         } else if (!strncmp(name, "tempo=", 6)) {
             dsp_set_timestretch(atof(val) * PITCH_SPEED_100);
         } else if (!strncmp(name, "vol=", 4)) {
@@ -440,7 +576,12 @@ static void ci_pcmbuf_insert(const void *ch1, const void *ch2, int count)
 {
     num_output_samples += count;
 
-    if (use_dsp) {
+    if (measure_loudness)
+        loudness_insert(&meter, ch1, ch2, count);
+
+    if (mode == MODE_BENCH) {
+        /* Nothing to do */
+    } else if (use_dsp) {
         struct dsp_buffer src;
         src.remcount = count;
         src.pin[0] = ch1;
@@ -591,6 +732,9 @@ static void ci_set_offset(size_t value)
 
 static void ci_configure(int setting, intptr_t value)
 {
+    if (measure_loudness)
+        loudness_configure(&meter, setting, value);
+
     if (use_dsp) {
         dsp_configure(ci.dsp, setting, value);
     } else {
@@ -629,6 +773,41 @@ static unsigned ci_sleep(unsigned ticks)
     return 0;
 }
 
+/* Seek index, only kept for the current run. Points are taken in order,
+ * which is how the codecs produce them when decoding from the start. */
+static struct seek_point seek_index[4096];
+static int seek_index_count = 0;
+
+static void ci_seek_index_add(unsigned long time, off_t pos)
+{
+    if (seek_index_count < (int)ARRAYLEN(seek_index) &&
+        (seek_index_count == 0 ||
+         time > seek_index[seek_index_count - 1].time)) {
+        seek_index[seek_index_count].time = time;
+        seek_index[seek_index_count].pos = pos;
+        seek_index_count++;
+    }
+}
+
+static bool ci_seek_index_find(unsigned long time, struct seek_point *lo,
+                               struct seek_point *hi)
+{
+    bool changed = false;
+    int i;
+
+    for (i = 0; i < seek_index_count && seek_index[i].time <= time; i++);
+
+    if (i > 0 && seek_index[i - 1].time > lo->time) {
+        *lo = seek_index[i - 1];
+        changed = true;
+    }
+    if (i < seek_index_count && seek_index[i].time < hi->time) {
+        *hi = seek_index[i];
+        changed = true;
+    }
+    return changed;
+}
+
 static void ci_debugf(const char *fmt, ...)
 {
     va_list ap;
@@ -722,6 +901,9 @@ static struct codec_api ci = {
     ci_round_value_to_list32,
 
 #endif /* HAVE_RECORDING */
+
+    ci_seek_index_add,
+    ci_seek_index_find,
 };
 
 static void print_mp3entry(const struct mp3entry *id3, FILE *f)
@@ -827,9 +1009,23 @@ static void decode_file(const char *input_fn)
         fprintf(stderr, "error: codec returned error from codec_main\n");
         exit(1);
     }
-    if (c_hdr->run_proc() != CODEC_OK) {
+    double start = bench_time();
+    enum codec_status status;
+    if (use_context) {
+        if (!c_hdr->ctx_ops) {
+            fprintf(stderr, "error: %s has no reentrant contexts\n", str);
+            exit(1);
+        }
+        void *ctx = malloc(c_hdr->ctx_ops->size);
+        status = c_hdr->ctx_ops->run(&ci, ctx);
+        free(ctx);
+    } else {
+        status = c_hdr->run_proc();
+    }
+    if (status != CODEC_OK) {
         fprintf(stderr, "error: codec error\n");
     }
+    bench_seconds = bench_time() - start;
     c_hdr->entry_point(CODEC_UNLOAD);
 
     /* Close */
@@ -838,27 +1034,90 @@ static void decode_file(const char *input_fn)
         close(input_fd);
 }
 
+static void print_profile(void)
+{
+    struct dsp_proc_stats stats[32];
+    uint64_t samples;
+    int count = dsp_get_proc_stats(dsp_get_config(CODEC_IDX_AUDIO), stats,
+                                   ARRAYLEN(stats), &samples);
+    uint64_t total = 0;
+
+    for (int i = 0; i < count; i++)
+        total += stats[i].ticks;
+
+    if (samples == 0 || total == 0) {
+        fprintf(stderr, "no DSP samples output\n");
+        return;
+    }
+
+    fprintf(stderr, "\nDSP profile: %llu samples output, %s per sample:\n",
+            (unsigned long long)samples, DSP_PROFILE_UNIT);
+    fprintf(stderr, "  %-14s %10s %12s %6s\n",
+            "stage", "calls", DSP_PROFILE_UNIT, "%");
+    for (int i = 0; i < count; i++) {
+        fprintf(stderr, "  %-14s %10lu %12.2f %5.1f%%\n",
+                stats[i].name, stats[i].calls,
+                (double)stats[i].ticks / samples,
+                100.0 * stats[i].ticks / total);
+    }
+    fprintf(stderr, "  %-14s %10s %12.2f\n",
+            "total", "", (double)total / samples);
+}
+
+static void print_loudness(void)
+{
+    long lufs, peak;
+
+    if (!loudness_result(&meter, &lufs, &peak)) {
+        fprintf(stderr, "loudness: nothing above the gate\n");
+        return;
+    }
+
+    fprintf(stderr, "loudness: %.2f LUFS, true peak %.2f dBTP\n",
+            lufs / 4096.0, 20 * log10(peak / 4096.0));
+}
+
 static void print_help(const char *progname)
 {
     fprintf(stderr, "Usage:\n"
                     "        Play: %s [options] INPUTFILE\n"
                     "Write to WAV: %s [options] INPUTFILE OUTPUTFILE\n"
+                    "   Benchmark: %s -b [options] INPUTFILE\n"
                     "\n"
                     "general options:\n"
+                    "  -b            Decode without output and print the decoding\n"
+                    "                speed\n"
                     "  -c a=1:b=2    Configuration (see below)\n"
                     "  -h            Show this help\n"
+                    "  -l            Print the EBU R128 loudness and true peak\n"
+                    "                of the codec output when done\n"
+                    "  -p            Print DSP time per stage when done\n"
+                    "  -x            Decode through a reentrant codec context\n"
                     "\n"
                     "write to WAV options:\n"
                     "  -f            Write raw codec output converted to 64-bit float\n"
                     "  -r            Write raw 32-bit codec output without WAV header\n"
                     "\n"
                     "configuration:\n"
+                    "  afr=<n>       Auditory fatigue reduction 0=off to 3=strong [0]\n"
+                    "  channels=<n>  Channel mode 0=stereo, 1=mono, 2=custom,\n"
+                    "                3=mono left, 4=mono right, 5=karaoke [0]\n"
+                    "  compressor=<n>\n"
+                    "                Enable compressor at threshold <n> dB [0]\n"
+                    "  crossfeed=<n> Crossfeed 0=off, 1=meier, 2=custom [0]\n"
                     "  dither=<0|1>  Enable/disable dithering [0]\n"
+                    "  eq=<f>,<q>,<g>/...\n"
+                    "                Enable EQ with bands at <f> Hz, Q <q>/10,\n"
+                    "                gain <g>/10 dB\n"
                     "  halt=<0|1>    Stop decoding if 1 [0]\n"
+                    "  limiter=<n>   Enable limiter with ceiling <n>/10 dB\n"
                     "  loop=<0|1>    Enable/disable looping [0]\n"
                     "  offset=<n>    Start at byte offset within the file [0]\n"
+                    "  pbe=<n>       Perceptual bass enhancement at <n> percent [0]\n"
+                    "  precut=<n>    Set EQ precut to <n>/10 dB [0]\n"
                     "  rate=<n>      Multiply rate by <n> [1.0]\n"
                     "  seek=<n>      Seek <n> ms into the file\n"
+                    "  surround=<n>  Enable surround with a <n> ms delay [0]\n"
                     "  tempo=<n>     Timestretch by <n> [1.0]\n"
                     "  vol=<n>       Set volume attenuation to <n> dB [-0]\n"
                     "  wait=<n>      Don't apply remaining configuration until\n"
@@ -869,24 +1128,43 @@ static void print_help(const char *progname)
                     "  %s in.adx -c loop=1:wait=44100:halt=1\n"
                     "  # Lower pitch 1 octave and write to out.wav\n"
                     "  %s in.ogg -c rate=0.5:tempo=2 out.wav\n"
-                    , progname, progname, progname, progname);
+                    "  # Time the DSP stages with crossfeed and a 2-band EQ\n"
+                    "  %s -p in.flac -c crossfeed=1:eq=100,7,30/8000,7,-20 out.wav\n"
+                    "  # Measure the decoding speed of the FLAC codec\n"
+                    "  %s -b in.flac\n"
+                    , progname, progname, progname, progname, progname, progname,
+                    progname);
 }
 
 int main(int argc, char **argv)
 {
     int opt;
-    while ((opt = getopt(argc, argv, "c:fhr")) != -1) {
+    while ((opt = getopt(argc, argv, "bc:fhlprx")) != -1) {
         switch (opt) {
+        case 'b':
+            mode = MODE_BENCH;
+            use_dsp = false;
+            break;
         case 'c':
             config = optarg;
             break;
         case 'f':
             use_dsp = false;
             break;
+        case 'l':
+            measure_loudness = true;
+            loudness_init(&meter);
+            break;
+        case 'p':
+            show_profile = true;
+            break;
         case 'r':
             use_dsp = false;
             write_raw = true;
             break;
+        case 'x':
+            use_context = true;
+            break;
         case 'h': /* fallthrough */
         default:
             print_help(argv[0]);
@@ -894,7 +1172,21 @@ int main(int argc, char **argv)
         }
     }
 
-    if (argc == optind + 2) {
+    if (show_profile && !use_dsp) {
+        fprintf(stderr, "error: -p needs the DSP; can't be used with -b, -f or -r\n");
+        exit(1);
+    }
+
+    /* The DSP allocates its buffers at init and when stages are enabled */
+    core_allocator_init();
+
+    if (mode == MODE_BENCH) {
+        if (argc != optind + 1) {
+            fprintf(stderr, "error: -b takes no output file\n");
+            print_help(argv[0]);
+            exit(1);
+        }
+    } else if (argc == optind + 2) {
         write_init(argv[optind + 1]);
     } else if (argc == optind + 1) {
         if (!use_dsp) {
@@ -902,7 +1194,6 @@ int main(int argc, char **argv)
             print_help(argv[0]);
             exit(1);
         }
-        core_allocator_init();
         playback_init();
     } else {
         if (argc > 1)
@@ -913,6 +1204,13 @@ int main(int argc, char **argv)
 
     decode_file(argv[optind]);
 
+    if (show_profile)
+        print_profile();
+    if (measure_loudness)
+        print_loudness();
+    if (mode == MODE_BENCH)
+        print_bench();
+
     if (mode == MODE_WRITE)
         write_quit();
     else if (mode == MODE_PLAY)